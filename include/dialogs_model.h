@@ -21,7 +21,9 @@
 
 #include <solarus/DialogResources.h>
 #include <QAbstractItemModel>
+#include <QFutureWatcher>
 #include <QItemSelectionModel>
+#include <QMap>
 
 namespace SolarusEditor {
 
@@ -41,6 +43,19 @@ class DialogsModel : public QAbstractItemModel {
 
 public:
 
+  /**
+   * @brief A translation file parsed in a worker thread.
+   */
+  struct TranslationData {
+
+    QString language_id;          /**< Language of the translation. */
+    QString path;                 /**< The dialogs data file. */
+    bool valid;                   /**< Whether the file could be parsed. */
+    Solarus::DialogResources
+        resources;                /**< The translated dialogs. */
+
+  };
+
   // Creation.
   DialogsModel(
       const Quest& quest, const QString& language_id,
@@ -90,6 +105,7 @@ public:
   void delete_dialog_property(const QString& id, const QString& key);
   QList<QPair<QString, Solarus::DialogData>> delete_prefix(
       const QString& prefix);
+  QMap<QString, QString> set_dialog_texts(const QMap<QString, QString>& texts);
 
   // Selection.
   QItemSelectionModel& get_selection_model();
@@ -100,6 +116,7 @@ public:
 
   // Translation.
   QString get_translation_id() const;
+  bool is_loading_translation() const;
   void set_translation_id(const QString &language_id);
   void clear_translation();
   void reload_translation();
@@ -126,14 +143,23 @@ signals:
   void dialog_property_changed(
       const QString& id, const QString& key, const QString& value);
 
+  void translation_changed();
+  void translation_load_failed(const QString& message);
+
 public slots:
 
   void save() const;
 
+private slots:
+
+  void translation_loaded();
+
 private:
 
   void build_dialog_tree();
   void clear_translation_from_tree();
+  void set_translation_resources(const Solarus::DialogResources& resources);
+  void set_missing_translation(const QString& id, bool missing);
 
   const Quest& quest;             /**< The quest the dialogs belongs to. */
   const QString language_id;      /**< Language of the dialogs. */
@@ -146,6 +172,9 @@ private:
   QString translation_id;
   Solarus::DialogResources translation_resources;
 
+  QFutureWatcher<TranslationData>
+    translation_watcher;          /**< Parses the translation file. */
+
   QItemSelectionModel
     selection_model;              /**< Dialog currently selected. */
 };
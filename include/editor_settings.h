@@ -38,6 +38,7 @@ public:
   static const QString no_audio;
   static const QString video_acceleration;
   static const QString quest_size;
+  static const QString image_cache_size;
 
   // Console keys.
   static const QString console_history;
@@ -256,7 +256,8 @@ private:
   mutable std::unique_ptr<SpriteModel>
       sprite_model;               /**< Sprite to show when the entity is drawn
                                    * as a sprite. */
-  mutable QPixmap sprite_image;   /**< Fixed image from the sprite. */
+  mutable SpriteModel::Frame
+      sprite_frame;               /**< Fixed frame from the sprite. */
   DrawShapeInfo draw_shape_info;  /**< Shape to use when the entity is drawn as
                                    * a shape. */
   DrawImageInfo draw_image_info;  /**< Subimage to use when the entity is
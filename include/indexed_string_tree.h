@@ -18,8 +18,9 @@
 #define SOLARUSEDITOR_INDEXED_STRING_TREE_H
 
 #include "natural_comparator.h"
+#include <QHash>
 #include <QString>
-#include <map>
+#include <vector>
 
 namespace SolarusEditor {
 
@@ -27,6 +28,15 @@ namespace SolarusEditor {
  * @brief Tree of indexed string keys.
  * This class provides methods to manage a map indexed by string like a tree
  * for a QAbstractItemModel (see StringsModel and DialogsModel).
+ *
+ * Children of a node are stored in a vector sorted in natural order,
+ * for constant-time access by row, and in a hash table for constant-time
+ * access by key.
+ * All nodes are also indexed by their complete key, so that queries on a key
+ * do not need to walk the tree.
+ *
+ * Keys can also be flagged, for example to mark problems, and each node
+ * counts the flagged keys in its subtree.
  */
 class IndexedStringTree {
 
@@ -40,6 +50,8 @@ public:
   QString* get_internal_key(const QString& key) const;
 
   QString get_row_key(int index, const QString& parent_key = "") const;
+  QString* get_row_internal_key(
+      int index, const QString& parent_key = "") const;
 
   bool has_parent(const QString& key) const;
   QString get_parent(const QString& key) const;
@@ -55,6 +67,10 @@ public:
   bool can_remove_ref(const QString& key, QString& parent_key, int& index);
   bool remove_ref(const QString& key, bool keep_key = false);
 
+  bool is_flagged(const QString& key) const;
+  bool set_flagged(const QString& key, bool flagged);
+  int get_num_flagged(const QString& key = "") const;
+
   void clear();
 
 private:
@@ -69,19 +85,25 @@ private:
   struct Node {
 
     /** Constructor. */
-    Node() : parent(nullptr), index(0), type(CONTAINER) {
+    Node() : parent(nullptr), type(CONTAINER), flagged(false), num_flagged(0) {
     }
 
     Node* parent;   /**< The parent node. */
-    int index;      /**< The index of the node. */
 
+    QString sub_key;  /**< The last part of the key of the node. */
     QString key;    /**< The internal key of the node
                      * (complete key from the root). */
 
     int type;       /**< Type of the node. */
 
-    std::map<QString, Node*, NaturalComparator>
-      children;     /**< Children of the node. */
+    bool flagged;   /**< Whether the key is flagged. */
+    int num_flagged;  /**< Number of flagged nodes in the subtree,
+                       * including this one. */
+
+    std::vector<Node*>
+      children;     /**< Children of the node sorted by sub key. */
+    QHash<QString, Node*>
+      children_by_key;  /**< Children of the node by sub key. */
   };
 
   Node* get_child(const QString& key) const;
@@ -94,12 +116,18 @@ private:
       const QString& key, int type, QString& parent_key, int& index);
   bool remove_child(const QString& key, int type, bool keep_key = false);
 
-  void build_index_map(const Node* node) const;
+  int get_child_index(const Node* node) const;
+  int insert_child(Node* parent, Node* node);
+  void update_num_flagged(Node* node, int delta);
 
   void clear_children(Node *node);
 
   QString separator;  /**< The separator character. */
   Node* root;         /**< The root node of the tree. */
+  QHash<QString, Node*>
+      nodes;          /**< All nodes except the root by complete key. */
+  NaturalComparator
+      comparator;     /**< Order of children. */
 
 };
 
@@ -19,6 +19,7 @@
 
 #include "entities/entity_model.h"
 #include "sprite_model.h"
+#include <QRegion>
 #include <array>
 #include <memory>
 
@@ -142,6 +143,7 @@ signals:
   void location_changed(const QPoint& location);
   void tileset_id_changed(const QString& tileset_id);
   void tileset_reloaded();
+  void tileset_image_changed(const EntityIndexes& indexes);
   void music_id_changed(const QString& music_id);
 
   void entities_about_to_be_added(const EntityIndexes& indexes);
@@ -160,9 +162,15 @@ public slots:
 
   void save() const;
 
+private slots:
+
+  void tileset_patterns_image_changed();
+  void tileset_image_region_changed(const QRegion& region);
+
 private:
 
   void rebuild_entity_indexes(int layer);
+  void refresh_tile_images(const QRegion& region);
 
   Quest& quest;                   /**< The quest the tileset belongs to. */
   const QString map_id;           /**< Id of the map. */
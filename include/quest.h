@@ -17,8 +17,11 @@
 #ifndef SOLARUSEDITOR_QUEST_H
 #define SOLARUSEDITOR_QUEST_H
 
+#include <quest_image_cache.h>
+#include <quest_index.h>
 #include <quest_properties.h>
 #include <quest_resources.h>
+#include <quest_text_index.h>
 #include <solarus/ResourceType.h>
 #include <QObject>
 #include <QSet>
@@ -52,6 +55,14 @@ public:
   const QuestResources& get_resources() const;
   QuestResources& get_resources();
 
+  const QuestIndex& get_index() const;
+  QuestIndex& get_index();
+
+  const QuestTextIndex& get_text_index() const;
+  QuestTextIndex& get_text_index();
+
+  QuestImageCache& get_image_cache() const;
+
   // Get paths.
   QString get_name() const;
   QString get_data_path() const;
@@ -81,6 +92,7 @@ public:
   QString get_tileset_data_file_path(const QString& tileset_id) const;
   QString get_tileset_tiles_image_path(const QString& tileset_id) const;
   QString get_tileset_entities_image_path(const QString& tileset_id) const;
+  QString get_cache_path() const;
 
   // Check path properties.
   static bool is_valid_file_name(const QString& file_name);
@@ -99,6 +111,7 @@ public:
   bool is_properties_path(const QString& path) const;
   bool is_resource_path(const QString& path, ResourceType& resource_type) const;
   bool is_in_resource_path(const QString& path, ResourceType& resource_type) const;
+  static QStringList get_resource_extensions(ResourceType resource_type);
   bool is_potential_resource_element(
       const QString& path, ResourceType& resource_type, QString& element_id) const;
   bool is_resource_element(
@@ -158,6 +171,11 @@ private:
 
   QuestProperties properties;      /**< Properties given in quest.dat. */
   QuestResources resources;        /**< Resources declared in project_db.dat. */
+  QuestIndex index;                /**< Index of the content of maps. */
+  QuestTextIndex text_index;       /**< Index of the words of strings and
+                                    * dialogs. */
+  mutable QuestImageCache
+      image_cache;                 /**< Images decoded for all models. */
   QSet<QString> open_paths;        /**< Files currently edited by the user. */
 
 };
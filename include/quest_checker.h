@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_QUEST_CHECKER_H
+#define SOLARUSEDITOR_QUEST_CHECKER_H
+
+#include "quest_index.h"
+#include <QFutureWatcher>
+#include <QObject>
+
+namespace SolarusEditor {
+
+class Quest;
+
+/**
+ * @brief Checks the integrity of all resources of a quest.
+ *
+ * The following problems are detected:
+ * - files that cannot be parsed,
+ * - tile patterns outside their tileset image,
+ * - sprite animations whose image is missing or too small,
+ * - maps using missing tilesets, tile patterns, sprites, sprite directions
+ *   or other resources,
+ * - teletransporters to missing maps or destinations,
+ * - dialogs and strings missing in some languages.
+ *
+ * Files are checked in worker threads, in two passes: tilesets, sprites and
+ * languages first, then maps that refer to them.
+ * Like QuestIndex, this class works directly on Solarus data files
+ * because the editor models create pixmaps, which is only allowed in the
+ * GUI thread.
+ */
+class QuestChecker : public QObject {
+  Q_OBJECT
+
+public:
+
+  /**
+   * @brief Severity of a problem.
+   */
+  enum class Severity {
+    WARNING,          /**< Something probably unwanted. */
+    FAILURE           /**< Something that will fail at runtime. */
+  };
+
+  /**
+   * @brief A problem found in a file.
+   */
+  struct Issue {
+
+    Severity severity;            /**< How serious the problem is. */
+    QString file_path;            /**< File where the problem is. */
+    ResourceType resource_type;   /**< Type of resource checked. */
+    QString element_id;           /**< Resource element checked. */
+    EntityIndex entity_index;     /**< Entity concerned if the file is a map,
+                                   * or an invalid index. */
+    QString location;             /**< Human-readable location in the file. */
+    QString message;              /**< Description of the problem. */
+
+  };
+
+  /**
+   * @brief A file to check in a worker thread.
+   */
+  struct Job {
+
+    ResourceType resource_type;   /**< Type of resource to check. */
+    QString element_id;           /**< Id of the element to check. */
+    QString path;                 /**< Main data file of the element. */
+    QString secondary_path;       /**< Tileset image or strings file. */
+
+  };
+
+  /**
+   * @brief What a worker thread found in a file.
+   */
+  struct JobResult {
+
+    Job job;                      /**< The file checked. */
+    bool valid;                   /**< Whether the file could be parsed. */
+    QList<Issue> issues;          /**< Problems found. */
+    QSet<QString> ids;            /**< Pattern ids of a tileset or dialog
+                                   * ids of a language. */
+    QSet<QString> keys;           /**< String keys of a language. */
+    int max_directions;           /**< Highest number of directions of the
+                                   * animations of a sprite. */
+
+  };
+
+  explicit QuestChecker(Quest& quest);
+  ~QuestChecker();
+
+  bool is_running() const;
+  int get_num_files() const;
+
+signals:
+
+  void started();
+  void progress_changed(int num_files_checked, int num_files);
+  void issues_found(const QList<QuestChecker::Issue>& issues);
+  void finished();
+
+public slots:
+
+  void start();
+  void cancel();
+
+private slots:
+
+  void file_checked(int result_index);
+  void pass_finished();
+  void index_build_finished();
+
+private:
+
+  void stop();
+  void start_maps_pass();
+  void check_maps();
+  void check_languages();
+
+  Quest& quest;                   /**< The quest to check. */
+  int pass;                       /**< Current pass: 0 (not running),
+                                   * 1 (tilesets, sprites and languages)
+                                   * or 2 (maps). */
+  int num_files;                  /**< Number of files to check in total. */
+  int num_files_checked;          /**< Number of files already checked. */
+  QMap<QString, QSet<QString>>
+      tileset_patterns;           /**< Pattern ids of each valid tileset. */
+  QMap<QString, int>
+      sprite_directions;          /**< Highest number of directions of each
+                                   * valid sprite. */
+  QMap<QString, QSet<QString>>
+      language_dialogs;           /**< Dialog ids of each language. */
+  QMap<QString, QSet<QString>>
+      language_strings;           /**< String keys of each language. */
+  QList<Job> map_jobs;            /**< Maps to check in the second pass. */
+  QFutureWatcher<JobResult>
+      watcher;                    /**< Monitors files being checked in
+                                   * worker threads. */
+
+};
+
+}
+
+#endif
@@ -18,6 +18,7 @@
 #define SOLARUSEDITOR_QUEST_FILES_MODEL_H
 
 #include "quest_resources.h"
+#include <QHash>
 #include <QSet>
 #include <QSortFilterProxyModel>
 #include <array>
@@ -109,6 +110,14 @@ private:
 
   using ExtraPathColumnPtrs = std::array<QString*, NUM_COLUMNS>;
 
+  /**
+   * @brief Information about a resource directory to classify files quickly.
+   */
+  struct ResourceDir {
+    ResourceType resource_type;             /**< Type of resource of the directory. */
+    QStringList extensions;                 /**< Extensions of element files. */
+  };
+
   /**
    * @brief For a directory, list of the paths added by this model but that
    * do not exist on the filesystem.
@@ -143,6 +152,9 @@ private:
   void remove_extra_path(const QModelIndex& parent, const QString& path);
   void rebuild_extra_path_indexes_cache(const QModelIndex& parent);
 
+  void build_path_classification();
+  bool is_potential_resource_file(const QString& path) const;
+
   Quest& quest;                        /**< The quest represented by this model. */
   QFileSystemModel* source_model;      /**< The underlying file model. */
 
@@ -153,6 +165,12 @@ private:
       all_extra_paths;                 /**< List of all paths stored in extra_paths
                                         * (redundant info for performance). */
 
+  QString data_path_prefix;            /**< Path of the data directory followed by '/'. */
+  QHash<QString, ResourceDir>
+      resource_dirs;                   /**< Each resource directory, by path. */
+  QSet<QString> map_script_paths;      /**< Script path of each declared map
+                                        * (redundant info for performance). */
+
 };
 
 }
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_QUEST_IMAGE_CACHE_H
+#define SOLARUSEDITOR_QUEST_IMAGE_CACHE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Images of a quest decoded once and shared by all models.
+ *
+ * Images are identified by their canonical path and reloaded when the
+ * file is modified.
+ * They are returned as implicitly shared QImage and QPixmap objects,
+ * so callers never copy pixels unless they modify them.
+ * When the memory used exceeds a budget, the least recently used images
+ * are removed from the cache.
+ *
+ * Pixmaps can only be used from the GUI thread, so this class must not be
+ * used from worker threads.
+ */
+class QuestImageCache {
+
+public:
+
+  static constexpr qint64 default_max_bytes = 256 * 1024 * 1024;
+
+  QuestImageCache();
+
+  QImage get_image(const QString& path);
+  QPixmap get_pixmap(const QString& path);
+  void invalidate(const QString& path);
+  void clear();
+
+  qint64 get_max_bytes() const;
+  void set_max_bytes(qint64 max_bytes);
+
+  // Statistics.
+  int get_num_images() const;
+  qint64 get_num_bytes() const;
+  int get_num_hits() const;
+  int get_num_misses() const;
+
+private:
+
+  /**
+   * @brief An image of the cache.
+   */
+  struct Entry {
+    QDateTime last_modified;      /**< Modification date of the file. */
+    qint64 file_size;             /**< Size of the file. */
+    QImage image;                 /**< The decoded image. */
+    QPixmap pixmap;               /**< Pixmap created from the image if
+                                   * requested. */
+    qint64 num_bytes;             /**< Memory used by the image and the
+                                   * pixmap. */
+    quint64 last_use;             /**< Value of the use counter when this
+                                   * image was last requested. */
+  };
+
+  Entry* get_entry(const QString& path);
+  void remove_entry(const QString& key);
+  void evict(const QString& key_to_keep);
+
+  QHash<QString, Entry> entries;  /**< Images indexed by canonical path. */
+  qint64 max_bytes;               /**< Memory budget. */
+  qint64 num_bytes;               /**< Memory used by all images. */
+  quint64 use_counter;            /**< Incremented at each request. */
+  int num_hits;                   /**< Requests served from the cache. */
+  int num_misses;                 /**< Requests that decoded a file. */
+
+};
+
+}
+
+#endif
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_QUEST_INDEX_H
+#define SOLARUSEDITOR_QUEST_INDEX_H
+
+#include "entities/entity_traits.h"
+#include "quest_resources.h"
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QPoint>
+#include <QSet>
+#include <QSize>
+
+namespace Solarus {
+class MapData;
+}
+
+namespace SolarusEditor {
+
+class Quest;
+
+/**
+ * @brief Quest-wide index of the content of all maps.
+ *
+ * For each map, the index stores the map properties, the named entities
+ * and every reference from the map to something else of the quest
+ * (tileset, music, destination maps, sprites, enemy breeds, treasures,
+ * dialogs...).
+ * This allows to answer questions like "which entities of this map are
+ * destinations" or "which maps use this sprite" without opening maps.
+ * It also counts the tiles using each tile pattern, so that unused patterns
+ * of a tileset can be found.
+ *
+ * The index is built in background threads when the quest is open,
+ * persisted in the editor cache directory and updated incrementally:
+ * only maps whose file changed since the last build are parsed again.
+ * During a build, map_info_changed(), map_info_removed() and
+ * pattern_usage_changed() are not emitted for each map:
+ * build_finished() is emitted once at the end instead.
+ */
+class QuestIndex : public QObject {
+  Q_OBJECT
+
+public:
+
+  /**
+   * @brief Kinds of things a map can refer to.
+   */
+  enum class ReferenceKind {
+    RESOURCE,         /**< A resource element (tileset, sprite, music...). */
+    DIALOG,           /**< A dialog id. */
+    DESTINATION       /**< A named destination of another map. */
+  };
+
+  /**
+   * @brief A reference from a map to another element of the quest.
+   */
+  struct Reference {
+
+    ReferenceKind kind;           /**< What is referenced. */
+    ResourceType resource_type;   /**< Type of resource referenced
+                                   * (only for ReferenceKind::RESOURCE). */
+    QString target_id;            /**< Id of the referenced element. */
+    QString target_map_id;        /**< Map containing the referenced entity
+                                   * (only for ReferenceKind::DESTINATION). */
+    QString map_id;               /**< The map that makes the reference. */
+    EntityIndex entity_index;     /**< The entity that makes the reference,
+                                   * or an invalid index for map properties. */
+    EntityType entity_type;       /**< Type of this entity if any. */
+    QString entity_name;          /**< Name of this entity if any. */
+    QString key;                  /**< Name of the field holding the reference. */
+
+  };
+
+  /**
+   * @brief A named entity of a map.
+   */
+  struct NamedEntity {
+
+    QString name;                 /**< Name of the entity. */
+    EntityType type;              /**< Type of the entity. */
+    EntityIndex index;            /**< Layer and order of the entity. */
+
+  };
+
+  /**
+   * @brief Information about a map stored in the index.
+   */
+  struct MapInfo {
+
+    MapInfo();
+
+    QString map_id;               /**< Id of the map. */
+    bool valid;                   /**< Whether the map file could be parsed. */
+    qint64 last_modified;         /**< Modification date of the map data file
+                                   * when it was parsed, in milliseconds
+                                   * since epoch. */
+    qint64 file_size;             /**< Size of the map data file when it was
+                                   * parsed. */
+    QSize size;                   /**< Size of the map in pixels. */
+    int min_layer;                /**< Lowest layer. */
+    int max_layer;                /**< Highest layer. */
+    QString world;                /**< World or an empty string. */
+    int floor;                    /**< Floor or MapData::NO_FLOOR. */
+    QPoint location;              /**< Location of the map in its world. */
+    QString tileset_id;           /**< Tileset of the map. */
+    QString music_id;             /**< Music of the map. */
+    QList<NamedEntity>
+        named_entities;           /**< Entities that have a name. */
+    QList<Reference> references;  /**< Everything referenced by the map. */
+    QMap<QString, int>
+        pattern_counts;           /**< Number of tiles and dynamic tiles
+                                   * using each pattern of the tileset. */
+
+  };
+
+  explicit QuestIndex(Quest& quest);
+  ~QuestIndex();
+
+  bool is_building() const;
+  QStringList get_map_ids() const;
+  bool has_map_info(const QString& map_id) const;
+  MapInfo get_map_info(const QString& map_id);
+  static QMap<QString, EntityType> get_named_entities(const MapInfo& map_info);
+
+  QList<Reference> find_references(
+      ResourceType resource_type, const QString& element_id) const;
+  QList<Reference> find_dialog_references(const QString& dialog_id) const;
+  QList<Reference> find_destination_references(
+      const QString& map_id, const QString& destination_name) const;
+
+  int get_pattern_usage(const QString& tileset_id, const QString& pattern_id) const;
+  QMap<QString, int> get_maps_using_pattern(
+      const QString& tileset_id, const QString& pattern_id) const;
+  QSet<QString> get_used_patterns(const QString& tileset_id) const;
+
+  static MapInfo parse_map_file(const QString& map_id, const QString& path);
+  static MapInfo parse_map_data(const QString& map_id, const Solarus::MapData& map);
+
+signals:
+
+  void map_info_changed(const QString& map_id);
+  void map_info_removed(const QString& map_id);
+  void pattern_usage_changed(const QString& tileset_id);
+  void build_finished();
+
+public slots:
+
+  void rebuild();
+  void update_all();
+  void update_map(const QString& map_id);
+
+private slots:
+
+  void reload();
+  void map_parsed(int result_index);
+  void build_finished_in_worker();
+  void file_created(const QString& path);
+  void file_renamed(const QString& old_path, const QString& new_path);
+  void file_deleted(const QString& path);
+
+private:
+
+  void cancel_build();
+  QStringList remove_undeclared_and_get_outdated_maps();
+  bool is_up_to_date(const MapInfo& map_info) const;
+  void set_map_info(const MapInfo& map_info);
+  void remove_map_info(const QString& map_id);
+  void add_pattern_usage(const MapInfo& map_info);
+  void remove_pattern_usage(const MapInfo& map_info);
+  bool is_map_data_file(const QString& path, QString& map_id) const;
+  QList<Reference> find_references(const QString& target_key) const;
+
+  QString get_cache_file_path() const;
+  void load_cache();
+  void save_cache();
+
+  Quest& quest;                   /**< The quest indexed. */
+  QMap<QString, MapInfo> maps;    /**< Information of each indexed map. */
+  QHash<QString, QSet<QString>>
+      referencing_maps;           /**< Ids of maps referring to each target.
+                                   * Keys are built by make_target_key(). */
+  QHash<QString, QHash<QString, QMap<QString, int>>>
+      pattern_usage;              /**< For each tileset and each pattern,
+                                   * number of tiles using it in each map. */
+  bool cache_dirty;               /**< Whether the index changed since it
+                                   * was last written to the cache. */
+  bool batch_signals;             /**< Whether a build is in progress and
+                                   * changes are only notified at the end. */
+  QFutureWatcher<MapInfo>
+      build_watcher;              /**< Monitors maps being parsed in
+                                   * background threads. */
+
+};
+
+}
+
+#endif
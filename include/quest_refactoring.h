@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_QUEST_REFACTORING_H
+#define SOLARUSEDITOR_QUEST_REFACTORING_H
+
+#include "quest_index.h"
+#include <QMap>
+#include <QObject>
+
+namespace SolarusEditor {
+
+class Quest;
+
+/**
+ * @brief Updates references to an element of a quest when it is renamed.
+ *
+ * Renaming a resource element, a dialog, a string key or a tile pattern
+ * breaks every map, script or translation that refers to the old id.
+ * This class first computes the list of changes to make (using the quest
+ * index for maps), so that the user can review them,
+ * and then applies the changes selected.
+ *
+ * Changes are applied to all files in parallel and atomically:
+ * either all files are rewritten or none of them is modified.
+ */
+class QuestRefactoring : public QObject {
+  Q_OBJECT
+
+public:
+
+  /**
+   * @brief Kinds of changes that can be applied to a file.
+   */
+  enum class ChangeKind {
+    MAP_PROPERTY,     /**< A property of a map (tileset or music). */
+    ENTITY_FIELD,     /**< A field of an entity in a map. */
+    DIALOG_ID,        /**< The id of a dialog in a dialogs file. */
+    STRING_KEY,       /**< The key of a string in a strings file. */
+    SCRIPT_TEXT       /**< A quoted string literal in a Lua script. */
+  };
+
+  /**
+   * @brief A modification to make in a file.
+   */
+  struct Change {
+
+    ChangeKind kind;              /**< What to modify. */
+    QString file_path;            /**< The file to modify. */
+    QString location;             /**< Human-readable location of the change
+                                   * in the file. */
+    EntityIndex entity_index;     /**< Entity to modify
+                                   * (only for ChangeKind::ENTITY_FIELD). */
+    QString key;                  /**< Property or field to modify
+                                   * (only for map changes). */
+    int line;                     /**< Line to modify, starting at 1
+                                   * (only for ChangeKind::SCRIPT_TEXT). */
+    QString old_value;            /**< Value expected in the file. */
+    QString new_value;            /**< Value to set instead. */
+    bool safe;                    /**< @c false if this change comes from a
+                                   * textual search and needs to be reviewed. */
+
+  };
+
+  explicit QuestRefactoring(Quest& quest);
+
+  QList<Change> plan_resource_renaming(
+      ResourceType resource_type, const QString& old_id, const QString& new_id);
+  QList<Change> find_resource_usages(
+      ResourceType resource_type, const QString& element_id);
+  QList<Change> plan_dialog_renaming(
+      const QString& language_id, const QMap<QString, QString>& new_ids);
+  QList<Change> plan_string_renaming(
+      const QString& language_id, const QMap<QString, QString>& new_keys);
+  QList<Change> plan_pattern_renaming(
+      const QString& tileset_id, const QMap<QString, QString>& new_pattern_ids);
+
+  void apply(const QList<Change>& changes);
+
+  static QList<Change> get_inverse_changes(const QList<Change>& changes);
+  static void add_renaming(
+      QMap<QString, QString>& new_ids, const QString& old_id, const QString& new_id);
+  static void remove_renaming(QMap<QString, QString>& new_ids, const QString& id);
+
+private:
+
+  QList<Change> plan_map_changes(
+      const QList<QuestIndex::Reference>& references,
+      const QString& old_id,
+      const QString& new_id);
+  QList<Change> plan_script_changes(const QMap<QString, QString>& new_values);
+  QStringList get_script_paths() const;
+
+  Quest& quest;                   /**< The quest to refactor. */
+
+};
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_QUEST_TEXT_INDEX_H
+#define SOLARUSEDITOR_QUEST_TEXT_INDEX_H
+
+#include "quest_resources.h"
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+namespace SolarusEditor {
+
+class DialogsModel;
+class Quest;
+class StringsModel;
+
+/**
+ * @brief Quest-wide full-text index of strings and dialogs.
+ *
+ * Every string, dialog text and dialog property of every language
+ * is split into lowercase words.
+ * The index maps each word to the texts containing it, so that queries like
+ * "where did we mention the crystal key" are answered without reading
+ * language files.
+ *
+ * Queries are made of words and of quoted phrases.
+ * A text matches if it contains a word starting with each query word
+ * and each phrase as consecutive words.
+ *
+ * The index is built in background threads from language files when the
+ * quest is open.
+ * Languages currently edited are then followed through their
+ * StringsModel or DialogsModel, so that unsaved changes can be found too.
+ */
+class QuestTextIndex : public QObject {
+  Q_OBJECT
+
+public:
+
+  /**
+   * @brief Kinds of texts in the index.
+   */
+  enum class EntryKind {
+    STRING,           /**< Value of a string. */
+    DIALOG_TEXT,      /**< Text of a dialog. */
+    DIALOG_PROPERTY   /**< Value of a dialog property. */
+  };
+
+  /**
+   * @brief A text of a language.
+   */
+  struct Entry {
+
+    QString language_id;          /**< Language of the text. */
+    EntryKind kind;               /**< Where the text comes from. */
+    QString id;                   /**< String key or dialog id. */
+    QString property_key;         /**< Property name
+                                   * (only for EntryKind::DIALOG_PROPERTY). */
+    QString text;                 /**< The text itself. */
+
+  };
+
+  /**
+   * @brief Texts of a language read in a worker thread.
+   */
+  struct LanguageTexts {
+
+    QString language_id;          /**< The language. */
+    QList<Entry> entries;         /**< Strings, dialog texts and properties
+                                   * that could be read. */
+    QList<QStringList> tokens;    /**< Words of each entry. */
+
+  };
+
+  explicit QuestTextIndex(Quest& quest);
+  ~QuestTextIndex();
+
+  bool is_building() const;
+  int get_num_entries() const;
+
+  QList<Entry> search(const QString& query, const QString& language_id = QString()) const;
+
+  void watch_strings_model(const StringsModel& model);
+  void watch_dialogs_model(const DialogsModel& model);
+
+  static QStringList tokenize(const QString& text);
+  static LanguageTexts read_language(
+      const QString& language_id,
+      const QString& strings_path,
+      const QString& dialogs_path);
+
+signals:
+
+  void index_changed();
+  void build_finished();
+
+public slots:
+
+  void rebuild();
+
+private slots:
+
+  void reload();
+  void language_read(int result_index);
+  void build_finished_in_worker();
+  void language_element_added(ResourceType type, const QString& id);
+  void language_element_removed(ResourceType type, const QString& id);
+  void language_element_renamed(
+      ResourceType type, const QString& old_id, const QString& new_id);
+  void model_destroyed(QObject* model);
+
+  void string_created(const QString& key);
+  void string_deleted(const QString& key);
+  void string_key_changed(const QString& key, const QString& new_key);
+  void string_value_changed(const QString& key, const QString& value);
+
+  void dialog_created(const QString& id);
+  void dialog_deleted(const QString& id);
+  void dialog_id_changed(const QString& id, const QString& new_id);
+  void dialog_text_changed(const QString& id, const QString& text);
+  void dialog_property_created(
+      const QString& id, const QString& key, const QString& value);
+  void dialog_property_deleted(const QString& id, const QString& key);
+  void dialog_property_changed(
+      const QString& id, const QString& key, const QString& value);
+
+private:
+
+  void cancel_build();
+  void clear();
+  void read_languages(const QStringList& language_ids);
+  void reload_language(const QString& language_id);
+  void set_language_texts(const LanguageTexts& texts);
+  void remove_language(const QString& language_id);
+  void set_entry(const Entry& entry, const QStringList& tokens);
+  void set_entry(const Entry& entry);
+  void remove_entry(const QString& entry_key);
+  void remove_group(const QString& group_key);
+  void index_string_from_model(const StringsModel& model, const QString& key);
+  void index_dialog_from_model(const DialogsModel& model, const QString& id);
+  bool is_followed(const QString& language_id, EntryKind kind) const;
+  QVector<int> find_prefix(const QString& prefix) const;
+  QVector<int> find_word(const QString& word) const;
+
+  Quest& quest;                   /**< The quest indexed. */
+  QVector<Entry> entries;         /**< All texts. Removed texts leave empty
+                                   * slots that are reused later. */
+  QVector<int> free_slots;        /**< Indexes of unused slots in entries. */
+  QHash<QString, int>
+      entry_slots;                /**< Slot of each text, by entry key. */
+  QHash<QString, QVector<int>>
+      group_slots;                /**< Slots of the texts of each string or
+                                   * dialog, by group key. */
+  QMap<QString, QVector<int>>
+      postings;                   /**< Sorted slots of the texts containing
+                                   * each word. Words are sorted to allow
+                                   * prefix queries. */
+  QHash<const QObject*, QString>
+      followed_strings;           /**< Language of each strings model
+                                   * followed. */
+  QHash<const QObject*, QString>
+      followed_dialogs;           /**< Language of each dialogs model
+                                   * followed. */
+  QFutureWatcher<LanguageTexts>
+      build_watcher;              /**< Monitors language files being read in
+                                   * background threads. */
+  QStringList pending_languages;  /**< Languages to read again when the
+                                   * current build is finished. */
+
+};
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_SKYLINE_PACKER_H
+#define SOLARUSEDITOR_SKYLINE_PACKER_H
+
+#include <QPoint>
+#include <QSize>
+#include <vector>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Places rectangles in a bin of fixed width, as low as possible.
+ *
+ * The bin has a fixed width and grows downwards as needed.
+ * The packer keeps the skyline of the rectangles already placed,
+ * that is the list of their top-most free edges, and puts each new rectangle
+ * at the position where its bottom edge is the highest (bottom-left rule).
+ *
+ * For better results, insert rectangles sorted by decreasing height.
+ */
+class SkylinePacker {
+
+public:
+
+  explicit SkylinePacker(int width);
+
+  int get_width() const;
+  int get_height() const;
+
+  QPoint insert(const QSize& size);
+
+private:
+
+  /**
+   * @brief A horizontal part of the skyline.
+   */
+  struct Segment {
+    int x;          /**< X coordinate of the left edge. */
+    int y;          /**< Y coordinate of the free space above the segment. */
+    int width;      /**< Width of the segment. */
+  };
+
+  int get_fit_y(int segment_index, int width) const;
+  void add_segment(int segment_index, const QPoint& position, const QSize& size);
+
+  int width;                      /**< Width of the bin. */
+  int height;                     /**< Height used so far. */
+  std::vector<Segment> skyline;   /**< Segments ordered by x coordinate. */
+
+};
+
+}
+
+#endif
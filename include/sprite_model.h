@@ -91,6 +91,28 @@ public:
     int direction_nb;       /**< Direction number of this index. */
   };
 
+  /**
+   * @brief A frame of a direction: a part of the animation image.
+   *
+   * The pixmap is the whole animation image, shared by all frames.
+   * Draw the frame with QPainter::drawPixmap() using rect as source.
+   */
+  struct Frame {
+
+  public:
+
+    /**
+     * @brief Returns whether this frame has no image.
+     * @return \c true if this frame has no image.
+     */
+    bool is_null() const {
+      return pixmap.isNull() || rect.isEmpty();
+    }
+
+    QPixmap pixmap;         /**< Image of the whole animation. */
+    QRect rect;             /**< Area of the frame in the pixmap. */
+  };
+
   // Creation.
   SpriteModel(const Quest& quest, const QString& sprite_id, QObject* parent = nullptr);
 
@@ -159,11 +181,13 @@ public:
 
   // Images.
   QImage get_animation_image(const Index& index) const;
-  QList<QPixmap> get_direction_all_frames(const Index& index) const;
-  QPixmap get_direction_first_frame(const Index& index) const;
-  QPixmap get_direction_frame(const Index& index, int frame) const;
+  QPixmap get_animation_pixmap(const Index& index) const;
+  QList<Frame> get_direction_all_frames(const Index& index) const;
+  Frame get_direction_first_frame(const Index& index) const;
+  Frame get_direction_frame(const Index& index, int frame) const;
   QPixmap get_direction_icon(const Index& index) const;
   QPixmap get_icon() const;
+  static QImage create_icon_image(const QImage& frame_image);
 
   // Selection.
   QItemSelectionModel& get_selection_model();
@@ -217,12 +241,10 @@ private:
      * @brief Clears the image cache of this direction.
      */
     void set_image_dirty() const {
-      frames.clear();
       icon = QPixmap();
     }
 
     std::shared_ptr<Index> index;   /**< Index of the direction. */
-    mutable QList<QPixmap> frames;  /**< All frames of the direction. */
     mutable QPixmap icon;           /**< 32x32 icon of the direction. */
   };
 
@@ -256,6 +278,7 @@ private:
      */
     void set_image_dirty() const {
       image = QImage();
+      pixmap = QPixmap();
       for (const auto& direction: directions) {
         direction.set_image_dirty();
       }
@@ -264,9 +287,12 @@ private:
     std::shared_ptr<Index> index;     /**< Index of the animation. */
     QList<DirectionModel> directions; /**< Directions of the animation. */
     mutable QImage image;             /**< Image of the animation. */
+    mutable QPixmap pixmap;           /**< Image of the animation shared by
+                                       * all frames for drawing. */
   };
 
   void build_index_map();
+  QString get_animation_image_path(const Index& index) const;
 
   void set_animation_image_dirty(const Index& index);
   void set_direction_image_dirty(const Index& index);
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_SPRITE_SHEET_DETECTOR_H
+#define SOLARUSEDITOR_SPRITE_SHEET_DETECTOR_H
+
+#include <QImage>
+#include <QList>
+#include <QRect>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Finds the frames of a sprite sheet from the transparency of its image.
+ *
+ * Sprites are detected as connected components of non-transparent pixels,
+ * labeled with a two-pass union-find over the scanlines of the image.
+ * Components whose bounding boxes overlap are considered as parts of the same
+ * sprite.
+ * The detector then infers the uniform grid the sprites are aligned on,
+ * which gives the frames of a sprite animation direction.
+ *
+ * Images without alpha channel use the color of the top-left pixel of the
+ * area as the transparent color.
+ */
+class SpriteSheetDetector {
+
+public:
+
+  /**
+   * @brief Frames of a direction detected in a sprite sheet.
+   */
+  struct Grid {
+
+    QRect first_frame;      /**< Position and size of the first frame. */
+    int num_frames;         /**< Number of frames. */
+    int num_columns;        /**< Number of frames per row. */
+    QPoint origin;          /**< Origin point relative to each frame. */
+
+    bool is_valid() const;
+
+  };
+
+  explicit SpriteSheetDetector(const QImage& image);
+
+  QList<QRect> find_sprites(const QRect& area) const;
+  Grid detect_grid(const QRect& area) const;
+
+private:
+
+  QImage image;             /**< The sprite sheet, in ARGB32 format. */
+  bool has_alpha;           /**< Whether the original image has an alpha
+                             * channel. */
+
+};
+
+}
+
+#endif
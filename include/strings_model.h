@@ -21,7 +21,9 @@
 
 #include <solarus/StringResources.h>
 #include <QAbstractItemModel>
+#include <QFutureWatcher>
 #include <QItemSelectionModel>
+#include <QMap>
 
 namespace SolarusEditor {
 
@@ -41,6 +43,19 @@ class StringsModel : public QAbstractItemModel {
 
 public:
 
+  /**
+   * @brief A translation file parsed in a worker thread.
+   */
+  struct TranslationData {
+
+    QString language_id;          /**< Language of the translation. */
+    QString path;                 /**< The strings data file. */
+    bool valid;                   /**< Whether the file could be parsed. */
+    Solarus::StringResources
+        resources;                /**< The translated strings. */
+
+  };
+
   // Creation.
   StringsModel(
       const Quest& quest, const QString& language_id,
@@ -84,6 +99,7 @@ public:
       const QString& old_prefix, const QString& new_prefix);
   void delete_string(const QString& key);
   QList<QPair<QString, QString>> delete_prefix(const QString& prefix);
+  QMap<QString, QString> set_strings(const QMap<QString, QString>& values);
 
   // Selection.
   QItemSelectionModel& get_selection_model();
@@ -94,6 +110,7 @@ public:
 
   // Translation.
   QString get_translation_id() const;
+  bool is_loading_translation() const;
   void set_translation_id(const QString &language_id);
   void clear_translation();
   void reload_translation();
@@ -113,14 +130,23 @@ signals:
 
   void set_value_requested(const QString& key, const QString& value);
 
+  void translation_changed();
+  void translation_load_failed(const QString& message);
+
 public slots:
 
   void save() const;
 
+private slots:
+
+  void translation_loaded();
+
 private:
 
   void build_string_tree();
   void clear_translation_from_tree();
+  void set_translation_resources(const Solarus::StringResources& resources);
+  void set_missing_translation(const QString& key, bool missing);
 
   const Quest& quest;             /**< The quest the strings belongs to. */
   const QString language_id;      /**< Language of the strings. */
@@ -133,6 +159,9 @@ private:
   QString translation_id;
   Solarus::StringResources translation_resources;
 
+  QFutureWatcher<TranslationData>
+    translation_watcher;          /**< Parses the translation file. */
+
   QItemSelectionModel
     selection_model;              /**< String currently selected. */
 };
@@ -22,10 +22,18 @@
 #include "pattern_separation.h"
 #include <solarus/entities/TilesetData.h>
 #include <QAbstractItemModel>
+#include <QBitArray>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QImage>
 #include <QItemSelectionModel>
 #include <QList>
+#include <QMap>
 #include <QPixmap>
+#include <QRegion>
+#include <QSet>
+#include <QTimer>
 #include <map>
 
 namespace SolarusEditor {
@@ -54,6 +62,7 @@ public:
   // Creation.
   TilesetModel(
       Quest& quest, const QString& tileset_id, QObject* parent = nullptr);
+  ~TilesetModel();
 
   Quest& get_quest();
   QString get_tileset_id() const;
@@ -71,11 +80,17 @@ public:
   int id_to_index(const QString& pattern_id) const;
   QString index_to_id(int index) const;
   int create_pattern(const QString& pattern_id, const QRect& frame);
+  QList<int> create_patterns(const QMap<QString, QRect>& frames);
   void delete_pattern(int index);
   void delete_patterns(const QList<int>& indexes);
   int set_pattern_id(int index, const QString& new_id);
+  void set_pattern_ids(const QMap<QString, QString>& new_ids);
   static bool is_valid_pattern_id(const QString& pattern_id);
 
+  int get_pattern_usage(int index) const;
+  QString get_pattern_usage_tooltip(int index) const;
+  QList<int> get_unused_pattern_indexes() const;
+
   bool is_pattern_multi_frame(int index) const;
   int get_pattern_num_frames(int index) const;
   QRect get_pattern_frame(int index) const;
@@ -101,7 +116,14 @@ public:
   QPixmap get_pattern_image(int index) const;
   QPixmap get_pattern_image_all_frames(int index) const;
   QPixmap get_pattern_icon(int index) const;
+  void request_pattern_icons(int first_index, int last_index) const;
+  bool is_pattern_opaque(int index) const;
   QImage get_patterns_image() const;
+  void set_patterns_image(const QImage& patterns_image);
+  bool is_patterns_image_modified() const;
+  QImage build_packed_patterns_image(QList<QPoint>& positions) const;
+  QList<QList<int>> find_duplicate_patterns(int tolerance) const;
+  QList<QRect> find_unused_image_areas(const QSize& cell_size, bool merge_connected) const;
 
   // Selected patterns.
   QItemSelectionModel& get_selection_model();
@@ -111,6 +133,8 @@ public:
   QList<int> get_selected_indexes() const;
   void set_selected_index(int index);
   void set_selected_indexes(const QList<int>& indexes);
+  QStringList get_selected_ids() const;
+  void set_selected_ids(const QStringList& pattern_ids);
   void add_to_selected(int index);
   void add_to_selected(const QList<int>& index);
   bool is_selected(int index) const;
@@ -131,10 +155,28 @@ signals:
   void pattern_repeat_mode_changed(int index, TilePatternRepeatMode repeat_mode);
   void pattern_animation_changed(int index, PatternAnimation animation);
   void pattern_separation_changed(int index, PatternSeparation separation);
+  void patterns_image_changed();
+  void patterns_image_region_changed(const QRegion& region);
 
 public slots:
 
   void save() const;
+  bool reload_patterns_image();
+
+private slots:
+
+  void pattern_usage_changed(const QString& tileset_id);
+  void index_build_finished();
+  void emit_pattern_usage_changed();
+  void patterns_image_file_changed(const QString& path);
+  void patterns_image_directory_changed();
+  void update_selection_cache(
+      const QItemSelection& selected, const QItemSelection& deselected);
+  void invalidate_selection_cache();
+  void start_loading_icons();
+  void icon_loaded(int result_index);
+  void icons_loading_finished();
+  void emit_icons_changed();
 
 private:
 
@@ -150,7 +192,9 @@ private:
      * @param id Id of the tile pattern to represent.
      */
     PatternModel(const QString& id) :
-      id(id) {
+      id(id),
+      opacity_known(false),
+      opaque(false) {
     }
 
     /**
@@ -160,6 +204,7 @@ private:
       image = QPixmap();
       image_all_frames = QPixmap();
       icon = QPixmap();
+      opacity_known = false;
     }
 
     QString id;                   /**< String id of the pattern. */
@@ -171,14 +216,50 @@ private:
                                    * with all frames for multi-frame
                                    * patterns. */
     mutable QPixmap icon;         /**< 32x32 icon of the pattern. */
+    mutable bool opacity_known;   /**< Whether opaque is up to date. */
+    mutable bool opaque;          /**< Whether all pixels of all frames
+                                   * are fully opaque. */
   };
 
+  /**
+   * @brief An icon built in a worker thread.
+   */
+  struct IconResult {
+    QString pattern_id;           /**< Pattern of the icon. */
+    QRect frame;                  /**< Frame of the pattern used. */
+    int image_generation;         /**< Version of the patterns image used. */
+    QImage patterns_image;        /**< The patterns image used. */
+    QImage icon;                  /**< The icon built. */
+  };
+
+  static IconResult build_icon_in_worker(const IconResult& request);
+
   void build_index_map();
+  QItemSelection make_selection(const QList<int>& indexes) const;
+  void build_selection_cache() const;
+  void rebuild_pattern_models();
+  void queue_pattern_icon(int index) const;
+  QString get_icon_cache_file_path() const;
+  QImage get_cached_icon(const QRect& frame) const;
+  void load_icon_cache() const;
+  void save_icon_cache();
+  bool watch_patterns_image_file();
 
   Quest& quest;                   /**< The quest the tileset belongs to. */
   const QString tileset_id;       /**< Id of the tileset. */
   Solarus::TilesetData tileset;   /**< Tileset data wrapped by this model. */
   QImage patterns_image;          /**< PNG image of all tile patterns. */
+  mutable bool
+      patterns_image_modified;    /**< Whether the patterns image was changed
+                                   * in the editor and needs to be saved. */
+  QFileSystemWatcher
+      image_file_watcher;         /**< Detects changes of the tileset image
+                                   * and its directory made by external
+                                   * tools. */
+  QTimer image_reload_timer;      /**< Waits for the image file to be
+                                   * completely written before reloading. */
+  QTimer pattern_usage_timer;     /**< Groups notifications of pattern usage
+                                   * changes. */
 
   std::map<QString, int, NaturalComparator>
       ids_to_indexes;             /**< Index in the list of each pattern.
@@ -188,6 +269,41 @@ private:
 
   QItemSelectionModel
       selection_model;            /**< Patterns currently selected. */
+  mutable QBitArray
+      selected_flags;             /**< Whether each pattern is selected. */
+  mutable int num_selected;       /**< Number of bits set in selected_flags. */
+  mutable bool
+      selection_cache_valid;      /**< Whether selected_flags and num_selected
+                                   * are up to date. */
+
+  QPixmap icon_placeholder;       /**< Icon shown while the real one is
+                                   * being built. */
+  int image_generation;           /**< Incremented when the patterns image
+                                   * changes, to ignore outdated icons. */
+  mutable QSet<QString>
+      icons_to_load;              /**< Patterns whose icon is requested but
+                                   * not being built yet. */
+  mutable QTimer
+      icon_request_timer;         /**< Groups icon requests in a batch. */
+  QFutureWatcher<IconResult>
+      icon_watcher;               /**< Monitors icons being built in worker
+                                   * threads. */
+  QTimer icons_changed_timer;     /**< Groups dataChanged() notifications
+                                   * of icons built. */
+  int first_icon_changed;         /**< First row to notify or -1. */
+  int last_icon_changed;          /**< Last row to notify or -1. */
+  mutable bool
+      icon_cache_loaded;          /**< Whether the icon cache file was read
+                                   * for the current patterns image. */
+  mutable QString
+      icon_cache_key;             /**< Path, date and size of the patterns
+                                   * image file, or an empty string if the
+                                   * image is not saved. */
+  mutable QHash<QString, QImage>
+      cached_icons;               /**< Icons persisted on disk for this
+                                   * patterns image, indexed by frame. */
+  mutable bool
+      icon_cache_dirty;           /**< Whether new icons need to be saved. */
 
 };
 
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_TRANSLATION_EXCHANGE_H
+#define SOLARUSEDITOR_TRANSLATION_EXCHANGE_H
+
+#include <QList>
+#include <QSaveFile>
+#include <QString>
+#include <QTextStream>
+#include <QXmlStreamWriter>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Reading and writing of strings and dialogs in the file formats
+ * used by translators.
+ *
+ * The following formats are supported, chosen from the file extension:
+ * - CSV (.csv) with columns id, source and target,
+ * - XLIFF 1.2 (.xlf or .xliff),
+ * - gettext PO (.po), where the id is stored as the message context.
+ */
+namespace TranslationExchange {
+
+/**
+ * @brief Supported file formats.
+ */
+enum class Format {
+  CSV,
+  XLIFF,
+  PO
+};
+
+/**
+ * @brief A text to translate.
+ */
+struct Unit {
+
+  QString id;                     /**< String key or dialog id. */
+  QString source;                 /**< Text in the reference language. */
+  QString target;                 /**< Text in the translated language,
+                                   * empty if not translated yet. */
+
+};
+
+Format get_format(const QString& path);
+QString get_file_filters();
+
+QList<Unit> read_file(const QString& path);
+
+/**
+ * @brief Writes texts to translate to a file, one at a time.
+ *
+ * Units are written as they come, so that exporting does not need to build
+ * the whole file in memory.
+ * The file is only replaced when commit() succeeds.
+ */
+class Writer {
+
+public:
+
+  Writer(const QString& path,
+         const QString& source_language_id,
+         const QString& target_language_id,
+         const QString& original_file_name);
+
+  void write_unit(const Unit& unit);
+  void commit();
+
+  int get_num_units() const;
+
+private:
+
+  Format format;                  /**< Format of the file. */
+  QSaveFile file;                 /**< The file being written. */
+  QTextStream stream;             /**< Text output for CSV and PO. */
+  QXmlStreamWriter xml;           /**< XML output for XLIFF. */
+  int num_units;                  /**< Number of units written so far. */
+
+};
+
+}
+
+}
+
+#endif
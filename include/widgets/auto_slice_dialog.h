@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_AUTO_SLICE_DIALOG_H
+#define SOLARUSEDITOR_AUTO_SLICE_DIALOG_H
+
+#include "ground_traits.h"
+#include "ui_auto_slice_dialog.h"
+#include <QDialog>
+
+namespace SolarusEditor {
+
+/**
+ * @brief A dialog to choose how to create patterns automatically from the
+ * tileset image.
+ */
+class AutoSliceDialog : public QDialog {
+  Q_OBJECT
+
+public:
+
+  explicit AutoSliceDialog(QWidget* parent = nullptr);
+
+  QSize get_cell_size() const;
+  void set_cell_size(const QSize& cell_size);
+
+  Ground get_ground() const;
+  void set_ground(Ground ground);
+
+  bool get_merge_connected() const;
+  void set_merge_connected(bool merge_connected);
+
+private:
+
+  Ui::AutoSliceDialog ui;         /**< The widgets. */
+
+};
+
+}
+
+#endif
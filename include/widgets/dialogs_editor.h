@@ -19,6 +19,7 @@
 
 #include "widgets/editor.h"
 #include "ui_dialogs_editor.h"
+#include <QMap>
 
 namespace SolarusEditor {
 
@@ -75,15 +76,29 @@ public slots:
 
   void translation_selector_activated();
   void translation_refresh_requested();
+  void update_translation();
+  void translation_load_failed(const QString& message);
+
+  void export_requested();
+  void import_requested();
+  void update_exchange_buttons();
 
   void update_display_margin();
 
+  void dialog_id_changed(const QString& id, const QString& new_id);
+  void dialog_deleted(const QString& id);
+
 private:
 
+  void update_dialog_references(const QMap<QString, QString>& new_ids);
+
   Ui::DialogsEditor ui;      /**< The dialogs editor widgets. */
   QString language_id;       /**< Id of the language of dialogs being edited. */
   DialogsModel* model;       /**< Dialogs model being edited. */
   Quest& quest;              /**< The quest. */
+  QMap<QString, QString>
+      renamed_ids;           /**< Current id of dialogs renamed since the
+                              * last save, indexed by their saved id. */
 
 };
 
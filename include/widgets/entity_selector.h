@@ -52,6 +52,10 @@ public slots:
 
   void build();
 
+private slots:
+
+  void index_build_finished();
+
 private:
 
   using SpecialValue = QPair<QString, QString>;   // Name and text.
@@ -24,12 +24,15 @@
 #include <solarus/gui/quest_runner.h>
 #include <QMainWindow>
 
+class QDockWidget;
 class QToolButton;
 
 namespace SolarusEditor {
 
 class Editor;
 class PairSpinBox;
+class QuestCheckerPanel;
+class QuestTextSearchPanel;
 
 using EntityType = Solarus::EntityType;
 
@@ -75,12 +78,16 @@ private slots:
   void on_action_show_layer_0_triggered();
   void on_action_show_layer_1_triggered();
   void on_action_show_layer_2_triggered();
+  void on_action_check_quest_triggered();
   void on_action_settings_triggered();
   void on_action_website_triggered();
   void on_action_doc_triggered();
 
   void current_editor_changed(int index);
   void rename_file_requested(Quest& quest, const QString& path);
+  void show_quest_issue(const QString& path, const EntityIndex& entity_index);
+  void show_text_entry(
+      const QString& path, const QString& id, const QString& property_key);
   void update_zoom();
   void update_grid_visibility();
   void update_grid_size();
@@ -151,6 +158,12 @@ private:
       common_actions;             /**< Actions available to all editors. */
 
   SettingsDialog settings_dialog; /**< The settings dialog. */
+  QDockWidget* checker_dock;      /**< Dock widget of the quest checker. */
+  QuestCheckerPanel*
+      checker_panel;              /**< Problems found in the quest. */
+  QDockWidget* search_dock;       /**< Dock widget of the text search. */
+  QuestTextSearchPanel*
+      search_panel;               /**< Search in strings and dialogs. */
 
 };
 
@@ -38,6 +38,7 @@ public:
 
   MapModel& get_map();
   MapView& get_map_view();
+  void show_entity(const EntityIndex& index);
 
   void save() override;
   bool can_cut() const override;
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_QUEST_CHECKER_PANEL_H
+#define SOLARUSEDITOR_QUEST_CHECKER_PANEL_H
+
+#include "quest_checker.h"
+#include <QWidget>
+
+class QLabel;
+class QProgressBar;
+class QPushButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+namespace SolarusEditor {
+
+/**
+ * @brief A panel that checks the quest and lists the problems found.
+ *
+ * Double-clicking a problem asks to open the file concerned.
+ */
+class QuestCheckerPanel : public QWidget {
+  Q_OBJECT
+
+public:
+
+  QuestCheckerPanel(Quest& quest, QWidget* parent = nullptr);
+
+signals:
+
+  void issue_activated(const QString& path, const EntityIndex& entity_index);
+
+public slots:
+
+  void start();
+
+private slots:
+
+  void check_started();
+  void progress_changed(int num_files_checked, int num_files);
+  void issues_found(const QList<QuestChecker::Issue>& issues);
+  void check_finished();
+  void item_activated(QTreeWidgetItem* item);
+
+private:
+
+  void update_summary();
+
+  Quest& quest;                   /**< The quest checked. */
+  QuestChecker checker;           /**< Checks files in worker threads. */
+  QList<QuestChecker::Issue>
+      issues;                     /**< Problems found so far. */
+  int num_errors;                 /**< Number of errors found so far. */
+  QPushButton* check_button;      /**< Starts or stops the check. */
+  QProgressBar* progress_bar;     /**< Progress of the check. */
+  QLabel* summary_label;          /**< Number of problems found. */
+  QTreeWidget* tree_widget;       /**< One item per problem. */
+
+};
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_QUEST_TEXT_SEARCH_PANEL_H
+#define SOLARUSEDITOR_QUEST_TEXT_SEARCH_PANEL_H
+
+#include "quest_text_index.h"
+#include <QWidget>
+
+class QLabel;
+class QLineEdit;
+class QTimer;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+namespace SolarusEditor {
+
+class ResourceSelector;
+
+/**
+ * @brief A panel that searches words in strings and dialogs of all
+ * languages.
+ *
+ * Results are updated while typing, using the text index of the quest.
+ * Double-clicking a result asks to open the string or dialog concerned.
+ */
+class QuestTextSearchPanel : public QWidget {
+  Q_OBJECT
+
+public:
+
+  QuestTextSearchPanel(Quest& quest, QWidget* parent = nullptr);
+
+signals:
+
+  void entry_activated(
+      const QString& path, const QString& id, const QString& property_key);
+
+public slots:
+
+  void update_results();
+
+protected:
+
+  virtual void showEvent(QShowEvent* event) override;
+
+private slots:
+
+  void index_changed();
+  void item_activated(QTreeWidgetItem* item);
+
+private:
+
+  Quest& quest;                   /**< The quest searched. */
+  QList<QuestTextIndex::Entry>
+      results;                    /**< Texts found by the last search. */
+  QLineEdit* query_field;         /**< Words to search. */
+  ResourceSelector*
+      language_field;             /**< Language to search in. */
+  QLabel* summary_label;          /**< Number of texts found. */
+  QTreeWidget* tree_widget;       /**< One item per text found. */
+  QTimer* update_timer;           /**< Delays updates after index changes. */
+
+};
+
+}
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_REFACTORING_DIALOG_H
+#define SOLARUSEDITOR_REFACTORING_DIALOG_H
+
+#include "quest_refactoring.h"
+#include <QDialog>
+
+class QTreeWidget;
+
+namespace SolarusEditor {
+
+/**
+ * @brief A dialog that previews changes of a refactoring.
+ *
+ * Each change is shown with a check box so that the user can choose the
+ * ones to apply.
+ * Changes coming from a textual search in scripts are unchecked by default.
+ */
+class RefactoringDialog : public QDialog {
+  Q_OBJECT
+
+public:
+
+  RefactoringDialog(
+      const QString& message,
+      const QList<QuestRefactoring::Change>& changes,
+      QWidget* parent = nullptr);
+
+  QList<QuestRefactoring::Change> get_selected_changes() const;
+
+private:
+
+  QList<QuestRefactoring::Change> changes;  /**< All changes proposed. */
+  QTreeWidget* tree_widget;                 /**< One item per change. */
+
+};
+
+}
+
+#endif
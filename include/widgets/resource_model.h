@@ -18,8 +18,12 @@
 #define SOLARUSEDITOR_RESOURCE_MODEL_H
 
 #include <solarus/ResourceType.h>
+#include <QFutureWatcher>
+#include <QImage>
 #include <QMap>
+#include <QSet>
 #include <QStandardItemModel>
+#include <QTimer>
 
 namespace SolarusEditor {
 
@@ -37,6 +41,7 @@ class ResourceModel : public QStandardItemModel {
 public:
 
   ResourceModel(const Quest& quest, ResourceType resource_type, QObject* parent = nullptr);
+  ~ResourceModel();
 
   const Quest& get_quest() const;
   const QuestResources& get_resources() const;
@@ -61,9 +66,29 @@ private slots:
       ResourceType type, const QString& old_id, const QString& new_id);
   void element_description_changed(
       ResourceType type, const QString& id, const QString& new_description);
+  void start_loading_sprite_icons();
+  void sprite_icon_loaded(int result_index);
+  void sprite_icons_loading_finished();
 
 private:
 
+  /**
+   * @brief A sprite icon built in a worker thread.
+   */
+  struct SpriteIconJob {
+    QString sprite_id;            /**< Sprite of the icon. */
+    QString sprite_path;          /**< Sprite data file. */
+    QString sprite_images_path;   /**< Directory of sprite images. */
+    QString tileset_image_path;   /**< Entities image of the tileset to use
+                                   * for tileset-dependent sprites. */
+    QString cache_file_path;      /**< File where the icon is persisted. */
+    int generation;               /**< Value of icons_generation when the
+                                   * icon was requested. */
+    QImage icon;                  /**< The icon built, or a null image. */
+  };
+
+  static SpriteIconJob load_sprite_icon_in_worker(const SpriteIconJob& job);
+
   void add_element(const QString& element_id);
   void remove_element(const QString& element_id);
   QStandardItem* find_or_create_dir_item(
@@ -72,7 +97,8 @@ private:
   QStandardItem* create_element_item(const QString& element_id);
   const QStandardItem* get_element_item(const QString& element_id) const;
   QStandardItem* get_element_item(const QString& element_id);
-  QIcon create_icon(const QString& element_id) const;
+  QIcon get_resource_type_icon() const;
+  void queue_sprite_icon(const QString& element_id) const;
 
   const Quest& quest;             /**< The quest. */
   ResourceType resource_type;     /**< The resource type represented in the model. */
@@ -82,6 +108,18 @@ private:
       icons;                      /**< Mapping of item icons from element ids. */
   QIcon directory_icon;              /**< Icon for directory items. */
   QString tileset_id;             /**< Id of a tileset to use when showing sprite icon. */
+  mutable QSet<QString>
+      sprite_icons_to_load;       /**< Sprites whose icon is requested but
+                                   * not being built yet. */
+  mutable QSet<QString>
+      sprite_icons_loading;       /**< Sprites whose icon is being built. */
+  mutable QTimer
+      sprite_icon_request_timer;  /**< Groups icon requests in a batch. */
+  QFutureWatcher<SpriteIconJob>
+      sprite_icon_watcher;        /**< Monitors sprite icons being built
+                                   * in worker threads. */
+  int icons_generation;           /**< Incremented when icons are cleared,
+                                   * to ignore outdated results. */
 
 };
 
@@ -23,6 +23,8 @@
 
 namespace SolarusEditor {
 
+class QuestImageCache;
+
 /**
  * @brief A dialog to edit settings of the editor.
  */
@@ -33,6 +35,8 @@ public:
 
   SettingsDialog(QWidget *parent = nullptr);
 
+  void set_image_cache(const QuestImageCache* image_cache);
+
 public slots:
 
   void done(int result) override;
@@ -59,6 +63,9 @@ public slots:
   void change_video_acceleration();
   void update_quest_size();
   void change_quest_size();
+  void update_image_cache_size();
+  void change_image_cache_size();
+  void update_image_cache_statistics();
 
   // Text editor.
   void update_font_family();
@@ -112,6 +119,8 @@ private:
 
   EditorSettings settings;                  /**< The settings. */
   QMap<QString, QVariant> edited_settings;  /**< The edited settings. */
+  const QuestImageCache* image_cache;       /**< Image cache of the current
+                                             * quest or nullptr. */
 
 };
 
@@ -18,17 +18,24 @@
 #define SOLARUSEDITOR_SPRITE_PREVIEWER_H
 
 #include "ui_sprite_previewer.h"
+#include <QElapsedTimer>
 #include <QWidget>
 #include <QPointer>
 #include <QTimer>
-#include <QGraphicsPixmapItem>
 #include <QGraphicsLineItem>
 #include "sprite_model.h"
 
 namespace SolarusEditor {
 
+class FrameItem;
+
 /**
  * @brief A widget to preview animation directions of sprites.
+ *
+ * The previewer can play the selected direction, all directions of the
+ * selected animation or all directions of all animations side by side.
+ * Directions are then shown in a grid with one row per animation, and they
+ * are all animated by the same clock and timer.
  */
 class SpritePreviewer : public QWidget
 {
@@ -46,6 +53,7 @@ public:
 
 private slots:
 
+  void update_mode();
   void update_selection();
   void update_frame_delay();
 
@@ -53,6 +61,7 @@ private slots:
   void update_frames();
   void update_frame();
   void update_origin();
+  void update_frame_rate();
 
   void timeout();
 
@@ -69,18 +78,61 @@ private slots:
 
 private:
 
+  /**
+   * @brief What the previewer shows.
+   */
+  enum class PreviewMode {
+    DIRECTION,                  /**< The selected direction. */
+    ANIMATION,                  /**< All directions of the selected
+                                 * animation. */
+    SPRITE                      /**< All directions of all animations. */
+  };
+
+  /**
+   * @brief A direction displayed in the preview grid.
+   */
+  struct Cell {
+    SpriteModel::Index index;   /**< The direction. */
+    QList<SpriteModel::Frame>
+        frames;                 /**< Frames of the direction. */
+    int current_frame;          /**< Index of the current displayed frame. */
+    int frame_delay;            /**< Delay between frames in milliseconds,
+                                 * or 0 if the animation is not animated. */
+    qint64 next_frame_date;     /**< Date of the next frame on the clock,
+                                 * or -1 if the cell is not playing. */
+    FrameItem* item;            /**< Item of the displayed frame. */
+    QGraphicsLineItem* origin_h;  /**< Horizontal origin line. */
+    QGraphicsLineItem* origin_v;  /**< Vertical origin line. */
+  };
+
+  QList<QList<SpriteModel::Index>> get_previewed_directions() const;
+  bool is_showing(const QList<QList<SpriteModel::Index>>& rows) const;
+  void clear_cells();
+  bool start_cells();
+  void advance_cell(Cell& cell, qint64 now);
+  void pause();
+  void update_frame_label();
+  bool is_playing() const;
+  bool schedule_next_frame();
   void set_zoom(double zoom);
   QMenu* create_zoom_menu();
 
   Ui::SpritePreviewer ui;       /**< The widgets. */
   QPointer<SpriteModel> model;  /**< The sprite model. */
   SpriteModel::Index index;     /**< The selected index. */
-  QTimer timer;                 /**< The timer to animate the view. */
-  QList<QPixmap> frames;        /**< Frames of the current direction. */
-  int current_frame;            /**< Index of the current displayed frame. */
-  QGraphicsPixmapItem* item;    /**< Pixmap item of the displayed frame. */
-  QGraphicsLineItem* origin_h;  /**< Horizontal origin line. */
-  QGraphicsLineItem* origin_v;  /**< Vertical origin line. */
+  PreviewMode mode;             /**< What the previewer shows. */
+  QList<Cell> cells;            /**< Directions currently displayed. */
+  QColor origin_color;          /**< Color of origin lines. */
+  QTimer timer;                 /**< Wakes up when the next frame of a cell
+                                 * is due. */
+  QElapsedTimer clock;          /**< Monotonic clock of the playback,
+                                 * shared by all cells. */
+  int frame_delay;              /**< Smallest delay between frames of cells
+                                 * playing, in milliseconds. */
+  int num_frames_displayed;     /**< Frames actually displayed since the
+                                 * playback started. */
+  qint64 frame_rate_start_date; /**< Date when frames started to be
+                                 * counted. */
   QMap<double, QAction*>
       zoom_actions;             /**< Action of each zoom value. */
   double zoom;                  /**< Zoom factor currently applied. */
@@ -19,6 +19,7 @@
 
 #include "widgets/editor.h"
 #include "ui_strings_editor.h"
+#include <QMap>
 
 namespace SolarusEditor {
 
@@ -59,13 +60,26 @@ public slots:
 
   void translation_selector_activated();
   void translation_refresh_requested();
+  void translation_load_failed(const QString& message);
+
+  void export_requested();
+  void import_requested();
+  void update_exchange_buttons();
+
+  void string_key_changed(const QString& key, const QString& new_key);
+  void string_deleted(const QString& key);
 
 private:
 
+  void update_string_references(const QMap<QString, QString>& new_keys);
+
   Ui::StringsEditor ui;      /**< The strings editor widgets. */
   QString language_id;       /**< Id of the language of dialogs being edited. */
   StringsModel* model;       /**< Strings model being edited. */
   Quest& quest;              /**< The quest. */
+  QMap<QString, QString>
+      renamed_keys;          /**< Current key of strings renamed since the
+                              * last save, indexed by their saved key. */
 
 };
 
@@ -40,6 +40,18 @@ signals:
   void delete_selected_patterns_requested();
   void change_selected_pattern_id_requested();
 
+protected:
+
+  void resizeEvent(QResizeEvent* event) override;
+
+private slots:
+
+  void request_visible_icons();
+
+private:
+
+  TilesetModel* model;    /**< The tileset represented or nullptr. */
+
 };
 
 }
@@ -54,6 +54,7 @@ public slots:
 
   void update_pattern_view();
   void update_pattern_id_field();
+  void update_pattern_usage_field();
   void change_selected_pattern_position_requested(const QPoint& position);
   void update_ground_field();
   void ground_selector_activated();
@@ -73,6 +74,10 @@ public slots:
   void create_pattern_requested(
       const QString& pattern_id, const QRect& frame, Ground ground);
   void delete_selected_patterns_requested();
+  void delete_unused_patterns_requested();
+  void repack_image_requested();
+  void merge_duplicate_patterns_requested();
+  void auto_slice_requested();
   void change_selected_pattern_id_requested();
 
 private:
@@ -18,8 +18,10 @@
 #define SOLARUSEDITOR_TILESET_SCENE_H
 
 #include <QGraphicsScene>
+#include <QPixmap>
 
 class QItemSelection;
+class QRegion;
 
 namespace SolarusEditor {
 
@@ -55,20 +57,30 @@ private slots:
       const QItemSelection& selected, const QItemSelection& deselected);
   void set_selection_from_scene();
   void update_pattern_position(int index);
+  void update_patterns_image();
+  void update_patterns_image_region(const QRegion& region);
   void update_pattern_animation(int index);
   void pattern_created(int new_index, const QString& new_id);
   void pattern_deleted(int old_index, const QString& old_id);
   void pattern_id_changed(int old_index, const QString& old_id,
                           int new_index, const QString& new_id);
+  void patterns_reset();
 
 private:
 
   void build();
+  void build_background_chunks();
+
+  static constexpr int chunk_size = 256;  /**< Size of a background chunk. */
 
   TilesetModel& model;            /**< The tileset represented. */
   QList<PatternItem*>
       pattern_items;              /**< Each pattern item in the scene,
                                    * ordered as in the model. */
+  QList<QPixmap>
+      background_chunks;          /**< The tileset image cut in square
+                                   * pixmaps, row by row. */
+  int num_chunk_columns;          /**< Number of chunks in a row. */
 
 };
 
@@ -18,9 +18,30 @@
 #include "quest.h"
 #include "dialogs_model.h"
 #include <QIcon>
+#include <QtConcurrentRun>
 
 namespace SolarusEditor {
 
+namespace {
+
+/**
+ * @brief Parses a dialogs data file in a worker thread.
+ * @param language_id Language of the translation.
+ * @param path The dialogs data file.
+ * @return The translated dialogs.
+ */
+DialogsModel::TranslationData load_translation_in_worker(
+    const QString& language_id, const QString& path) {
+
+  DialogsModel::TranslationData data;
+  data.language_id = language_id;
+  data.path = path;
+  data.valid = data.resources.import_from_file(path.toStdString());
+  return data;
+}
+
+}
+
 using StringResources = Solarus::DialogResources;
 using DialogData = Solarus::DialogData;
 
@@ -48,6 +69,9 @@ DialogsModel::DialogsModel(
 
   // Create the indexed tree.
   build_dialog_tree();
+
+  connect(&translation_watcher, SIGNAL(finished()),
+          this, SLOT(translation_loaded()));
 }
 
 /**
@@ -131,16 +155,13 @@ QModelIndex DialogsModel::index(
     return QModelIndex();
   }
 
-  if (!parent.isValid()) {
-    return id_to_index(dialog_tree.get_row_key(row));
-  }
-
-  QString id = index_to_id(parent);
-  if (row >= dialog_tree.get_row_count(id)) {
+  QString* internal_key =
+      dialog_tree.get_row_internal_key(row, index_to_id(parent));
+  if (internal_key == nullptr) {
     return QModelIndex();
   }
 
-  return id_to_index(dialog_tree.get_row_key(row, id));
+  return createIndex(row, column, internal_key);
 }
 
 /**
@@ -417,6 +438,7 @@ void DialogsModel::create_dialog(const QString& id, const DialogData& data) {
     QModelIndex model_index = id_to_index(id);
     dataChanged(model_index, model_index);
   }
+  set_missing_translation(id, false);
 
   // Notify people.
   emit dialog_created(id);
@@ -610,6 +632,7 @@ QString DialogsModel::set_dialog_id(const QString& id, const QString& new_id) {
     QModelIndex model_index = id_to_index(id);
     dataChanged(model_index, model_index);
   }
+  set_missing_translation(id, translated_dialog_exists(id));
 
   // Add to the indexed tree.
   if (dialog_tree.add_key(new_id, parent_id, index)) {
@@ -621,6 +644,7 @@ QString DialogsModel::set_dialog_id(const QString& id, const QString& new_id) {
     QModelIndex model_index = id_to_index(id);
     dataChanged(model_index, model_index);
   }
+  set_missing_translation(new_id, false);
 
   // Notify people.
   emit dialog_id_changed(id, new_id);
@@ -727,6 +751,7 @@ void DialogsModel::delete_dialog(const QString& id) {
     QModelIndex model_index = id_to_index(id);
     dataChanged(model_index, model_index);
   }
+  set_missing_translation(id, translated_dialog_exists(id));
 
   // Notify people.
   emit dialog_deleted(id);
@@ -773,6 +798,115 @@ QList<QPair<QString, DialogData>> DialogsModel::delete_prefix(
   return list;
 }
 
+/**
+ * @brief Creates, changes or deletes the text of several dialogs at once.
+ *
+ * Unlike the functions that change one dialog, views are notified with
+ * a single layout change, which is much faster for many dialogs.
+ * Then, emits dialog_created(), dialog_text_changed() or dialog_deleted()
+ * for each dialog actually changed.
+ *
+ * New dialogs get the properties of the same dialog in the translation
+ * language if any.
+ * The existing selection is preserved if its dialog still exists.
+ *
+ * @param texts The new text of each dialog to change.
+ * A null text deletes the dialog.
+ * @return The previous text of each dialog actually changed,
+ * or a null text for dialogs that did not exist.
+ * Passing it to this function again cancels the changes.
+ */
+QMap<QString, QString> DialogsModel::set_dialog_texts(
+    const QMap<QString, QString>& texts) {
+
+  QMap<QString, QString> old_texts;
+  for (auto it = texts.begin(); it != texts.end(); ++it) {
+    const QString& id = it.key();
+    const bool exists = dialog_exists(id);
+    if (it.value().isNull()) {
+      if (exists) {
+        old_texts.insert(id, get_dialog_text(id));
+      }
+    }
+    else if (!exists) {
+      if (is_valid_id(id)) {
+        old_texts.insert(id, QString());
+      }
+    }
+    else if (get_dialog_text(id) != it.value()) {
+      old_texts.insert(id, get_dialog_text(id));
+    }
+  }
+
+  if (old_texts.isEmpty()) {
+    return old_texts;
+  }
+
+  // Save and clear the selection since a lot of indexes may change.
+  QString old_selection = get_selected_id();
+  clear_selection();
+
+  emit layoutAboutToBeChanged();
+
+  // Remember persistent indexes by id before nodes are destroyed.
+  const QModelIndexList old_indexes = persistentIndexList();
+  QStringList old_ids;
+  for (const QModelIndex& index : old_indexes) {
+    old_ids << index_to_id(index);
+  }
+
+  for (auto it = old_texts.begin(); it != old_texts.end(); ++it) {
+    const QString& id = it.key();
+    const QString& text = texts.value(id);
+    if (text.isNull()) {
+      resources.remove_dialog(id.toStdString());
+      dialog_tree.remove_key(id);
+      dialog_tree.set_flagged(id, translated_dialog_exists(id));
+    }
+    else if (it.value().isNull()) {
+      DialogData data;
+      if (translated_dialog_exists(id)) {
+        data = translation_resources.get_dialog(id.toStdString());
+      }
+      data.set_text(text.toStdString());
+      resources.add_dialog(id.toStdString(), data);
+      dialog_tree.add_key(id);
+      dialog_tree.set_flagged(id, false);
+    }
+    else {
+      resources.get_dialog(id.toStdString()).set_text(text.toStdString());
+    }
+  }
+
+  QModelIndexList new_indexes;
+  for (const QString& id : old_ids) {
+    new_indexes << id_to_index(id);
+  }
+  changePersistentIndexList(old_indexes, new_indexes);
+
+  emit layoutChanged();
+
+  // Notify people.
+  for (auto it = old_texts.begin(); it != old_texts.end(); ++it) {
+    const QString& id = it.key();
+    const QString& text = texts.value(id);
+    if (text.isNull()) {
+      emit dialog_deleted(id);
+    }
+    else if (it.value().isNull()) {
+      emit dialog_created(id);
+    }
+    else {
+      emit dialog_text_changed(id, text);
+    }
+  }
+
+  // Restore the selection.
+  set_selected_id(old_selection);
+
+  return old_texts;
+}
+
 /**
  * @brief Returns the selection model.
  * @return The selection info.
@@ -831,6 +965,18 @@ QString DialogsModel::get_translation_id() const {
   return translation_id;
 }
 
+/**
+ * @brief Returns whether the translation file is being parsed.
+ *
+ * Translated texts are not up to date until translation_changed() or
+ * translation_load_failed() is emitted.
+ *
+ * @return @c true if the translation is being loaded.
+ */
+bool DialogsModel::is_loading_translation() const {
+  return !translation_id.isEmpty() && translation_watcher.isRunning();
+}
+
 /**
  * @brief Changes the language of the current translation.
  * @param language_id The language id of the translation.
@@ -854,33 +1000,84 @@ void DialogsModel::clear_translation() {
   }
 
   translation_id = "";
-  clear_translation_from_tree();
-  translation_resources.clear();
+  set_translation_resources(Solarus::DialogResources());
 }
 
 /**
  * @brief Reload the current translation.
+ *
+ * The dialogs file is parsed in a worker thread.
+ * translation_changed() is emitted when the new translation is shown,
+ * or translation_load_failed() if the file cannot be parsed.
  */
 void DialogsModel::reload_translation() {
 
-  clear_translation_from_tree();
-
   QString path = quest.get_dialogs_path(translation_id);
-  translation_resources.clear();
-  if (!translation_resources.import_from_file(path.toStdString())) {
+  translation_watcher.setFuture(QtConcurrent::run(
+      load_translation_in_worker, translation_id, path));
+}
+
+/**
+ * @brief Slot called when the translation file was parsed.
+ */
+void DialogsModel::translation_loaded() {
+
+  const TranslationData data = translation_watcher.result();
+  if (data.language_id != translation_id) {
+    // The translation was changed or cleared in the meantime.
+    return;
+  }
+
+  if (!data.valid) {
     translation_id = "";
-    throw EditorException(tr("Cannot open dialogs data file '%1'").arg(path));
+    set_translation_resources(Solarus::DialogResources());
+    emit translation_load_failed(
+          tr("Cannot open dialogs data file '%1'").arg(data.path));
+    return;
+  }
+
+  set_translation_resources(data.resources);
+}
+
+/**
+ * @brief Replaces the translated dialogs.
+ *
+ * The indexed tree is updated in a single layout change rather than with
+ * a row insertion or removal for each id, and persistent indexes like the
+ * selection or the expanded items of views are kept.
+ *
+ * @param resources The new translated dialogs.
+ */
+void DialogsModel::set_translation_resources(
+    const Solarus::DialogResources& resources) {
+
+  emit layoutAboutToBeChanged();
+
+  // Remember persistent indexes by id before nodes are destroyed.
+  const QModelIndexList old_indexes = persistentIndexList();
+  QStringList old_ids;
+  for (const QModelIndex& index : old_indexes) {
+    old_ids << index_to_id(index);
   }
 
+  clear_translation_from_tree();
+  translation_resources = resources;
   for (const auto& kvp : translation_resources.get_dialogs()) {
     QString id = QString::fromStdString(kvp.first);
     QString parent_id;
     int index;
-    if (dialog_tree.add_ref(id, parent_id, index)) {
-      beginInsertRows(id_to_index(parent_id), index, index);
-      endInsertRows();
-    }
+    dialog_tree.add_ref(id, parent_id, index);
+    dialog_tree.set_flagged(id, !dialog_exists(id));
+  }
+
+  QModelIndexList new_indexes;
+  for (const QString& id : old_ids) {
+    new_indexes << id_to_index(id);
   }
+  changePersistentIndexList(old_indexes, new_indexes);
+
+  emit layoutChanged();
+  emit translation_changed();
 }
 
 /**
@@ -965,22 +1162,16 @@ QStringList DialogsModel::get_translated_ids(const QString& prefix) const {
 
 /**
  * @brief Returns whether dialog or sub dialog has translation and don't exists.
+ *
+ * Missing translations are flagged in the indexed tree,
+ * so this is a constant-time operation.
+ *
  * @param id The id of the dialog.
  * @return @c true if the dialog or sub dialog has tanslation and don't exists.
  */
 bool DialogsModel::has_missing_translation(const QString& id) const {
 
-  if (!dialog_exists(id) && translated_dialog_exists(id)) {
-    return true;
-  }
-
-  Q_FOREACH (QString sub_id, get_translated_ids(id + ".")) {
-    if (!dialog_exists(sub_id)) {
-      return true;
-    }
-  }
-
-  return false;
+  return dialog_tree.get_num_flagged(id) > 0;
 }
 
 /**
@@ -997,24 +1188,37 @@ void DialogsModel::build_dialog_tree() {
 
 /**
  * @brief Removes all translated dialogs from the indexed tree.
+ *
+ * No signal is emitted: this is done by set_translation_resources().
  */
 void DialogsModel::clear_translation_from_tree() {
 
   for (const auto& kvp : translation_resources.get_dialogs()) {
     QString id = QString::fromStdString(kvp.first);
-    QString parent_id;
-    int index;
-    if (dialog_tree.can_remove_ref(id, parent_id, index)) {
-      if (!dialog_exists(id)) {
-        beginRemoveRows(id_to_index(parent_id), index, index);
-        dialog_tree.remove_ref(id, false);
-        endRemoveRows();
-      } else {
-        dialog_tree.remove_ref(id, true);
-      }
-    } else {
-      dialog_tree.remove_ref(id, dialog_exists(id));
-    }
+    dialog_tree.set_flagged(id, false);
+    dialog_tree.remove_ref(id, dialog_exists(id));
+  }
+}
+
+/**
+ * @brief Flags or unflags a dialog as a missing translation in the indexed tree.
+ *
+ * Emits dataChanged() for the dialog and its parents if their icon changes.
+ *
+ * @param id The id of the dialog.
+ * @param missing @c true if the dialog is translated but does not exist.
+ */
+void DialogsModel::set_missing_translation(const QString& id, bool missing) {
+
+  if (!dialog_tree.set_flagged(id, missing)) {
+    return;
+  }
+
+  QString parent_id = id;
+  while (!parent_id.isEmpty()) {
+    QModelIndex model_index = id_to_index(parent_id);
+    dataChanged(model_index, model_index);
+    parent_id = dialog_tree.get_parent(parent_id);
   }
 }
 
@@ -31,6 +31,7 @@ const QString EditorSettings::save_files_before_running = "save_files_before_run
 const QString EditorSettings::no_audio = "no_audio";
 const QString EditorSettings::video_acceleration = "video_acceleration";
 const QString EditorSettings::quest_size = "quest_size";
+const QString EditorSettings::image_cache_size = "image_cache_size";
 
 // Console keys.
 const QString EditorSettings::console_history = "console_history";
@@ -78,6 +79,7 @@ QMap<QString, QVariant> EditorSettings::default_values = {
   { EditorSettings::no_audio, false },
   { EditorSettings::video_acceleration, true },
   { EditorSettings::quest_size, QSize() },
+  { EditorSettings::image_cache_size, 256 },
 
   // Console.
   { EditorSettings::console_history, QStringList() },
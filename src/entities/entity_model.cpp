@@ -77,7 +77,7 @@ EntityModel::EntityModel(
   no_direction_text(MapModel::tr("No direction")),
   draw_sprite_info(),
   sprite_model(nullptr),
-  sprite_image(),
+  sprite_frame(),
   draw_shape_info(),
   draw_image_info(),
   icon() {
@@ -1295,7 +1295,7 @@ void EntityModel::set_draw_sprite_info(const DrawSpriteInfo& draw_sprite_info) {
   this->draw_sprite_info = draw_sprite_info;
 
   sprite_model = nullptr;
-  sprite_image = QPixmap();
+  sprite_frame = SpriteModel::Frame();
 }
 
 /**
@@ -1453,24 +1453,36 @@ bool EntityModel::draw_as_sprite(
   }
 
   // Lazily create the image.
-  if (sprite_image.isNull()) {
+  if (sprite_frame.is_null()) {
     int frame_positive_number = frame;
     if (frame_positive_number < 0) {
       frame_positive_number = sprite_model->get_direction_num_frames(index) + frame_positive_number;
     }
-    sprite_image = sprite_model->get_direction_frame(index, frame_positive_number);
-    if (sprite_image.isNull()) {
+    sprite_frame = sprite_model->get_direction_frame(index, frame_positive_number);
+    if (sprite_frame.is_null()) {
       // The sprite model did not give a valid image.
       return false;
     }
   }
 
   QPoint dst_top_left = get_origin() - sprite_model->get_direction_origin(index);
+  const QSize& frame_size = sprite_frame.rect.size();
   if (draw_sprite_info.tiled) {
-    painter.drawTiledPixmap(QRect(dst_top_left, get_size()), sprite_image);
+    // Repeat the frame directly from the sprite image.
+    const QRect dst_rect(dst_top_left, get_size());
+    painter.save();
+    painter.setClipRect(dst_rect, Qt::IntersectClip);
+    for (int y = dst_rect.top(); y <= dst_rect.bottom(); y += frame_size.height()) {
+      for (int x = dst_rect.left(); x <= dst_rect.right(); x += frame_size.width()) {
+        painter.drawPixmap(QRect(QPoint(x, y), frame_size),
+                           sprite_frame.pixmap, sprite_frame.rect);
+      }
+    }
+    painter.restore();
   }
   else {
-    painter.drawPixmap(QRect(dst_top_left, sprite_image.size()), sprite_image);
+    painter.drawPixmap(QRect(dst_top_left, frame_size),
+                       sprite_frame.pixmap, sprite_frame.rect);
   }
   return true;
 }
@@ -1564,17 +1576,34 @@ bool EntityModel::draw_as_image(QPainter& painter, const SubImage& sub_image) co
   }
 
   if (sub_image.pixmap.isNull()) {
-    // Lazily load the image.
-    sub_image.pixmap = QPixmap(sub_image.file_name).copy(sub_image.src_rect);
+    // Lazily load the image. The whole pixmap is shared with other entities.
+    sub_image.pixmap = get_quest().get_image_cache().get_pixmap(sub_image.file_name);
     if (sub_image.pixmap.isNull()) {
       return false;
     }
   }
 
+  QRect src_rect = sub_image.pixmap.rect();
+  if (sub_image.src_rect.isValid()) {
+    src_rect &= sub_image.src_rect;
+  }
+  if (src_rect.isEmpty()) {
+    return false;
+  }
+
+  // Repeat the source rectangle like drawTiledPixmap(), without copying it.
   const double scale = draw_image_info.scale;
+  const int width = (int) (get_width() * scale);
+  const int height = (int) (get_height() * scale);
   painter.scale(1.0 / scale, 1.0 / scale);
-  painter.drawTiledPixmap(0, 0, (int) (get_width() * scale), (int) (get_height() * scale),
-                          sub_image.pixmap);
+  for (int y = 0; y < height; y += src_rect.height()) {
+    for (int x = 0; x < width; x += src_rect.width()) {
+      painter.drawPixmap(x, y, sub_image.pixmap,
+                         src_rect.x(), src_rect.y(),
+                         qMin(src_rect.width(), width - x),
+                         qMin(src_rect.height(), height - y));
+    }
+  }
   painter.scale(scale, scale);
   return true;
 }
@@ -1612,7 +1641,7 @@ void EntityModel::notify_tileset_changed(const QString& tileset_id) {
 
   if (sprite_model != nullptr) {
     sprite_model->set_tileset_id(tileset_id);
-    sprite_image = QPixmap();  // Clear the cached image.
+    sprite_frame = SpriteModel::Frame();  // Clear the cached image.
   }
 }
 
@@ -1621,7 +1650,7 @@ void EntityModel::notify_tileset_changed(const QString& tileset_id) {
  */
 void EntityModel::reload_sprite() {
 
-  sprite_image = QPixmap();
+  sprite_frame = SpriteModel::Frame();
 }
 
 }
@@ -16,6 +16,7 @@
  */
 #include "indexed_string_tree.h"
 #include "editor_exception.h"
+#include <algorithm>
 
 namespace SolarusEditor {
 
@@ -49,7 +50,7 @@ int IndexedStringTree::get_index(const QString& key) const {
   if (node == nullptr) {
     return -1;
   }
-  return node->index;
+  return get_child_index(node);
 }
 
 /**
@@ -99,9 +100,29 @@ QString IndexedStringTree::get_row_key(
     return "";
   }
 
-  auto it = node->children.begin();
-  std::advance(it, index);
-  return it->second->key;
+  return node->children[index]->key;
+}
+
+/**
+ * @brief Returns the internal key at a specific row of a specific key.
+ *
+ * This is equivalent to get_internal_key(get_row_key(index, parent_key))
+ * but avoids looking up the child by its key.
+ *
+ * @param index The index of the row.
+ * @param parent_key The key of the parent.
+ * @return The internal key or @c nullptr if the row does not exist.
+ */
+QString* IndexedStringTree::get_row_internal_key(
+    int index, const QString& parent_key) const {
+
+  Node* node = get_child(parent_key);
+
+  if (node == nullptr || index < 0 || index >= (int) node->children.size()) {
+    return nullptr;
+  }
+
+  return &node->children[index]->key;
 }
 
 /**
@@ -215,6 +236,52 @@ bool IndexedStringTree::remove_ref(const QString& key, bool keep_key) {
   return remove_child(key, REF_KEY, keep_key);
 }
 
+/**
+ * @brief Returns whether a key is flagged.
+ * @param key The key to test.
+ * @return @c true if the key exists and is flagged.
+ */
+bool IndexedStringTree::is_flagged(const QString& key) const {
+
+  Node* node = get_child(key);
+  return node != nullptr && node->flagged;
+}
+
+/**
+ * @brief Flags or unflags a key.
+ *
+ * The counters of flagged keys of all parents are updated.
+ *
+ * @param key The key to change.
+ * @param flagged @c true to flag the key.
+ * @return @c true if the flag of the key has changed.
+ */
+bool IndexedStringTree::set_flagged(const QString& key, bool flagged) {
+
+  Node* node = get_child(key);
+  if (node == nullptr || node == root || node->flagged == flagged) {
+    return false;
+  }
+
+  node->flagged = flagged;
+  update_num_flagged(node, flagged ? 1 : -1);
+  return true;
+}
+
+/**
+ * @brief Returns the number of flagged keys in the subtree of a key.
+ * @param key The key to test, or an empty string for the whole tree.
+ * @return The number of flagged keys, including the key itself.
+ */
+int IndexedStringTree::get_num_flagged(const QString& key) const {
+
+  Node* node = get_child(key);
+  if (node == nullptr) {
+    return 0;
+  }
+  return node->num_flagged;
+}
+
 /**
  * @brief Clears the tree.
  */
@@ -229,20 +296,10 @@ void IndexedStringTree::clear() {
  */
 IndexedStringTree::Node* IndexedStringTree::get_child(const QString& key) const {
 
-  Node* node = root;
-
   if (key.isEmpty()) {
-    return node;
+    return root;
   }
-
-  QStringList key_list = key.split(separator);
-  while (node != nullptr && !key_list.isEmpty()) {
-
-    QString sub_key = key_list.front();
-    node = get_sub_child(node, sub_key);
-    key_list.pop_front();
-  }
-  return node;
+  return nodes.value(key, nullptr);
 }
 
 /**
@@ -254,11 +311,7 @@ IndexedStringTree::Node* IndexedStringTree::get_child(const QString& key) const
 IndexedStringTree::Node* IndexedStringTree::get_sub_child(
     const Node *node, const QString& sub_key) const {
 
-  auto it = node->children.find(sub_key);
-  if (it == node->children.end()) {
-    return nullptr;
-  }
-  return it->second;
+  return node->children_by_key.value(sub_key, nullptr);
 }
 
 /**
@@ -310,19 +363,20 @@ bool IndexedStringTree::add_child(
     // Create the new node.
     node = new Node();
     node->parent = parent;
+    node->sub_key = sub_key;
     if (!parent->key.isEmpty()) {
       node->key = parent->key + separator + sub_key;
     } else {
       node->key = sub_key;
     }
 
-    // Add the node and rebuild the index map.
-    parent->children.emplace(sub_key, node);
-    build_index_map(parent);
+    // Add the node at its sorted position.
+    int node_index = insert_child(parent, node);
+    nodes.insert(node->key, node);
 
     // Set the index of the first added child.
     if (index == -1) {
-      index = node->index;
+      index = node_index;
     }
 
     parent = node;
@@ -367,7 +421,7 @@ bool IndexedStringTree::can_remove_child(
 
   // Set the parent_key and the index, return true.
   parent_key = parent != nullptr ? parent->key : "";
-  index = node->index;
+  index = get_child_index(node);
   return true;
 }
 
@@ -407,32 +461,78 @@ bool IndexedStringTree::remove_child(const QString& key, int type, bool keep_key
     return true;
   }
 
-  // Get the parent and the iterator of the node.
+  // Get the parent and the node.
   Node* parent = get_child(parent_key);
-  auto it = parent->children.begin();
-  std::advance(it, index);
-
-  // Remove the node and rebuild the index map.
-  delete it->second;
-  parent->children.erase(it);
-  build_index_map(parent);
+  Node* node = parent->children[index];
+
+  // Remove the node and its empty containers.
+  update_num_flagged(parent, -node->num_flagged);
+  parent->children.erase(parent->children.begin() + index);
+  parent->children_by_key.remove(node->sub_key);
+  nodes.remove(node->key);
+  clear_children(node);
+  delete node;
   return true;
 }
 
 /**
- * @brief Builds or rebuilds the internal mapping of a node that gives
- * indexes from keys.
+ * @brief Returns the index of a node in its parent.
  *
- * Nodes are indexed by string keys, but nodes also treats them as a map,
- * so we need an additional integer index.
+ * The index is found by a binary search in the sorted children of the parent.
  *
- * @param node The node where to rebuild the index.
+ * @param node The node.
+ * @return The index of the node, or 0 for the root node.
+ */
+int IndexedStringTree::get_child_index(const Node* node) const {
+
+  if (node->parent == nullptr) {
+    return 0;
+  }
+
+  const std::vector<Node*>& siblings = node->parent->children;
+  auto it = std::lower_bound(
+        siblings.begin(), siblings.end(), node->sub_key,
+        [this](const Node* sibling, const QString& sub_key) {
+    return comparator(sibling->sub_key, sub_key);
+  });
+
+  // Different sub keys may be equivalent in natural order.
+  while (it != siblings.end() && *it != node) {
+    ++it;
+  }
+  return it - siblings.begin();
+}
+
+/**
+ * @brief Inserts a node at its sorted position in the children of a node.
+ * @param parent The parent node.
+ * @param node The node to insert.
+ * @return The index of the node inserted.
+ */
+int IndexedStringTree::insert_child(Node* parent, Node* node) {
+
+  std::vector<Node*>& children = parent->children;
+  auto it = std::upper_bound(
+        children.begin(), children.end(), node->sub_key,
+        [this](const QString& sub_key, const Node* child) {
+    return comparator(sub_key, child->sub_key);
+  });
+
+  it = children.insert(it, node);
+  parent->children_by_key.insert(node->sub_key, node);
+  return it - children.begin();
+}
+
+/**
+ * @brief Adds a value to the counter of flagged keys of a node and its parents.
+ * @param node The node.
+ * @param delta The value to add.
  */
-void IndexedStringTree::build_index_map(const Node* node) const {
+void IndexedStringTree::update_num_flagged(Node* node, int delta) {
 
-  int index = 0;
-  for (auto& kvp : node->children) {
-    kvp.second->index = index++;
+  while (node != nullptr) {
+    node->num_flagged += delta;
+    node = node->parent;
   }
 }
 
@@ -442,13 +542,14 @@ void IndexedStringTree::build_index_map(const Node* node) const {
  */
 void IndexedStringTree::clear_children(Node* node) {
 
-  auto it = node->children.begin();
-  while (it != node->children.end()) {
-    clear_children(it->second);
-    delete it->second;
-    it++;
+  for (Node* child : node->children) {
+    clear_children(child);
+    nodes.remove(child->key);
+    delete child;
   }
   node->children.clear();
+  node->children_by_key.clear();
+  node->num_flagged = node->flagged ? 1 : 0;
 }
 
 }
@@ -54,6 +54,10 @@ MapModel::MapModel(
   QString tileset_id = get_tileset_id();
   if (!tileset_id.isEmpty()) {
     tileset_model = new TilesetModel(quest, tileset_id, this);
+    connect(tileset_model, SIGNAL(patterns_image_changed()),
+            this, SLOT(tileset_patterns_image_changed()));
+    connect(tileset_model, SIGNAL(patterns_image_region_changed(QRegion)),
+            this, SLOT(tileset_image_region_changed(QRegion)));
   }
 
   // Create entities.
@@ -100,6 +104,8 @@ void MapModel::save() const {
   if (!map.export_to_file(path.toStdString())) {
     throw EditorException(tr("Cannot save map data file '%1'").arg(path));
   }
+
+  quest.get_index().update_map(map_id);
 }
 
 /**
@@ -372,6 +378,10 @@ void MapModel::reload_tileset() {
   }
   else {
     tileset_model = new TilesetModel(quest, tileset_id, this);
+    connect(tileset_model, SIGNAL(patterns_image_changed()),
+            this, SLOT(tileset_patterns_image_changed()));
+    connect(tileset_model, SIGNAL(patterns_image_region_changed(QRegion)),
+            this, SLOT(tileset_image_region_changed(QRegion)));
   }
 
   // Notify children.
@@ -385,6 +395,73 @@ void MapModel::reload_tileset() {
   emit tileset_reloaded();
 }
 
+/**
+ * @brief Slot called when the whole tileset image was replaced.
+ *
+ * This happens when the image was edited in the tileset editor or when
+ * its size has changed on disk. All tiles are refreshed.
+ *
+ * Emits tileset_image_changed().
+ */
+void MapModel::tileset_patterns_image_changed() {
+
+  refresh_tile_images(QRegion());
+}
+
+/**
+ * @brief Slot called when a part of the tileset image was modified.
+ *
+ * Only tiles whose pattern overlaps this part are refreshed.
+ *
+ * Emits tileset_image_changed().
+ *
+ * @param region The part of the tileset image that has changed.
+ */
+void MapModel::tileset_image_region_changed(const QRegion& region) {
+
+  refresh_tile_images(region);
+}
+
+/**
+ * @brief Refreshes tiles and dynamic tiles after their tileset image changed.
+ *
+ * Emits tileset_image_changed().
+ *
+ * @param region The part of the tileset image that has changed,
+ * or an empty region to refresh all tiles.
+ */
+void MapModel::refresh_tile_images(const QRegion& region) {
+
+  if (tileset_model == nullptr) {
+    return;
+  }
+
+  const QString& tileset_id = get_tileset_id();
+  EntityIndexes indexes;
+  for (auto& kvp : entities) {
+    EntityModels& layer_entities = kvp.second;
+    for (EntityModelPtr& entity : layer_entities) {
+      const EntityType type = entity->get_type();
+      if (type != EntityType::TILE && type != EntityType::DYNAMIC_TILE) {
+        continue;
+      }
+      if (!region.isEmpty()) {
+        const int pattern_index = tileset_model->id_to_index(entity->get_field("pattern").toString());
+        if (pattern_index == -1 ||
+            !region.intersects(tileset_model->get_pattern_frames_bounding_box(pattern_index))) {
+          continue;
+        }
+      }
+      entity->notify_tileset_changed(tileset_id);
+      indexes << entity->get_index();
+    }
+  }
+
+  if (!indexes.isEmpty()) {
+    emit tileset_image_changed(indexes);
+  }
+}
+
 /**
  * @brief Returns the tileset of this map.
  * @return The tileset. Returns nullptr if no tileset is set.
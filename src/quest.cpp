@@ -18,11 +18,13 @@
 #include "obsolete_editor_exception.h"
 #include "obsolete_quest_exception.h"
 #include "quest.h"
+#include <QCryptographicHash>
 #include <QDir>
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
 #include <QMap>
+#include <QStandardPaths>
 
 namespace SolarusEditor {
 
@@ -52,7 +54,10 @@ const QMap<ResourceType, QString> resource_dirs = {
 Quest::Quest():
   root_path(),
   properties(*this),
-  resources(*this) {
+  resources(*this),
+  index(*this),
+  text_index(*this),
+  image_cache() {
 }
 
 /**
@@ -62,7 +67,10 @@ Quest::Quest():
 Quest::Quest(const QString& root_path):
   root_path(),
   properties(*this),
-  resources(*this) {
+  resources(*this),
+  index(*this),
+  text_index(*this),
+  image_cache() {
   set_root_path(root_path);
 }
 
@@ -88,6 +96,7 @@ void Quest::set_root_path(const QString& root_path) {
   else {
     this->root_path = root_path;
   }
+  image_cache.clear();
 
   emit root_path_changed(root_path);
 }
@@ -186,6 +195,50 @@ QuestResources& Quest::get_resources() {
   return resources;
 }
 
+/**
+ * @brief Returns the index of the content of maps of this quest.
+ * @return The quest index.
+ */
+const QuestIndex& Quest::get_index() const {
+  return index;
+}
+
+/**
+ * @brief Returns the index of the content of maps of this quest.
+ * @return The quest index.
+ */
+QuestIndex& Quest::get_index() {
+  return index;
+}
+
+/**
+ * @brief Returns the index of the words of strings and dialogs of this quest.
+ * @return The text index.
+ */
+const QuestTextIndex& Quest::get_text_index() const {
+  return text_index;
+}
+
+/**
+ * @brief Returns the index of the words of strings and dialogs of this quest.
+ * @return The text index.
+ */
+QuestTextIndex& Quest::get_text_index() {
+  return text_index;
+}
+
+/**
+ * @brief Returns the cache of images decoded from the files of this quest.
+ *
+ * The cache can be used from const quests since it does not change
+ * the quest itself.
+ *
+ * @return The image cache.
+ */
+QuestImageCache& Quest::get_image_cache() const {
+  return image_cache;
+}
+
 /**
  * @brief Returns the name of this quest.
  *
@@ -572,6 +625,28 @@ QString Quest::get_tileset_entities_image_path(
   return get_data_path() + "/tilesets/" + tileset_id + ".entities.png";
 }
 
+/**
+ * @brief Returns the directory where the editor can cache data about this
+ * quest.
+ *
+ * The directory is outside the quest and may not exist yet.
+ * Its content can be deleted at any time.
+ *
+ * @return The cache directory of this quest.
+ * Returns an empty string if the quest is invalid.
+ */
+QString Quest::get_cache_path() const {
+
+  if (!is_valid()) {
+    return "";
+  }
+
+  const QByteArray& hash = QCryptographicHash::hash(
+        get_root_path().toUtf8(), QCryptographicHash::Sha1).toHex();
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+      "/quests/" + QString::fromLatin1(hash);
+}
+
 /**
  * @brief Returns whether a path is the quest properties file quest.dat.
  * @param path The path to test.
@@ -620,34 +695,13 @@ bool Quest::is_in_resource_path(const QString& path, ResourceType& resource_type
 }
 
 /**
- * @brief Determines if a path can be valid for a resource element like a map,
- * a tileset, etc.
- *
- * Only the path string is tested: whether files actually exist does not
- * matter.
- *
- * @param[in] path The path to test.
- * @param[out] resource_type The resource type found if any.
- * @param[out] element_id Id of the resource element if any.
- * @return @c true if this path can be a resource element, even if it is not
- * declared in the resource list yet.
+ * @brief Returns the file extensions of elements of a resource type.
+ * @param resource_type A resource type.
+ * @return The extensions, including the dot.
+ * Empty for languages since they are directories.
  */
-bool Quest::is_potential_resource_element(
-    const QString& path, ResourceType& resource_type, QString& element_id) const {
-
-  if (!is_in_resource_path(path, resource_type)) {
-    // We are not in a resource directory.
-    return false;
-  }
+QStringList Quest::get_resource_extensions(ResourceType resource_type) {
 
-  if (is_resource_path(path, resource_type)) {
-    // The top-level resource directory itself.
-    return false;
-  }
-
-  // We are under a resource directory. Check if a resource element with this id is declared.
-  QString resource_path = get_resource_path(resource_type);
-  QString path_from_resource = path.right(path.size() - resource_path.size() - 1);
   QStringList extensions;
   switch (resource_type) {
   case ResourceType::MAP:
@@ -678,12 +732,44 @@ bool Quest::is_potential_resource_element(
     // No extension.
     break;
   }
+  return extensions;
+}
+
+/**
+ * @brief Determines if a path can be valid for a resource element like a map,
+ * a tileset, etc.
+ *
+ * Only the path string is tested: whether files actually exist does not
+ * matter.
+ *
+ * @param[in] path The path to test.
+ * @param[out] resource_type The resource type found if any.
+ * @param[out] element_id Id of the resource element if any.
+ * @return @c true if this path can be a resource element, even if it is not
+ * declared in the resource list yet.
+ */
+bool Quest::is_potential_resource_element(
+    const QString& path, ResourceType& resource_type, QString& element_id) const {
+
+  if (!is_in_resource_path(path, resource_type)) {
+    // We are not in a resource directory.
+    return false;
+  }
+
+  if (is_resource_path(path, resource_type)) {
+    // The top-level resource directory itself.
+    return false;
+  }
+
+  // We are under a resource directory. Check if a resource element with this id is declared.
+  QString resource_path = get_resource_path(resource_type);
+  QString path_from_resource = path.right(path.size() - resource_path.size() - 1);
 
   if (resource_type == ResourceType::LANGUAGE) {
     element_id = path_from_resource;
   }
   else {
-    Q_FOREACH (const QString& extension, extensions) {
+    Q_FOREACH (const QString& extension, get_resource_extensions(resource_type)) {
       if (path_from_resource.endsWith(extension)) {
         // Remove the extension.
         element_id = path_from_resource.section('.', 0, -2);
@@ -0,0 +1,678 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "quest.h"
+#include "quest_checker.h"
+#include "rectangle.h"
+#include <solarus/entities/TilesetData.h>
+#include <solarus/DialogResources.h>
+#include <solarus/MapData.h>
+#include <solarus/SpriteData.h>
+#include <solarus/StringResources.h>
+#include <QImageReader>
+#include <QtConcurrentMap>
+
+namespace SolarusEditor {
+
+using Issue = QuestChecker::Issue;
+using Job = QuestChecker::Job;
+using JobResult = QuestChecker::JobResult;
+using Severity = QuestChecker::Severity;
+
+namespace {
+
+/**
+ * @brief Information about the quest needed to check files.
+ *
+ * It is read-only while worker threads are running.
+ */
+struct CheckContext {
+  QString sprite_images_path;
+  QMap<ResourceType, QSet<QString>> declared_elements;
+  QMap<ResourceType, QString> resource_type_names;
+  QMap<QString, QSet<QString>> tileset_patterns;
+  QMap<QString, int> sprite_directions;
+  QMap<QString, QSet<QString>> map_destinations;
+  QSet<QString> dialog_ids;
+};
+
+/**
+ * @brief Creates a problem about a file being checked.
+ * @param job The file being checked.
+ * @param severity Severity of the problem.
+ * @param location Location of the problem in the file.
+ * @param message Description of the problem.
+ * @return The problem.
+ */
+Issue make_issue(
+    const Job& job,
+    Severity severity,
+    const QString& location,
+    const QString& message) {
+
+  Issue issue;
+  issue.severity = severity;
+  issue.file_path = job.path;
+  issue.resource_type = job.resource_type;
+  issue.element_id = job.element_id;
+  issue.entity_index = EntityIndex();
+  issue.location = location;
+  issue.message = message;
+  return issue;
+}
+
+/**
+ * @brief Checks a tileset.
+ * @param job The tileset to check.
+ * @param result The result to fill.
+ */
+void check_tileset(const Job& job, JobResult& result) {
+
+  Solarus::TilesetData tileset;
+  if (!tileset.import_from_file(job.path.toStdString())) {
+    result.issues << make_issue(job, Severity::FAILURE, QString(),
+                                QuestChecker::tr("Cannot parse tileset file"));
+    return;
+  }
+  result.valid = true;
+
+  const QSize image_size = QImageReader(job.secondary_path).size();
+  if (!image_size.isValid()) {
+    result.issues << make_issue(job, Severity::FAILURE, QString(),
+                                QuestChecker::tr("Missing tileset image '%1'").
+                                arg(job.secondary_path));
+  }
+  const QRect image_rect(QPoint(0, 0), image_size);
+
+  for (const auto& kvp : tileset.get_patterns()) {
+    const QString& pattern_id = QString::fromStdString(kvp.first);
+    result.ids.insert(pattern_id);
+
+    if (!image_size.isValid()) {
+      continue;
+    }
+    for (const Solarus::Rectangle& frame : kvp.second.get_frames()) {
+      if (!image_rect.contains(Rectangle::to_qrect(frame))) {
+        result.issues << make_issue(job, Severity::FAILURE,
+                                    QuestChecker::tr("Pattern '%1'").arg(pattern_id),
+                                    QuestChecker::tr("Pattern is outside the tileset image"));
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Checks a sprite.
+ * @param job The sprite to check.
+ * @param context Information about the quest.
+ * @param result The result to fill.
+ */
+void check_sprite(const Job& job, const CheckContext& context, JobResult& result) {
+
+  Solarus::SpriteData sprite;
+  if (!sprite.import_from_file(job.path.toStdString())) {
+    result.issues << make_issue(job, Severity::FAILURE, QString(),
+                                QuestChecker::tr("Cannot parse sprite file"));
+    return;
+  }
+  result.valid = true;
+
+  for (const auto& kvp : sprite.get_animations()) {
+    const QString& animation_name = QString::fromStdString(kvp.first);
+    const Solarus::SpriteAnimationData& animation = kvp.second;
+    const QString& location = QuestChecker::tr("Animation '%1'").arg(animation_name);
+    const int num_directions = animation.get_num_directions();
+    result.max_directions = qMax(result.max_directions, num_directions);
+
+    if (num_directions == 0) {
+      result.issues << make_issue(job, Severity::WARNING, location,
+                                  QuestChecker::tr("Animation has no direction"));
+    }
+
+    if (animation.src_image_is_tileset()) {
+      // Depends on the map.
+      continue;
+    }
+
+    const QString& src_image = QString::fromStdString(animation.get_src_image());
+    const QSize image_size = QImageReader(context.sprite_images_path + src_image).size();
+    if (!image_size.isValid()) {
+      result.issues << make_issue(job, Severity::FAILURE, location,
+                                  QuestChecker::tr("Missing source image '%1'").arg(src_image));
+      continue;
+    }
+
+    const QRect image_rect(QPoint(0, 0), image_size);
+    for (int i = 0; i < num_directions; ++i) {
+      for (const Solarus::Rectangle& frame : animation.get_direction(i).get_all_frames()) {
+        if (!image_rect.contains(Rectangle::to_qrect(frame))) {
+          result.issues << make_issue(
+                             job, Severity::FAILURE,
+                             QuestChecker::tr("Animation '%1', direction %2").arg(animation_name).arg(i),
+                             QuestChecker::tr("Frames are outside the source image '%1'").arg(src_image));
+          break;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Checks the dialogs and strings of a language.
+ * @param job The language to check.
+ * @param result The result to fill.
+ */
+void check_language(const Job& job, JobResult& result) {
+
+  Solarus::DialogResources dialogs;
+  if (!dialogs.import_from_file(job.path.toStdString())) {
+    result.issues << make_issue(job, Severity::FAILURE, QString(),
+                                QuestChecker::tr("Cannot parse dialogs file"));
+    return;
+  }
+
+  Solarus::StringResources strings;
+  if (!strings.import_from_file(job.secondary_path.toStdString())) {
+    Issue issue = make_issue(job, Severity::FAILURE, QString(),
+                             QuestChecker::tr("Cannot parse strings file"));
+    issue.file_path = job.secondary_path;
+    result.issues << issue;
+    return;
+  }
+  result.valid = true;
+
+  for (const auto& kvp : dialogs.get_dialogs()) {
+    result.ids.insert(QString::fromStdString(kvp.first));
+  }
+  for (const auto& kvp : strings.get_strings()) {
+    result.keys.insert(QString::fromStdString(kvp.first));
+  }
+}
+
+/**
+ * @brief Returns a human-readable location of an entity of a map.
+ * @param map The map.
+ * @param index Index of an entity in the map.
+ * @return A description of the entity.
+ */
+QString get_entity_location(const Solarus::MapData& map, const EntityIndex& index) {
+
+  const Solarus::EntityData& entity = map.get_entity(index);
+  const QString& type_name = EntityTraits::get_friendly_name(entity.get_type());
+  if (!entity.get_name().empty()) {
+    return QuestChecker::tr("%1 '%2'").
+        arg(type_name, QString::fromStdString(entity.get_name()));
+  }
+  return QuestChecker::tr("%1 on layer %2 (#%3)").
+      arg(type_name).arg(index.layer).arg(index.order);
+}
+
+/**
+ * @brief Checks a map.
+ * @param job The map to check.
+ * @param context Information about the quest.
+ * @param result The result to fill.
+ */
+void check_map(const Job& job, const CheckContext& context, JobResult& result) {
+
+  Solarus::MapData map;
+  if (!map.import_from_file(job.path.toStdString())) {
+    result.issues << make_issue(job, Severity::FAILURE, QString(),
+                                QuestChecker::tr("Cannot parse map file"));
+    return;
+  }
+  result.valid = true;
+
+  const QuestIndex::MapInfo& map_info = QuestIndex::parse_map_data(job.element_id, map);
+
+  // References to other elements.
+  Q_FOREACH (const QuestIndex::Reference& reference, map_info.references) {
+
+    QString message;
+    switch (reference.kind) {
+
+    case QuestIndex::ReferenceKind::RESOURCE:
+      if (!context.declared_elements.value(reference.resource_type).contains(reference.target_id)) {
+        message = QuestChecker::tr("No such %1: '%2'").
+            arg(context.resource_type_names.value(reference.resource_type), reference.target_id);
+      }
+      break;
+
+    case QuestIndex::ReferenceKind::DIALOG:
+      if (!context.dialog_ids.contains(reference.target_id)) {
+        message = QuestChecker::tr("No such dialog: '%1'").arg(reference.target_id);
+      }
+      break;
+
+    case QuestIndex::ReferenceKind::DESTINATION:
+      if (context.declared_elements.value(ResourceType::MAP).contains(reference.target_map_id) &&
+          !context.map_destinations.value(reference.target_map_id).contains(reference.target_id)) {
+        message = QuestChecker::tr("No destination '%1' in map '%2'").
+            arg(reference.target_id, reference.target_map_id);
+      }
+      break;
+
+    }
+
+    if (message.isEmpty()) {
+      continue;
+    }
+
+    Issue issue = make_issue(job, Severity::FAILURE, QString(), message);
+    if (reference.entity_index.is_valid()) {
+      issue.entity_index = reference.entity_index;
+      issue.location = get_entity_location(map, reference.entity_index);
+    }
+    result.issues << issue;
+  }
+
+  // Tile patterns and sprite directions.
+  const bool check_patterns = context.tileset_patterns.contains(map_info.tileset_id);
+  const QSet<QString>& pattern_ids = context.tileset_patterns.value(map_info.tileset_id);
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    for (int i = 0; i < map.get_num_entities(layer); ++i) {
+      const EntityIndex index = { layer, i };
+      const Solarus::EntityData& entity = map.get_entity(index);
+
+      if (check_patterns && entity.is_string("pattern")) {
+        const QString& pattern_id = QString::fromStdString(entity.get_string("pattern"));
+        if (!pattern_ids.contains(pattern_id)) {
+          Issue issue = make_issue(job, Severity::FAILURE, get_entity_location(map, index),
+                                   QuestChecker::tr("No pattern '%1' in tileset '%2'").
+                                   arg(pattern_id, map_info.tileset_id));
+          issue.entity_index = index;
+          result.issues << issue;
+        }
+      }
+
+      if (entity.is_string("sprite") && entity.is_integer("direction")) {
+        const QString& sprite_id = QString::fromStdString(entity.get_string("sprite"));
+        const int direction = entity.get_integer("direction");
+        if (context.sprite_directions.contains(sprite_id) &&
+            direction >= context.sprite_directions.value(sprite_id)) {
+          Issue issue = make_issue(job, Severity::WARNING, get_entity_location(map, index),
+                                   QuestChecker::tr("Sprite '%1' has no direction %2").
+                                   arg(sprite_id).arg(direction));
+          issue.entity_index = index;
+          result.issues << issue;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Function object that checks a file in a worker thread.
+ */
+struct FileChecker {
+
+  typedef JobResult result_type;
+
+  JobResult operator()(const Job& job) const {
+
+    JobResult result;
+    result.job = job;
+    result.valid = false;
+    result.max_directions = 0;
+
+    switch (job.resource_type) {
+
+    case ResourceType::TILESET:
+      check_tileset(job, result);
+      break;
+
+    case ResourceType::SPRITE:
+      check_sprite(job, context, result);
+      break;
+
+    case ResourceType::LANGUAGE:
+      check_language(job, result);
+      break;
+
+    case ResourceType::MAP:
+      check_map(job, context, result);
+      break;
+
+    default:
+      break;
+    }
+
+    return result;
+  }
+
+  CheckContext context;
+};
+
+}
+
+/**
+ * @brief Creates a checker for a quest.
+ * @param quest The quest to check.
+ */
+QuestChecker::QuestChecker(Quest& quest) :
+  quest(quest),
+  pass(0),
+  num_files(0),
+  num_files_checked(0),
+  tileset_patterns(),
+  sprite_directions(),
+  language_dialogs(),
+  language_strings(),
+  map_jobs(),
+  watcher() {
+
+  connect(&watcher, SIGNAL(resultReadyAt(int)),
+          this, SLOT(file_checked(int)));
+  connect(&watcher, SIGNAL(finished()),
+          this, SLOT(pass_finished()));
+  connect(&quest, SIGNAL(root_path_changed(QString)),
+          this, SLOT(cancel()));
+}
+
+/**
+ * @brief Destroys the checker.
+ *
+ * Waits for worker threads if a check is in progress.
+ */
+QuestChecker::~QuestChecker() {
+
+  stop();
+}
+
+/**
+ * @brief Returns whether a check is in progress.
+ * @return @c true if files are being checked.
+ */
+bool QuestChecker::is_running() const {
+
+  return pass != 0;
+}
+
+/**
+ * @brief Returns the number of files of the current or last check.
+ * @return The number of files to check.
+ */
+int QuestChecker::get_num_files() const {
+
+  return num_files;
+}
+
+/**
+ * @brief Starts checking the whole quest in worker threads.
+ *
+ * A check in progress is restarted.
+ * issues_found() is emitted as problems are found and finished() is
+ * emitted at the end.
+ */
+void QuestChecker::start() {
+
+  cancel();
+
+  if (!quest.is_valid()) {
+    return;
+  }
+
+  tileset_patterns.clear();
+  sprite_directions.clear();
+  language_dialogs.clear();
+  language_strings.clear();
+  map_jobs.clear();
+
+  const QuestResources& resources = quest.get_resources();
+  QList<Job> jobs;
+  Q_FOREACH (const QString& tileset_id, resources.get_elements(ResourceType::TILESET)) {
+    jobs << Job{ ResourceType::TILESET, tileset_id,
+                 quest.get_tileset_data_file_path(tileset_id),
+                 quest.get_tileset_tiles_image_path(tileset_id) };
+  }
+  Q_FOREACH (const QString& sprite_id, resources.get_elements(ResourceType::SPRITE)) {
+    jobs << Job{ ResourceType::SPRITE, sprite_id,
+                 quest.get_sprite_path(sprite_id),
+                 QString() };
+  }
+  Q_FOREACH (const QString& language_id, resources.get_elements(ResourceType::LANGUAGE)) {
+    jobs << Job{ ResourceType::LANGUAGE, language_id,
+                 quest.get_dialogs_path(language_id),
+                 quest.get_strings_path(language_id) };
+  }
+  Q_FOREACH (const QString& map_id, resources.get_elements(ResourceType::MAP)) {
+    map_jobs << Job{ ResourceType::MAP, map_id,
+                     quest.get_map_data_file_path(map_id),
+                     QString() };
+  }
+
+  num_files = jobs.size() + map_jobs.size();
+  num_files_checked = 0;
+  pass = 1;
+  emit started();
+  emit progress_changed(num_files_checked, num_files);
+
+  if (jobs.isEmpty()) {
+    start_maps_pass();
+    return;
+  }
+
+  FileChecker checker;
+  checker.context.sprite_images_path = quest.get_sprite_image_path("");
+  watcher.setFuture(QtConcurrent::mapped(jobs, checker));
+}
+
+/**
+ * @brief Stops the check in progress if any.
+ *
+ * Blocks until worker threads have finished their current file.
+ */
+void QuestChecker::cancel() {
+
+  if (pass == 0) {
+    return;
+  }
+
+  stop();
+  emit finished();
+}
+
+/**
+ * @brief Stops worker threads without notifying anyone.
+ */
+void QuestChecker::stop() {
+
+  pass = 0;
+  if (watcher.isRunning()) {
+    watcher.cancel();
+    watcher.waitForFinished();
+  }
+}
+
+/**
+ * @brief Slot called when a worker thread has checked a file.
+ * @param result_index Index of the result in the future.
+ */
+void QuestChecker::file_checked(int result_index) {
+
+  if (pass == 0) {
+    return;
+  }
+
+  const JobResult& result = watcher.resultAt(result_index);
+  const Job& job = result.job;
+  if (result.valid) {
+    switch (job.resource_type) {
+
+    case ResourceType::TILESET:
+      tileset_patterns.insert(job.element_id, result.ids);
+      break;
+
+    case ResourceType::SPRITE:
+      sprite_directions.insert(job.element_id, result.max_directions);
+      break;
+
+    case ResourceType::LANGUAGE:
+      language_dialogs.insert(job.element_id, result.ids);
+      language_strings.insert(job.element_id, result.keys);
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  ++num_files_checked;
+  if (!result.issues.isEmpty()) {
+    emit issues_found(result.issues);
+  }
+  emit progress_changed(num_files_checked, num_files);
+}
+
+/**
+ * @brief Slot called when worker threads have finished a pass.
+ */
+void QuestChecker::pass_finished() {
+
+  if (pass == 0 || watcher.isCanceled()) {
+    return;
+  }
+
+  if (pass == 1) {
+    check_languages();
+    start_maps_pass();
+    return;
+  }
+
+  pass = 0;
+  emit finished();
+}
+
+/**
+ * @brief Reports dialogs and strings that exist in some languages only.
+ */
+void QuestChecker::check_languages() {
+
+  QSet<QString> all_dialog_ids;
+  Q_FOREACH (const QSet<QString>& dialog_ids, language_dialogs) {
+    all_dialog_ids.unite(dialog_ids);
+  }
+  QSet<QString> all_string_keys;
+  Q_FOREACH (const QSet<QString>& string_keys, language_strings) {
+    all_string_keys.unite(string_keys);
+  }
+
+  QList<Issue> issues;
+  Q_FOREACH (const QString& language_id, language_dialogs.keys()) {
+    Job job = { ResourceType::LANGUAGE, language_id,
+                quest.get_dialogs_path(language_id), QString() };
+    QStringList missing_ids = (all_dialog_ids - language_dialogs.value(language_id)).toList();
+    missing_ids.sort();
+    Q_FOREACH (const QString& dialog_id, missing_ids) {
+      issues << make_issue(job, Severity::WARNING,
+                           tr("Dialog '%1'").arg(dialog_id),
+                           tr("Missing in this language"));
+    }
+
+    job.path = quest.get_strings_path(language_id);
+    QStringList missing_keys = (all_string_keys - language_strings.value(language_id)).toList();
+    missing_keys.sort();
+    Q_FOREACH (const QString& key, missing_keys) {
+      issues << make_issue(job, Severity::WARNING,
+                           tr("String '%1'").arg(key),
+                           tr("Missing in this language"));
+    }
+  }
+
+  if (!issues.isEmpty()) {
+    emit issues_found(issues);
+  }
+}
+
+/**
+ * @brief Starts checking maps once tilesets, sprites and languages are known.
+ *
+ * Destinations of maps come from the quest index, so maps are checked when
+ * the index is up to date.
+ */
+void QuestChecker::start_maps_pass() {
+
+  pass = 2;
+
+  if (map_jobs.isEmpty()) {
+    pass = 0;
+    emit finished();
+    return;
+  }
+
+  QuestIndex& index = quest.get_index();
+  connect(&index, SIGNAL(build_finished()),
+          this, SLOT(index_build_finished()), Qt::UniqueConnection);
+  if (!index.is_building()) {
+    index.rebuild();
+  }
+}
+
+/**
+ * @brief Slot called when the quest index has finished parsing maps.
+ */
+void QuestChecker::index_build_finished() {
+
+  disconnect(&quest.get_index(), SIGNAL(build_finished()),
+             this, SLOT(index_build_finished()));
+
+  if (pass != 2 || watcher.isRunning()) {
+    return;
+  }
+
+  check_maps();
+}
+
+/**
+ * @brief Checks maps in worker threads.
+ */
+void QuestChecker::check_maps() {
+
+  FileChecker checker;
+  CheckContext& context = checker.context;
+  context.sprite_images_path = quest.get_sprite_image_path("");
+  context.tileset_patterns = tileset_patterns;
+  context.sprite_directions = sprite_directions;
+
+  const QuestResources& resources = quest.get_resources();
+  Q_FOREACH (ResourceType resource_type, Solarus::EnumInfo<ResourceType>::enums()) {
+    context.declared_elements.insert(
+          resource_type, resources.get_elements(resource_type).toSet());
+    context.resource_type_names.insert(
+          resource_type, resources.get_friendly_name_for_id(resource_type));
+  }
+
+  Q_FOREACH (const QSet<QString>& dialog_ids, language_dialogs) {
+    context.dialog_ids.unite(dialog_ids);
+  }
+
+  // Destinations of all maps, from the quest index.
+  QuestIndex& index = quest.get_index();
+  Q_FOREACH (const QString& map_id, index.get_map_ids()) {
+    QSet<QString>& destinations = context.map_destinations[map_id];
+    Q_FOREACH (const QuestIndex::NamedEntity& entity,
+               index.get_map_info(map_id).named_entities) {
+      if (entity.type == EntityType::DESTINATION) {
+        destinations.insert(entity.name);
+      }
+    }
+  }
+
+  watcher.setFuture(QtConcurrent::mapped(map_jobs, checker));
+}
+
+}
@@ -30,7 +30,14 @@ namespace SolarusEditor {
 QuestFilesModel::QuestFilesModel(Quest& quest):
   QSortFilterProxyModel(nullptr),
   quest(quest),
-  source_model(new QFileSystemModel) {
+  source_model(new QFileSystemModel),
+  extra_paths_by_dir(),
+  all_extra_paths(),
+  data_path_prefix(),
+  resource_dirs(),
+  map_script_paths() {
+
+  build_path_classification();
 
   // Watch changes on the filesystem.
   source_model->setRootPath(quest.get_data_path());  // Only watch changes in the data directory.
@@ -653,29 +660,86 @@ bool QuestFilesModel::filterAcceptsRow(int source_row, const QModelIndex& source
     return true;
   }
 
-  const QString lua_extension = ".lua";
-  if (file_name.endsWith(lua_extension)) {
+  if (file_name.endsWith(".lua")) {
     // Keep all .lua scripts except map scripts.
-    QString file_path_dat = file_path.replace(file_path.lastIndexOf(lua_extension), lua_extension.size(), ".dat");
-    ResourceType resource_type;
-    QString element_id;
-    if (quest.is_resource_element(file_path_dat, resource_type, element_id) &&
-        resource_type == ResourceType::MAP) {
-      return false;
-    }
-
-    return true;
+    return !map_script_paths.contains(file_path);
   }
 
   // Keep resources, and also files that could be resources
   // but are not declared in the resource list yet.
-  ResourceType resource_type;
-  QString element_id;
-  if (quest.is_potential_resource_element(file_path, resource_type, element_id)) {
+  return is_potential_resource_file(file_path);
+}
+
+/**
+ * @brief Prepares the information needed to classify files quickly.
+ *
+ * This function is called for every file discovered in the filesystem,
+ * so instead of asking the quest, it uses information computed once:
+ * resource directories with their file extensions, and the scripts of
+ * declared maps, which are kept up to date when resources change.
+ */
+void QuestFilesModel::build_path_classification() {
+
+  data_path_prefix = quest.get_data_path() + '/';
+
+  resource_dirs.clear();
+  Q_FOREACH (ResourceType resource_type, Solarus::EnumInfo<ResourceType>::enums()) {
+    ResourceDir resource_dir;
+    resource_dir.resource_type = resource_type;
+    resource_dir.extensions = Quest::get_resource_extensions(resource_type);
+    resource_dirs.insert(quest.get_resource_path(resource_type), resource_dir);
+  }
+
+  map_script_paths.clear();
+  Q_FOREACH (const QString& map_id,
+             quest.get_resources().get_elements(ResourceType::MAP)) {
+    map_script_paths.insert(quest.get_map_script_path(map_id));
+  }
+}
+
+/**
+ * @brief Returns whether a file can be a resource element.
+ *
+ * This is equivalent to Quest::is_potential_resource_element(),
+ * but faster because it only needs one lookup.
+ *
+ * @param path Path of a file.
+ * @return @c true if the file is in a resource directory and has
+ * the extension of this type of resource.
+ */
+bool QuestFilesModel::is_potential_resource_file(const QString& path) const {
+
+  if (!path.startsWith(data_path_prefix)) {
+    return false;
+  }
+
+  // Resource directories are directly in the data directory.
+  const int dir_end = path.indexOf('/', data_path_prefix.size());
+  if (dir_end == -1) {
+    return false;
+  }
+
+  const auto it = resource_dirs.constFind(path.left(dir_end));
+  if (it == resource_dirs.constEnd()) {
+    return false;
+  }
+
+  const QString& path_from_resource = path.mid(dir_end + 1);
+  if (path_from_resource.isEmpty()) {
+    return false;
+  }
+
+  if (it->resource_type == ResourceType::LANGUAGE) {
     return true;
   }
 
-  // File not known by the quest.
+  Q_FOREACH (const QString& extension, it->extensions) {
+    if (path_from_resource.endsWith(extension)) {
+      return !path_from_resource.section('.', 0, -2).isEmpty();
+    }
+  }
+
+  // Not a recognized extension.
   return false;
 }
 
@@ -937,6 +1001,10 @@ void QuestFilesModel::resource_element_added(
 
   Q_UNUSED(description);
 
+  if (resource_type == ResourceType::MAP) {
+    map_script_paths.insert(quest.get_map_script_path(element_id));
+  }
+
   // If the file already exists, it automatically appears in the tree
   // thanks to QFileSystemWatcher.
   // Otherwise, we insert it as an extra path.
@@ -966,6 +1034,10 @@ void QuestFilesModel::resource_element_added(
 void QuestFilesModel::resource_element_removed(
     ResourceType resource_type, const QString& element_id) {
 
+  if (resource_type == ResourceType::MAP) {
+    map_script_paths.remove(quest.get_map_script_path(element_id));
+  }
+
   // If the file existed, it automatically disappears from
   // the tree thanks to QFileSystemWatcher.
   // Otherwise, since it was it in the tree anyway, we need to notify people
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "quest_image_cache.h"
+#include <QFileInfo>
+
+namespace SolarusEditor {
+
+namespace {
+
+/**
+ * @brief Returns the memory used by the pixels of an image.
+ * @param image An image.
+ * @return The number of bytes.
+ */
+qint64 get_image_bytes(const QImage& image) {
+  return qint64(image.bytesPerLine()) * image.height();
+}
+
+/**
+ * @brief Returns the memory used by the pixels of a pixmap.
+ * @param pixmap A pixmap.
+ * @return An estimation of the number of bytes.
+ */
+qint64 get_pixmap_bytes(const QPixmap& pixmap) {
+  return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+}
+
+/**
+ * @brief Creates an empty image cache.
+ */
+QuestImageCache::QuestImageCache() :
+  entries(),
+  max_bytes(default_max_bytes),
+  num_bytes(0),
+  use_counter(0),
+  num_hits(0),
+  num_misses(0) {
+}
+
+/**
+ * @brief Returns an image, decoding the file if necessary.
+ * @param path Path of the image file.
+ * @return The image, or a null image if the file cannot be read.
+ */
+QImage QuestImageCache::get_image(const QString& path) {
+
+  const Entry* entry = get_entry(path);
+  if (entry == nullptr) {
+    return QImage();
+  }
+  return entry->image;
+}
+
+/**
+ * @brief Returns an image as a pixmap, decoding the file if necessary.
+ *
+ * All callers share the same pixmap.
+ *
+ * @param path Path of the image file.
+ * @return The pixmap, or a null pixmap if the file cannot be read.
+ */
+QPixmap QuestImageCache::get_pixmap(const QString& path) {
+
+  Entry* entry = get_entry(path);
+  if (entry == nullptr) {
+    return QPixmap();
+  }
+
+  if (entry->pixmap.isNull()) {
+    entry->pixmap = QPixmap::fromImage(entry->image);
+    const qint64 pixmap_bytes = get_pixmap_bytes(entry->pixmap);
+    entry->num_bytes += pixmap_bytes;
+    num_bytes += pixmap_bytes;
+    const QPixmap pixmap = entry->pixmap;
+    evict(QFileInfo(path).canonicalFilePath());
+    return pixmap;
+  }
+  return entry->pixmap;
+}
+
+/**
+ * @brief Removes an image from the cache.
+ *
+ * The next request will decode the file again even if its modification
+ * date has not changed.
+ *
+ * @param path Path of the image file.
+ */
+void QuestImageCache::invalidate(const QString& path) {
+
+  QFileInfo file_info(path);
+  const QString& key = file_info.exists() ? file_info.canonicalFilePath() : path;
+  remove_entry(key);
+}
+
+/**
+ * @brief Removes all images from the cache.
+ *
+ * Statistics are kept.
+ */
+void QuestImageCache::clear() {
+
+  entries.clear();
+  num_bytes = 0;
+}
+
+/**
+ * @brief Returns the memory budget of the cache.
+ * @return The maximum number of bytes of images to keep.
+ */
+qint64 QuestImageCache::get_max_bytes() const {
+  return max_bytes;
+}
+
+/**
+ * @brief Sets the memory budget of the cache.
+ *
+ * Least recently used images are removed if the cache is now too big.
+ *
+ * @param max_bytes The maximum number of bytes of images to keep.
+ */
+void QuestImageCache::set_max_bytes(qint64 max_bytes) {
+
+  this->max_bytes = max_bytes;
+  evict(QString());
+}
+
+/**
+ * @brief Returns the number of images in the cache.
+ * @return The number of images.
+ */
+int QuestImageCache::get_num_images() const {
+  return entries.size();
+}
+
+/**
+ * @brief Returns the memory used by images of the cache.
+ * @return The number of bytes.
+ */
+qint64 QuestImageCache::get_num_bytes() const {
+  return num_bytes;
+}
+
+/**
+ * @brief Returns the number of requests served without decoding a file.
+ * @return The number of cache hits.
+ */
+int QuestImageCache::get_num_hits() const {
+  return num_hits;
+}
+
+/**
+ * @brief Returns the number of requests that needed to decode a file.
+ * @return The number of cache misses.
+ */
+int QuestImageCache::get_num_misses() const {
+  return num_misses;
+}
+
+/**
+ * @brief Returns the cache entry of an image file, decoding it if it is not
+ * in the cache or if it was modified.
+ * @param path Path of the image file.
+ * @return The entry, or nullptr if the file cannot be read.
+ */
+QuestImageCache::Entry* QuestImageCache::get_entry(const QString& path) {
+
+  ++use_counter;
+
+  QFileInfo file_info(path);
+  if (!file_info.exists()) {
+    ++num_misses;
+    return nullptr;
+  }
+
+  const QString& key = file_info.canonicalFilePath();
+  const QDateTime& last_modified = file_info.lastModified();
+  const qint64 file_size = file_info.size();
+
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+    if (it->last_modified == last_modified && it->file_size == file_size) {
+      ++num_hits;
+      it->last_use = use_counter;
+      return &it.value();
+    }
+    // The file has changed.
+    remove_entry(key);
+  }
+
+  ++num_misses;
+  const QImage image(key);
+  if (image.isNull()) {
+    return nullptr;
+  }
+
+  Entry entry;
+  entry.last_modified = last_modified;
+  entry.file_size = file_size;
+  entry.image = image;
+  entry.num_bytes = get_image_bytes(image);
+  entry.last_use = use_counter;
+  entries.insert(key, entry);
+  num_bytes += entry.num_bytes;
+
+  evict(key);
+  return &entries[key];
+}
+
+/**
+ * @brief Removes an image from the cache if it is there.
+ * @param key Canonical path of the image.
+ */
+void QuestImageCache::remove_entry(const QString& key) {
+
+  auto it = entries.find(key);
+  if (it == entries.end()) {
+    return;
+  }
+  num_bytes -= it->num_bytes;
+  entries.erase(it);
+}
+
+/**
+ * @brief Removes the least recently used images until the memory budget
+ * is respected.
+ *
+ * Images still used elsewhere are only released by the cache.
+ *
+ * @param key_to_keep An image that should not be removed, or an empty
+ * string.
+ */
+void QuestImageCache::evict(const QString& key_to_keep) {
+
+  while (num_bytes > max_bytes && entries.size() > 1) {
+    QString oldest_key;
+    quint64 oldest_use = 0;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+      if (it.key() == key_to_keep) {
+        continue;
+      }
+      if (oldest_key.isEmpty() || it->last_use < oldest_use) {
+        oldest_key = it.key();
+        oldest_use = it->last_use;
+      }
+    }
+    if (oldest_key.isEmpty()) {
+      return;
+    }
+    remove_entry(oldest_key);
+  }
+}
+
+}
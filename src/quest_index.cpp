@@ -0,0 +1,1103 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "point.h"
+#include "quest.h"
+#include "quest_index.h"
+#include "size.h"
+#include <solarus/MapData.h>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtConcurrentMap>
+
+namespace SolarusEditor {
+
+using Reference = QuestIndex::Reference;
+using ReferenceKind = QuestIndex::ReferenceKind;
+using NamedEntity = QuestIndex::NamedEntity;
+using MapInfo = QuestIndex::MapInfo;
+
+namespace {
+
+/**
+ * @brief Magic number at the beginning of the cache file.
+ */
+constexpr quint32 cache_magic = 0x534d4958;  // "SMIX"
+
+/**
+ * @brief Version of the cache file format.
+ *
+ * Increment it whenever the information stored changes, so that old caches
+ * are ignored.
+ */
+constexpr quint32 cache_version = 2;
+
+/**
+ * @brief Entity fields whose value is the id of a resource element.
+ */
+const QMap<QString, ResourceType> resource_fields = {
+  { "breed",             ResourceType::ENEMY  },
+  { "destination_map",   ResourceType::MAP    },
+  { "destruction_sound", ResourceType::SOUND  },
+  { "font",              ResourceType::FONT   },
+  { "model",             ResourceType::ENTITY },
+  { "sound",             ResourceType::SOUND  },
+  { "sprite",            ResourceType::SPRITE },
+  { "treasure_name",     ResourceType::ITEM   },
+};
+
+/**
+ * @brief Entity fields whose value is a dialog id.
+ */
+const QStringList dialog_fields = {
+  "cannot_open_dialog",
+  "dialog",
+};
+
+/**
+ * @brief A map to be parsed in a worker thread.
+ */
+struct MapFile {
+  QString map_id;
+  QString path;
+};
+
+/**
+ * @brief Builds the key identifying the target of a reference.
+ * @param kind Kind of reference.
+ * @param resource_type Resource type (only for resource references).
+ * @param target_id Id of the referenced element.
+ * @param target_map_id Map of the referenced element (only for destinations).
+ * @return A string unique for each referenced element.
+ */
+QString make_target_key(
+    ReferenceKind kind,
+    ResourceType resource_type,
+    const QString& target_id,
+    const QString& target_map_id) {
+
+  switch (kind) {
+
+  case ReferenceKind::RESOURCE:
+    return QString("resource/%1/%2").
+        arg(static_cast<int>(resource_type)).arg(target_id);
+
+  case ReferenceKind::DIALOG:
+    return "dialog/" + target_id;
+
+  case ReferenceKind::DESTINATION:
+    return "destination/" + target_map_id + '/' + target_id;
+
+  }
+  return QString();
+}
+
+/**
+ * @brief Builds the key identifying the target of a reference.
+ * @param reference A reference.
+ * @return A string unique for each referenced element.
+ */
+QString make_target_key(const Reference& reference) {
+
+  return make_target_key(
+        reference.kind,
+        reference.resource_type,
+        reference.target_id,
+        reference.target_map_id);
+}
+
+/**
+ * @brief Creates a reference from a map property or an entity.
+ * @param kind Kind of reference.
+ * @param resource_type Resource type (only for resource references).
+ * @param target_id Id of the referenced element.
+ * @param map_id The map making the reference.
+ * @param key Field holding the reference.
+ * @return The reference, not attached to any entity.
+ */
+Reference make_reference(
+    ReferenceKind kind,
+    ResourceType resource_type,
+    const QString& target_id,
+    const QString& map_id,
+    const QString& key) {
+
+  Reference reference;
+  reference.kind = kind;
+  reference.resource_type = resource_type;
+  reference.target_id = target_id;
+  reference.map_id = map_id;
+  reference.entity_index = EntityIndex();
+  reference.entity_type = EntityType();
+  reference.key = key;
+  return reference;
+}
+
+/**
+ * @brief Parses a map in a worker thread.
+ * @param map_file The map to parse.
+ * @return The information extracted from the map.
+ */
+MapInfo parse_map_in_worker(const MapFile& map_file) {
+
+  return QuestIndex::parse_map_file(map_file.map_id, map_file.path);
+}
+
+}  // Anonymous namespace.
+
+// Serialization of the index for the cache file.
+
+QDataStream& operator<<(QDataStream& out, const EntityIndex& index) {
+  return out << qint32(index.layer) << qint32(index.order);
+}
+
+QDataStream& operator>>(QDataStream& in, EntityIndex& index) {
+  qint32 layer = 0, order = 0;
+  in >> layer >> order;
+  index = { layer, order };
+  return in;
+}
+
+QDataStream& operator<<(QDataStream& out, const Reference& reference) {
+  return out << qint32(reference.kind)
+             << qint32(reference.resource_type)
+             << reference.target_id
+             << reference.target_map_id
+             << reference.map_id
+             << reference.entity_index
+             << qint32(reference.entity_type)
+             << reference.entity_name
+             << reference.key;
+}
+
+QDataStream& operator>>(QDataStream& in, Reference& reference) {
+  qint32 kind = 0, resource_type = 0, entity_type = 0;
+  in >> kind
+     >> resource_type
+     >> reference.target_id
+     >> reference.target_map_id
+     >> reference.map_id
+     >> reference.entity_index
+     >> entity_type
+     >> reference.entity_name
+     >> reference.key;
+  reference.kind = static_cast<ReferenceKind>(kind);
+  reference.resource_type = static_cast<ResourceType>(resource_type);
+  reference.entity_type = static_cast<EntityType>(entity_type);
+  return in;
+}
+
+QDataStream& operator<<(QDataStream& out, const NamedEntity& entity) {
+  return out << entity.name << qint32(entity.type) << entity.index;
+}
+
+QDataStream& operator>>(QDataStream& in, NamedEntity& entity) {
+  qint32 type = 0;
+  in >> entity.name >> type >> entity.index;
+  entity.type = static_cast<EntityType>(type);
+  return in;
+}
+
+QDataStream& operator<<(QDataStream& out, const MapInfo& map_info) {
+  return out << map_info.map_id
+             << map_info.valid
+             << map_info.last_modified
+             << map_info.file_size
+             << map_info.size
+             << qint32(map_info.min_layer)
+             << qint32(map_info.max_layer)
+             << map_info.world
+             << qint32(map_info.floor)
+             << map_info.location
+             << map_info.tileset_id
+             << map_info.music_id
+             << map_info.named_entities
+             << map_info.references
+             << map_info.pattern_counts;
+}
+
+QDataStream& operator>>(QDataStream& in, MapInfo& map_info) {
+  qint32 min_layer = 0, max_layer = 0, floor = 0;
+  in >> map_info.map_id
+     >> map_info.valid
+     >> map_info.last_modified
+     >> map_info.file_size
+     >> map_info.size
+     >> min_layer
+     >> max_layer
+     >> map_info.world
+     >> floor
+     >> map_info.location
+     >> map_info.tileset_id
+     >> map_info.music_id
+     >> map_info.named_entities
+     >> map_info.references
+     >> map_info.pattern_counts;
+  map_info.min_layer = min_layer;
+  map_info.max_layer = max_layer;
+  map_info.floor = floor;
+  return in;
+}
+
+/**
+ * @brief Creates an empty map information.
+ */
+QuestIndex::MapInfo::MapInfo() :
+  map_id(),
+  valid(false),
+  last_modified(0),
+  file_size(0),
+  size(),
+  min_layer(0),
+  max_layer(0),
+  world(),
+  floor(Solarus::MapData::NO_FLOOR),
+  location(),
+  tileset_id(),
+  music_id(),
+  named_entities(),
+  references(),
+  pattern_counts() {
+}
+
+/**
+ * @brief Creates the index of a quest.
+ *
+ * The index is automatically loaded and built when the quest path changes.
+ *
+ * @param quest The quest to index.
+ */
+QuestIndex::QuestIndex(Quest& quest) :
+  quest(quest),
+  maps(),
+  referencing_maps(),
+  pattern_usage(),
+  cache_dirty(false),
+  batch_signals(false),
+  build_watcher() {
+
+  connect(&build_watcher, SIGNAL(resultReadyAt(int)),
+          this, SLOT(map_parsed(int)));
+  connect(&build_watcher, SIGNAL(finished()),
+          this, SLOT(build_finished_in_worker()));
+
+  connect(&quest, SIGNAL(root_path_changed(const QString&)),
+          this, SLOT(reload()));
+  connect(&quest, SIGNAL(file_created(QString)),
+          this, SLOT(file_created(QString)));
+  connect(&quest, SIGNAL(file_renamed(QString, QString)),
+          this, SLOT(file_renamed(QString, QString)));
+  connect(&quest, SIGNAL(file_deleted(QString)),
+          this, SLOT(file_deleted(QString)));
+  reload();
+}
+
+/**
+ * @brief Destroys the index.
+ *
+ * Waits for worker threads and writes the cache if needed.
+ */
+QuestIndex::~QuestIndex() {
+
+  cancel_build();
+  save_cache();
+}
+
+/**
+ * @brief Forgets everything and loads the index of the new quest.
+ *
+ * Called when the quest path changes.
+ */
+void QuestIndex::reload() {
+
+  cancel_build();
+  maps.clear();
+  referencing_maps.clear();
+  pattern_usage.clear();
+  cache_dirty = false;
+  batch_signals = false;
+
+  if (!quest.is_valid()) {
+    return;
+  }
+
+  load_cache();
+  rebuild();
+}
+
+/**
+ * @brief Returns whether maps are currently being parsed in the background.
+ * @return @c true if the index is being built.
+ */
+bool QuestIndex::is_building() const {
+
+  return build_watcher.isRunning();
+}
+
+/**
+ * @brief Returns the ids of all maps currently in the index.
+ * @return The indexed map ids.
+ */
+QStringList QuestIndex::get_map_ids() const {
+
+  return maps.keys();
+}
+
+/**
+ * @brief Returns whether a map is already in the index.
+ *
+ * The information may be outdated if the map file was modified externally
+ * and the index is not rebuilt yet.
+ *
+ * @param map_id Id of a map.
+ * @return @c true if there is information for this map.
+ */
+bool QuestIndex::has_map_info(const QString& map_id) const {
+
+  return maps.contains(map_id);
+}
+
+/**
+ * @brief Returns the information of a map.
+ *
+ * If the map is not indexed yet, it is parsed immediately.
+ * If its file has changed since it was indexed, the information already
+ * known is returned and the index is refreshed in the background:
+ * build_finished() will be emitted when it is up to date.
+ *
+ * @param map_id Id of a map.
+ * @return The map information. It is not valid if the map file does not exist
+ * or could not be parsed.
+ */
+MapInfo QuestIndex::get_map_info(const QString& map_id) {
+
+  auto it = maps.constFind(map_id);
+  if (it == maps.constEnd()) {
+    update_map(map_id);
+    return maps.value(map_id);
+  }
+
+  const MapInfo map_info = *it;
+  if (!is_building() && !is_up_to_date(map_info)) {
+    rebuild();
+  }
+  return map_info;
+}
+
+/**
+ * @brief Returns the name and type of all named entities of a map.
+ * @param map_info Information of a map.
+ * @return The named entities, sorted by name.
+ */
+QMap<QString, EntityType> QuestIndex::get_named_entities(const MapInfo& map_info) {
+
+  QMap<QString, EntityType> result;
+  Q_FOREACH (const NamedEntity& entity, map_info.named_entities) {
+    result.insert(entity.name, entity.type);
+  }
+  return result;
+}
+
+/**
+ * @brief Returns all references to a resource element from maps.
+ * @param resource_type A type of resource.
+ * @param element_id Id of the element.
+ * @return The references to this element.
+ */
+QList<Reference> QuestIndex::find_references(
+    ResourceType resource_type, const QString& element_id) const {
+
+  return find_references(make_target_key(
+      ReferenceKind::RESOURCE, resource_type, element_id, QString()));
+}
+
+/**
+ * @brief Returns all references to a dialog from maps.
+ * @param dialog_id Id of a dialog.
+ * @return The references to this dialog.
+ */
+QList<Reference> QuestIndex::find_dialog_references(const QString& dialog_id) const {
+
+  return find_references(make_target_key(
+      ReferenceKind::DIALOG, ResourceType(), dialog_id, QString()));
+}
+
+/**
+ * @brief Returns all teletransporters going to a destination of a map.
+ * @param map_id Id of the map containing the destination.
+ * @param destination_name Name of the destination.
+ * @return The references to this destination.
+ */
+QList<Reference> QuestIndex::find_destination_references(
+    const QString& map_id, const QString& destination_name) const {
+
+  return find_references(make_target_key(
+      ReferenceKind::DESTINATION, ResourceType(), destination_name, map_id));
+}
+
+/**
+ * @brief Returns how many times a tile pattern is used in all maps.
+ *
+ * Tiles and dynamic tiles of maps using the tileset are counted.
+ * Scripts and unsaved changes of open maps are not taken into account.
+ *
+ * @param tileset_id Id of a tileset.
+ * @param pattern_id Id of a pattern of this tileset.
+ * @return The number of tiles using this pattern.
+ */
+int QuestIndex::get_pattern_usage(
+    const QString& tileset_id, const QString& pattern_id) const {
+
+  int count = 0;
+  const QMap<QString, int>& counts =
+      pattern_usage.value(tileset_id).value(pattern_id);
+  Q_FOREACH (int map_count, counts) {
+    count += map_count;
+  }
+  return count;
+}
+
+/**
+ * @brief Returns the maps that use a tile pattern.
+ * @param tileset_id Id of a tileset.
+ * @param pattern_id Id of a pattern of this tileset.
+ * @return The number of tiles using this pattern in each map that uses it.
+ */
+QMap<QString, int> QuestIndex::get_maps_using_pattern(
+    const QString& tileset_id, const QString& pattern_id) const {
+
+  return pattern_usage.value(tileset_id).value(pattern_id);
+}
+
+/**
+ * @brief Returns the ids of the patterns of a tileset used by at least one map.
+ * @param tileset_id Id of a tileset.
+ * @return The patterns used.
+ */
+QSet<QString> QuestIndex::get_used_patterns(const QString& tileset_id) const {
+
+  return pattern_usage.value(tileset_id).keys().toSet();
+}
+
+/**
+ * @brief Returns all references with the given target key.
+ * @param target_key A key built by make_target_key().
+ * @return The references to this target.
+ */
+QList<Reference> QuestIndex::find_references(const QString& target_key) const {
+
+  QList<Reference> result;
+  const QSet<QString>& map_ids = referencing_maps.value(target_key);
+  Q_FOREACH (const QString& map_id, map_ids) {
+    Q_FOREACH (const Reference& reference, maps.value(map_id).references) {
+      if (make_target_key(reference) == target_key) {
+        result << reference;
+      }
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Parses a map data file and extracts the information to index.
+ *
+ * This function does not use any model or GUI class:
+ * it is safe to call it from worker threads.
+ *
+ * @param map_id Id of the map.
+ * @param path Path of the map data file.
+ * @return The map information.
+ */
+MapInfo QuestIndex::parse_map_file(const QString& map_id, const QString& path) {
+
+  MapInfo map_info;
+  map_info.map_id = map_id;
+
+  QFileInfo file_info(path);
+  map_info.last_modified = file_info.lastModified().toMSecsSinceEpoch();
+  map_info.file_size = file_info.size();
+
+  Solarus::MapData map;
+  if (!file_info.exists() || !map.import_from_file(path.toStdString())) {
+    return map_info;
+  }
+
+  MapInfo parsed_map_info = parse_map_data(map_id, map);
+  parsed_map_info.last_modified = map_info.last_modified;
+  parsed_map_info.file_size = map_info.file_size;
+  return parsed_map_info;
+}
+
+/**
+ * @brief Extracts the information to index from map data already loaded.
+ *
+ * This function does not use any model or GUI class:
+ * it is safe to call it from worker threads.
+ * The file date and size of the result are not set.
+ *
+ * @param map_id Id of the map.
+ * @param map The map data.
+ * @return The map information.
+ */
+MapInfo QuestIndex::parse_map_data(const QString& map_id, const Solarus::MapData& map) {
+
+  MapInfo map_info;
+  map_info.map_id = map_id;
+  map_info.valid = true;
+  map_info.size = Size::to_qsize(map.get_size());
+  map_info.min_layer = map.get_min_layer();
+  map_info.max_layer = map.get_max_layer();
+  map_info.world = QString::fromStdString(map.get_world());
+  map_info.floor = map.get_floor();
+  map_info.location = Point::to_qpoint(map.get_location());
+  map_info.tileset_id = QString::fromStdString(map.get_tileset_id());
+  map_info.music_id = QString::fromStdString(map.get_music_id());
+
+  // References from map properties.
+  if (!map_info.tileset_id.isEmpty()) {
+    map_info.references << make_reference(
+        ReferenceKind::RESOURCE, ResourceType::TILESET, map_info.tileset_id, map_id, "tileset");
+  }
+  if (!map_info.music_id.isEmpty() &&
+      map_info.music_id != "none" &&
+      map_info.music_id != "same") {
+    map_info.references << make_reference(
+        ReferenceKind::RESOURCE, ResourceType::MUSIC, map_info.music_id, map_id, "music");
+  }
+
+  // Named entities and references from entities.
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    for (int i = 0; i < map.get_num_entities(layer); ++i) {
+      const EntityIndex index = { layer, i };
+      const Solarus::EntityData& entity = map.get_entity(index);
+      const EntityType type = entity.get_type();
+      const QString name = QString::fromStdString(entity.get_name());
+
+      if ((type == EntityType::TILE || type == EntityType::DYNAMIC_TILE) &&
+          entity.is_string("pattern")) {
+        const QString pattern_id = QString::fromStdString(entity.get_string("pattern"));
+        ++map_info.pattern_counts[pattern_id];
+      }
+
+      if (!name.isEmpty()) {
+        NamedEntity named_entity;
+        named_entity.name = name;
+        named_entity.type = type;
+        named_entity.index = index;
+        map_info.named_entities << named_entity;
+      }
+
+      QList<Reference> entity_references;
+      for (auto it = resource_fields.begin(); it != resource_fields.end(); ++it) {
+        const std::string key = it.key().toStdString();
+        if (!entity.is_string(key)) {
+          continue;
+        }
+        const QString value = QString::fromStdString(entity.get_string(key));
+        if (!value.isEmpty()) {
+          entity_references << make_reference(
+              ReferenceKind::RESOURCE, it.value(), value, map_id, it.key());
+        }
+      }
+
+      Q_FOREACH (const QString& field, dialog_fields) {
+        const std::string key = field.toStdString();
+        if (!entity.is_string(key)) {
+          continue;
+        }
+        const QString value = QString::fromStdString(entity.get_string(key));
+        if (!value.isEmpty()) {
+          entity_references << make_reference(
+              ReferenceKind::DIALOG, ResourceType(), value, map_id, field);
+        }
+      }
+
+      if (entity.is_string("behavior")) {
+        // "map", "dialog#xxx" or "item#xxx".
+        const QString behavior = QString::fromStdString(entity.get_string("behavior"));
+        const QString target_id = behavior.section('#', 1);
+        if (behavior.startsWith("dialog#") && !target_id.isEmpty()) {
+          entity_references << make_reference(
+              ReferenceKind::DIALOG, ResourceType(), target_id, map_id, "behavior");
+        }
+        else if (behavior.startsWith("item#") && !target_id.isEmpty()) {
+          entity_references << make_reference(
+              ReferenceKind::RESOURCE, ResourceType::ITEM, target_id, map_id, "behavior");
+        }
+      }
+
+      if (entity.is_string("destination_map") && entity.is_string("destination")) {
+        // Special destination values are not entities.
+        const QString destination = QString::fromStdString(entity.get_string("destination"));
+        const QString destination_map = QString::fromStdString(entity.get_string("destination_map"));
+        if (!destination.isEmpty() &&
+            destination != "_same" &&
+            destination != "_side" &&
+            !destination_map.isEmpty()) {
+          Reference reference = make_reference(
+                ReferenceKind::DESTINATION, ResourceType(), destination, map_id, "destination");
+          reference.target_map_id = destination_map;
+          entity_references << reference;
+        }
+      }
+
+      for (Reference& reference : entity_references) {
+        reference.entity_index = index;
+        reference.entity_type = type;
+        reference.entity_name = name;
+      }
+      map_info.references << entity_references;
+    }
+  }
+
+  return map_info;
+}
+
+/**
+ * @brief Parses again all maps whose file has changed since they were indexed.
+ *
+ * Maps are parsed in background threads. build_finished() is emitted
+ * at the end.
+ */
+void QuestIndex::rebuild() {
+
+  cancel_build();
+
+  if (!quest.is_valid()) {
+    return;
+  }
+
+  batch_signals = true;
+  QList<MapFile> outdated_maps;
+  Q_FOREACH (const QString& map_id, remove_undeclared_and_get_outdated_maps()) {
+    outdated_maps << MapFile{ map_id, quest.get_map_data_file_path(map_id) };
+  }
+
+  if (outdated_maps.isEmpty()) {
+    batch_signals = false;
+    save_cache();
+    emit build_finished();
+    return;
+  }
+
+  build_watcher.setFuture(QtConcurrent::mapped(outdated_maps, parse_map_in_worker));
+}
+
+/**
+ * @brief Brings the whole index up to date before returning.
+ *
+ * Like rebuild(), but blocks until all outdated maps are parsed.
+ * Maps are still parsed in parallel.
+ * Call this function before an operation that needs exact results,
+ * like rewriting references.
+ */
+void QuestIndex::update_all() {
+
+  cancel_build();
+
+  if (!quest.is_valid()) {
+    return;
+  }
+
+  batch_signals = true;
+  QList<MapFile> outdated_maps;
+  Q_FOREACH (const QString& map_id, remove_undeclared_and_get_outdated_maps()) {
+    outdated_maps << MapFile{ map_id, quest.get_map_data_file_path(map_id) };
+  }
+
+  const QList<MapInfo>& results =
+      QtConcurrent::blockingMapped<QList<MapInfo>>(outdated_maps, parse_map_in_worker);
+  Q_FOREACH (const MapInfo& map_info, results) {
+    set_map_info(map_info);
+  }
+
+  batch_signals = false;
+  save_cache();
+  emit build_finished();
+}
+
+/**
+ * @brief Forgets maps that are no longer declared in the quest.
+ * @return The ids of declared maps that are not indexed yet or whose
+ * file has changed since they were indexed.
+ */
+QStringList QuestIndex::remove_undeclared_and_get_outdated_maps() {
+
+  const QStringList& map_ids = quest.get_resources().get_elements(ResourceType::MAP);
+  const QSet<QString> declared_map_ids = map_ids.toSet();
+  Q_FOREACH (const QString& map_id, maps.keys()) {
+    if (!declared_map_ids.contains(map_id)) {
+      remove_map_info(map_id);
+    }
+  }
+
+  QStringList outdated_map_ids;
+  Q_FOREACH (const QString& map_id, map_ids) {
+    auto it = maps.constFind(map_id);
+    if (it == maps.constEnd() || !is_up_to_date(*it)) {
+      outdated_map_ids << map_id;
+    }
+  }
+  return outdated_map_ids;
+}
+
+/**
+ * @brief Stops parsing maps in background threads if this is in progress.
+ *
+ * Blocks until worker threads have finished their current map.
+ */
+void QuestIndex::cancel_build() {
+
+  if (build_watcher.isRunning()) {
+    build_watcher.cancel();
+    build_watcher.waitForFinished();
+  }
+}
+
+/**
+ * @brief Slot called when a worker thread has parsed a map.
+ * @param result_index Index of the result in the future.
+ */
+void QuestIndex::map_parsed(int result_index) {
+
+  const MapInfo& map_info = build_watcher.resultAt(result_index);
+
+  auto it = maps.constFind(map_info.map_id);
+  if (it != maps.constEnd() && it->last_modified > map_info.last_modified) {
+    // The map was updated meanwhile from the main thread.
+    return;
+  }
+
+  set_map_info(map_info);
+}
+
+/**
+ * @brief Slot called when worker threads have finished parsing maps.
+ */
+void QuestIndex::build_finished_in_worker() {
+
+  if (build_watcher.isCanceled()) {
+    return;
+  }
+
+  batch_signals = false;
+  save_cache();
+  emit build_finished();
+}
+
+/**
+ * @brief Parses again a map immediately.
+ *
+ * Call this function when you know that a map file has just changed.
+ *
+ * @param map_id Id of the map to update.
+ */
+void QuestIndex::update_map(const QString& map_id) {
+
+  const QString& path = quest.get_map_data_file_path(map_id);
+  if (!quest.get_resources().exists(ResourceType::MAP, map_id) ||
+      !QFileInfo(path).exists()) {
+    remove_map_info(map_id);
+    return;
+  }
+
+  set_map_info(parse_map_file(map_id, path));
+}
+
+/**
+ * @brief Returns whether the information of a map matches its file.
+ * @param map_info Information of a map.
+ * @return @c true if the map file has not changed since it was parsed.
+ */
+bool QuestIndex::is_up_to_date(const MapInfo& map_info) const {
+
+  QFileInfo file_info(quest.get_map_data_file_path(map_info.map_id));
+  return file_info.exists() &&
+      file_info.lastModified().toMSecsSinceEpoch() == map_info.last_modified &&
+      file_info.size() == map_info.file_size;
+}
+
+/**
+ * @brief Adds or replaces the information of a map.
+ *
+ * Emits map_info_changed() unless a build is in progress.
+ *
+ * @param map_info The new information.
+ */
+void QuestIndex::set_map_info(const MapInfo& map_info) {
+
+  const QString& map_id = map_info.map_id;
+
+  // Unregister old references.
+  QString old_tileset_id;
+  auto it = maps.constFind(map_id);
+  if (it != maps.constEnd()) {
+    Q_FOREACH (const Reference& reference, it->references) {
+      referencing_maps[make_target_key(reference)].remove(map_id);
+    }
+    old_tileset_id = it->tileset_id;
+    remove_pattern_usage(*it);
+  }
+
+  maps.insert(map_id, map_info);
+  Q_FOREACH (const Reference& reference, map_info.references) {
+    referencing_maps[make_target_key(reference)].insert(map_id);
+  }
+  add_pattern_usage(map_info);
+
+  cache_dirty = true;
+  if (batch_signals) {
+    return;
+  }
+
+  emit map_info_changed(map_id);
+
+  if (!old_tileset_id.isEmpty() && old_tileset_id != map_info.tileset_id) {
+    emit pattern_usage_changed(old_tileset_id);
+  }
+  if (!map_info.tileset_id.isEmpty()) {
+    emit pattern_usage_changed(map_info.tileset_id);
+  }
+}
+
+/**
+ * @brief Removes a map from the index.
+ *
+ * Emits map_info_removed() if the map was indexed
+ * and no build is in progress.
+ *
+ * @param map_id Id of the map to remove.
+ */
+void QuestIndex::remove_map_info(const QString& map_id) {
+
+  auto it = maps.find(map_id);
+  if (it == maps.end()) {
+    return;
+  }
+
+  Q_FOREACH (const Reference& reference, it->references) {
+    const QString& target_key = make_target_key(reference);
+    referencing_maps[target_key].remove(map_id);
+    if (referencing_maps[target_key].isEmpty()) {
+      referencing_maps.remove(target_key);
+    }
+  }
+  const QString tileset_id = it->tileset_id;
+  remove_pattern_usage(*it);
+  maps.erase(it);
+
+  cache_dirty = true;
+  if (batch_signals) {
+    return;
+  }
+
+  emit map_info_removed(map_id);
+
+  if (!tileset_id.isEmpty()) {
+    emit pattern_usage_changed(tileset_id);
+  }
+}
+
+/**
+ * @brief Registers the tile patterns used by a map.
+ * @param map_info Information of the map.
+ */
+void QuestIndex::add_pattern_usage(const MapInfo& map_info) {
+
+  if (map_info.tileset_id.isEmpty() || map_info.pattern_counts.isEmpty()) {
+    return;
+  }
+
+  QHash<QString, QMap<QString, int>>& usage = pattern_usage[map_info.tileset_id];
+  for (auto it = map_info.pattern_counts.constBegin();
+       it != map_info.pattern_counts.constEnd();
+       ++it) {
+    usage[it.key()].insert(map_info.map_id, it.value());
+  }
+}
+
+/**
+ * @brief Unregisters the tile patterns used by a map.
+ * @param map_info Information of the map as it was registered.
+ */
+void QuestIndex::remove_pattern_usage(const MapInfo& map_info) {
+
+  auto usage_it = pattern_usage.find(map_info.tileset_id);
+  if (usage_it == pattern_usage.end()) {
+    return;
+  }
+
+  QHash<QString, QMap<QString, int>>& usage = usage_it.value();
+  Q_FOREACH (const QString& pattern_id, map_info.pattern_counts.keys()) {
+    auto it = usage.find(pattern_id);
+    if (it == usage.end()) {
+      continue;
+    }
+    it->remove(map_info.map_id);
+    if (it->isEmpty()) {
+      usage.erase(it);
+    }
+  }
+  if (usage.isEmpty()) {
+    pattern_usage.erase(usage_it);
+  }
+}
+
+/**
+ * @brief Returns whether a path is the data file of a map.
+ * @param[in] path The path to test.
+ * @param[out] map_id Id of the map if this is a map data file.
+ * @return @c true if this is a map data file, even if the map is not
+ * declared yet.
+ */
+bool QuestIndex::is_map_data_file(const QString& path, QString& map_id) const {
+
+  ResourceType resource_type;
+  return path.endsWith(".dat") &&
+      quest.is_potential_resource_element(path, resource_type, map_id) &&
+      resource_type == ResourceType::MAP;
+}
+
+/**
+ * @brief Slot called when a file of the quest is created.
+ * @param path Path of the new file.
+ */
+void QuestIndex::file_created(const QString& path) {
+
+  QString map_id;
+  if (is_map_data_file(path, map_id)) {
+    update_map(map_id);
+  }
+}
+
+/**
+ * @brief Slot called when a file of the quest is renamed.
+ * @param old_path Old path of the file.
+ * @param new_path New path of the file.
+ */
+void QuestIndex::file_renamed(const QString& old_path, const QString& new_path) {
+
+  QString old_map_id;
+  QString new_map_id;
+  const bool old_is_map = is_map_data_file(old_path, old_map_id);
+  const bool new_is_map = is_map_data_file(new_path, new_map_id);
+
+  if (old_is_map) {
+    remove_map_info(old_map_id);
+  }
+  if (new_is_map) {
+    update_map(new_map_id);
+  }
+
+  ResourceType resource_type;
+  if (!old_is_map && !new_is_map &&
+      quest.is_in_resource_path(new_path, resource_type) &&
+      resource_type == ResourceType::MAP) {
+    // A directory of maps was probably renamed.
+    rebuild();
+  }
+}
+
+/**
+ * @brief Slot called when a file of the quest is deleted.
+ * @param path Path of the deleted file.
+ */
+void QuestIndex::file_deleted(const QString& path) {
+
+  QString map_id;
+  if (is_map_data_file(path, map_id)) {
+    remove_map_info(map_id);
+  }
+}
+
+/**
+ * @brief Returns the path of the file where the index is persisted.
+ * @return The cache file path or an empty string if there is no quest.
+ */
+QString QuestIndex::get_cache_file_path() const {
+
+  const QString& cache_path = quest.get_cache_path();
+  if (cache_path.isEmpty()) {
+    return QString();
+  }
+  return cache_path + "/map_index.dat";
+}
+
+/**
+ * @brief Loads the index previously persisted for this quest if any.
+ *
+ * An invalid or outdated cache file is ignored.
+ */
+void QuestIndex::load_cache() {
+
+  QFile file(get_cache_file_path());
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_2);
+  quint32 magic = 0, version = 0;
+  in >> magic >> version;
+  if (magic != cache_magic || version != cache_version) {
+    return;
+  }
+
+  QList<MapInfo> cached_maps;
+  in >> cached_maps;
+  if (in.status() != QDataStream::Ok) {
+    return;
+  }
+
+  Q_FOREACH (const MapInfo& map_info, cached_maps) {
+    set_map_info(map_info);
+  }
+  cache_dirty = false;
+}
+
+/**
+ * @brief Writes the index to the cache directory if it has changed.
+ */
+void QuestIndex::save_cache() {
+
+  if (!cache_dirty) {
+    return;
+  }
+
+  const QString& file_name = get_cache_file_path();
+  if (file_name.isEmpty()) {
+    return;
+  }
+
+  QDir().mkpath(QFileInfo(file_name).path());
+  QSaveFile file(file_name);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_5_2);
+  out << cache_magic << cache_version << maps.values();
+  if (file.commit()) {
+    cache_dirty = false;
+  }
+}
+
+}
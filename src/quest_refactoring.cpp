@@ -0,0 +1,868 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "editor_exception.h"
+#include "quest.h"
+#include "quest_refactoring.h"
+#include <solarus/DialogResources.h>
+#include <solarus/MapData.h>
+#include <solarus/StringResources.h>
+#include <QDirIterator>
+#include <QFile>
+#include <QRegExp>
+#include <QSet>
+#include <QtConcurrentMap>
+
+namespace SolarusEditor {
+
+using Change = QuestRefactoring::Change;
+using ChangeKind = QuestRefactoring::ChangeKind;
+
+namespace {
+
+/**
+ * @brief Suffix of the temporary file written next to each modified file.
+ */
+const QString new_file_suffix = ".refactoring-new";
+
+/**
+ * @brief Suffix of the backup of each modified file while changes are applied.
+ */
+const QString old_file_suffix = ".refactoring-old";
+
+/**
+ * @brief A Lua script to search for some string literals.
+ */
+struct ScriptSearch {
+  QString path;
+  QString pattern;
+};
+
+/**
+ * @brief A string literal found in a Lua script.
+ */
+struct ScriptMatch {
+  QString path;
+  int line;
+  QString value;
+};
+
+/**
+ * @brief A map to search for some tile patterns.
+ */
+struct PatternSearch {
+  QString map_id;
+  QString path;
+  QMap<QString, QString> new_pattern_ids;
+};
+
+/**
+ * @brief All changes to apply to a file.
+ */
+struct FileChanges {
+  QString path;
+  QList<Change> changes;
+};
+
+/**
+ * @brief Returns a regular expression matching quoted string literals.
+ * @param values The literals to find, without quotes.
+ * @return A pattern where the second capture is the literal found,
+ * or an empty string if there is no literal to find.
+ */
+QString make_literals_pattern(const QStringList& values) {
+
+  if (values.isEmpty()) {
+    return QString();
+  }
+
+  QStringList escaped_values;
+  Q_FOREACH (const QString& value, values) {
+    escaped_values << QRegExp::escape(value);
+  }
+  return "([\"'])(" + escaped_values.join('|') + ")\\1";
+}
+
+/**
+ * @brief Searches string literals in a Lua script.
+ *
+ * Called from worker threads.
+ *
+ * @param search The script and the pattern to find.
+ * @return The literals found.
+ */
+QList<ScriptMatch> search_script_in_worker(const ScriptSearch& search) {
+
+  QList<ScriptMatch> matches;
+  QFile file(search.path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return matches;
+  }
+
+  const QStringList& lines = QString::fromUtf8(file.readAll()).split('\n');
+  QRegExp regexp(search.pattern);
+  for (int i = 0; i < lines.size(); ++i) {
+    // Several occurrences of a literal on a line make a single change.
+    QSet<QString> values_found;
+    int position = 0;
+    while ((position = regexp.indexIn(lines[i], position)) != -1) {
+      const QString& value = regexp.cap(2);
+      if (!values_found.contains(value)) {
+        values_found.insert(value);
+        matches << ScriptMatch{ search.path, i + 1, value };
+      }
+      position += regexp.matchedLength();
+    }
+  }
+  return matches;
+}
+
+/**
+ * @brief Finds tiles and dynamic tiles using some patterns in a map.
+ *
+ * Called from worker threads.
+ *
+ * @param search The map and the patterns to find.
+ * @return The changes to make in the map.
+ */
+QList<Change> search_patterns_in_worker(const PatternSearch& search) {
+
+  QList<Change> changes;
+  Solarus::MapData map;
+  if (!map.import_from_file(search.path.toStdString())) {
+    return changes;
+  }
+
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    for (int i = 0; i < map.get_num_entities(layer); ++i) {
+      const EntityIndex index = { layer, i };
+      const Solarus::EntityData& entity = map.get_entity(index);
+      const EntityType type = entity.get_type();
+      if ((type != EntityType::TILE && type != EntityType::DYNAMIC_TILE) ||
+          !entity.is_string("pattern")) {
+        continue;
+      }
+
+      const QString pattern_id = QString::fromStdString(entity.get_string("pattern"));
+      auto it = search.new_pattern_ids.find(pattern_id);
+      if (it == search.new_pattern_ids.end()) {
+        continue;
+      }
+
+      Change change;
+      change.kind = ChangeKind::ENTITY_FIELD;
+      change.file_path = search.path;
+      change.location = QuestRefactoring::tr("Map '%1', %2 on layer %3 (#%4)").
+          arg(search.map_id, EntityTraits::get_friendly_name(type)).
+          arg(layer).arg(i);
+      change.entity_index = index;
+      change.key = "pattern";
+      change.line = 0;
+      change.old_value = pattern_id;
+      change.new_value = it.value();
+      change.safe = true;
+      changes << change;
+    }
+  }
+  return changes;
+}
+
+/**
+ * @brief Applies changes to a map and writes the result to a new file.
+ * @param file_changes The map file and the changes.
+ * @return An error message, or an empty string in case of success.
+ */
+QString rewrite_map(const FileChanges& file_changes) {
+
+  Solarus::MapData map;
+  if (!map.import_from_file(file_changes.path.toStdString())) {
+    return QuestRefactoring::tr("Cannot open map file '%1'").arg(file_changes.path);
+  }
+
+  Q_FOREACH (const Change& change, file_changes.changes) {
+    const std::string old_value = change.old_value.toStdString();
+    const std::string new_value = change.new_value.toStdString();
+
+    if (change.kind == ChangeKind::MAP_PROPERTY) {
+      if (change.key == "tileset" && map.get_tileset_id() == old_value) {
+        map.set_tileset_id(new_value);
+        continue;
+      }
+      if (change.key == "music" && map.get_music_id() == old_value) {
+        map.set_music_id(new_value);
+        continue;
+      }
+    }
+    else if (change.kind == ChangeKind::ENTITY_FIELD &&
+             map.entity_exists(change.entity_index)) {
+      Solarus::EntityData& entity = map.get_entity(change.entity_index);
+      const std::string key = change.key.toStdString();
+      if (entity.is_string(key) && entity.get_string(key) == old_value) {
+        entity.set_string(key, new_value);
+        continue;
+      }
+    }
+
+    return QuestRefactoring::tr("%1: value '%2' not found, the file has changed").
+        arg(change.location, change.old_value);
+  }
+
+  const QString& new_path = file_changes.path + new_file_suffix;
+  if (!map.export_to_file(new_path.toStdString())) {
+    return QuestRefactoring::tr("Cannot write file '%1'").arg(new_path);
+  }
+  return QString();
+}
+
+/**
+ * @brief Applies changes to a dialogs file and writes the result to a new file.
+ * @param file_changes The dialogs file and the changes.
+ * @return An error message, or an empty string in case of success.
+ */
+QString rewrite_dialogs(const FileChanges& file_changes) {
+
+  Solarus::DialogResources resources;
+  if (!resources.import_from_file(file_changes.path.toStdString())) {
+    return QuestRefactoring::tr("Cannot open dialogs file '%1'").arg(file_changes.path);
+  }
+
+  // Remove all old ids first so that ids can be swapped.
+  std::map<std::string, Solarus::DialogData> dialogs;
+  Q_FOREACH (const Change& change, file_changes.changes) {
+    const std::string old_id = change.old_value.toStdString();
+    if (!resources.has_dialog(old_id)) {
+      return QuestRefactoring::tr("%1: dialog '%2' not found, the file has changed").
+          arg(change.location, change.old_value);
+    }
+    dialogs[change.new_value.toStdString()] = resources.get_dialog(old_id);
+    resources.remove_dialog(old_id);
+  }
+  for (const auto& kvp : dialogs) {
+    if (resources.has_dialog(kvp.first)) {
+      return QuestRefactoring::tr("Dialog '%1' already exists in '%2'").
+          arg(QString::fromStdString(kvp.first), file_changes.path);
+    }
+    resources.add_dialog(kvp.first, kvp.second);
+  }
+
+  const QString& new_path = file_changes.path + new_file_suffix;
+  if (!resources.export_to_file(new_path.toStdString())) {
+    return QuestRefactoring::tr("Cannot write file '%1'").arg(new_path);
+  }
+  return QString();
+}
+
+/**
+ * @brief Applies changes to a strings file and writes the result to a new file.
+ * @param file_changes The strings file and the changes.
+ * @return An error message, or an empty string in case of success.
+ */
+QString rewrite_strings(const FileChanges& file_changes) {
+
+  Solarus::StringResources resources;
+  if (!resources.import_from_file(file_changes.path.toStdString())) {
+    return QuestRefactoring::tr("Cannot open strings file '%1'").arg(file_changes.path);
+  }
+
+  // Remove all old keys first so that keys can be swapped.
+  std::map<std::string, std::string> strings;
+  Q_FOREACH (const Change& change, file_changes.changes) {
+    const std::string old_key = change.old_value.toStdString();
+    if (!resources.has_string(old_key)) {
+      return QuestRefactoring::tr("%1: string '%2' not found, the file has changed").
+          arg(change.location, change.old_value);
+    }
+    strings[change.new_value.toStdString()] = resources.get_string(old_key);
+    resources.remove_string(old_key);
+  }
+  for (const auto& kvp : strings) {
+    if (resources.has_string(kvp.first)) {
+      return QuestRefactoring::tr("String '%1' already exists in '%2'").
+          arg(QString::fromStdString(kvp.first), file_changes.path);
+    }
+    resources.add_string(kvp.first, kvp.second);
+  }
+
+  const QString& new_path = file_changes.path + new_file_suffix;
+  if (!resources.export_to_file(new_path.toStdString())) {
+    return QuestRefactoring::tr("Cannot write file '%1'").arg(new_path);
+  }
+  return QString();
+}
+
+/**
+ * @brief Applies changes to a Lua script and writes the result to a new file.
+ * @param file_changes The script and the changes.
+ * @return An error message, or an empty string in case of success.
+ */
+QString rewrite_script(const FileChanges& file_changes) {
+
+  QFile file(file_changes.path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QuestRefactoring::tr("Cannot open file '%1'").arg(file_changes.path);
+  }
+  QStringList lines = QString::fromUtf8(file.readAll()).split('\n');
+  file.close();
+
+  Q_FOREACH (const Change& change, file_changes.changes) {
+    if (change.line < 1 || change.line > lines.size()) {
+      return QuestRefactoring::tr("%1: line not found, the file has changed").
+          arg(change.location);
+    }
+    QString& line = lines[change.line - 1];
+    QRegExp regexp(make_literals_pattern(QStringList() << change.old_value));
+    int position = regexp.indexIn(line);
+    if (position == -1) {
+      return QuestRefactoring::tr("%1: value '%2' not found, the file has changed").
+          arg(change.location, change.old_value);
+    }
+
+    // Replace only the text between quotes, literally.
+    while (position != -1) {
+      const int value_position = regexp.pos(2);
+      line.replace(value_position, change.old_value.length(), change.new_value);
+      position = regexp.indexIn(line, value_position + change.new_value.length() + 1);
+    }
+  }
+
+  QFile new_file(file_changes.path + new_file_suffix);
+  if (!new_file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+      new_file.write(lines.join('\n').toUtf8()) == -1) {
+    return QuestRefactoring::tr("Cannot write file '%1'").arg(new_file.fileName());
+  }
+  return QString();
+}
+
+/**
+ * @brief Writes the new version of a file.
+ *
+ * Called from worker threads. The original file is not modified.
+ *
+ * @param file_changes The file and the changes to apply to it.
+ * @return An error message, or an empty string in case of success.
+ */
+QString rewrite_file_in_worker(const FileChanges& file_changes) {
+
+  switch (file_changes.changes.first().kind) {
+
+  case ChangeKind::MAP_PROPERTY:
+  case ChangeKind::ENTITY_FIELD:
+    return rewrite_map(file_changes);
+
+  case ChangeKind::DIALOG_ID:
+    return rewrite_dialogs(file_changes);
+
+  case ChangeKind::STRING_KEY:
+    return rewrite_strings(file_changes);
+
+  case ChangeKind::SCRIPT_TEXT:
+    return rewrite_script(file_changes);
+
+  }
+  return QString();
+}
+
+}
+
+/**
+ * @brief Creates a refactoring engine for a quest.
+ * @param quest The quest to refactor.
+ */
+QuestRefactoring::QuestRefactoring(Quest& quest) :
+  quest(quest) {
+
+}
+
+/**
+ * @brief Computes the changes needed to rename a resource element.
+ *
+ * The resource element itself is not renamed: use
+ * Quest::rename_resource_element() after applying the changes.
+ *
+ * @param resource_type A type of resource.
+ * @param old_id Current id of the element.
+ * @param new_id New id of the element.
+ * @return The changes to apply to maps and scripts.
+ */
+QList<Change> QuestRefactoring::plan_resource_renaming(
+    ResourceType resource_type, const QString& old_id, const QString& new_id) {
+
+  QuestIndex& index = quest.get_index();
+  index.update_all();
+
+  QList<Change> changes = plan_map_changes(
+        index.find_references(resource_type, old_id), old_id, new_id);
+
+  QMap<QString, QString> new_values;
+  new_values.insert(old_id, new_id);
+  changes << plan_script_changes(new_values);
+  return changes;
+}
+
+/**
+ * @brief Returns the places of maps that would be broken if a resource
+ * element was deleted.
+ *
+ * The quest index is used as it is, without waiting for outdated maps
+ * or searching scripts, so that this can be called before showing a
+ * confirmation dialog.
+ *
+ * @param resource_type A type of resource.
+ * @param element_id Id of the element.
+ * @return The references to this element from maps known by the index.
+ * The new value of changes is empty.
+ */
+QList<Change> QuestRefactoring::find_resource_usages(
+    ResourceType resource_type, const QString& element_id) {
+
+  const QuestIndex& index = quest.get_index();
+  return plan_map_changes(
+        index.find_references(resource_type, element_id), element_id, QString());
+}
+
+/**
+ * @brief Computes the changes needed to rename dialogs.
+ *
+ * Dialogs of the other languages, maps and scripts are updated.
+ * The dialogs file of the given language is not modified:
+ * the caller is responsible for it.
+ *
+ * @param language_id The language where dialogs are renamed.
+ * @param new_ids New id of each renamed dialog, indexed by old id.
+ * @return The changes to apply.
+ */
+QList<Change> QuestRefactoring::plan_dialog_renaming(
+    const QString& language_id, const QMap<QString, QString>& new_ids) {
+
+  QList<Change> changes;
+
+  // Translations.
+  Q_FOREACH (const QString& other_language_id,
+             quest.get_resources().get_elements(ResourceType::LANGUAGE)) {
+    if (other_language_id == language_id) {
+      continue;
+    }
+
+    const QString& path = quest.get_dialogs_path(other_language_id);
+    Solarus::DialogResources resources;
+    if (!QFile::exists(path) || !resources.import_from_file(path.toStdString())) {
+      continue;
+    }
+
+    for (auto it = new_ids.begin(); it != new_ids.end(); ++it) {
+      if (resources.has_dialog(it.key().toStdString())) {
+        Change change;
+        change.kind = ChangeKind::DIALOG_ID;
+        change.file_path = path;
+        change.location = tr("Dialogs of language '%1'").arg(other_language_id);
+        change.entity_index = EntityIndex();
+        change.line = 0;
+        change.old_value = it.key();
+        change.new_value = it.value();
+        change.safe = true;
+        changes << change;
+      }
+    }
+  }
+
+  // Maps.
+  QuestIndex& index = quest.get_index();
+  index.update_all();
+  for (auto it = new_ids.begin(); it != new_ids.end(); ++it) {
+    changes << plan_map_changes(
+                 index.find_dialog_references(it.key()), it.key(), it.value());
+  }
+
+  // Scripts.
+  changes << plan_script_changes(new_ids);
+  return changes;
+}
+
+/**
+ * @brief Computes the changes needed to rename strings.
+ *
+ * Strings of the other languages and scripts are updated.
+ * The strings file of the given language is not modified:
+ * the caller is responsible for it.
+ *
+ * @param language_id The language where strings are renamed.
+ * @param new_keys New key of each renamed string, indexed by old key.
+ * @return The changes to apply.
+ */
+QList<Change> QuestRefactoring::plan_string_renaming(
+    const QString& language_id, const QMap<QString, QString>& new_keys) {
+
+  QList<Change> changes;
+
+  // Translations.
+  Q_FOREACH (const QString& other_language_id,
+             quest.get_resources().get_elements(ResourceType::LANGUAGE)) {
+    if (other_language_id == language_id) {
+      continue;
+    }
+
+    const QString& path = quest.get_strings_path(other_language_id);
+    Solarus::StringResources resources;
+    if (!QFile::exists(path) || !resources.import_from_file(path.toStdString())) {
+      continue;
+    }
+
+    for (auto it = new_keys.begin(); it != new_keys.end(); ++it) {
+      if (resources.has_string(it.key().toStdString())) {
+        Change change;
+        change.kind = ChangeKind::STRING_KEY;
+        change.file_path = path;
+        change.location = tr("Strings of language '%1'").arg(other_language_id);
+        change.entity_index = EntityIndex();
+        change.line = 0;
+        change.old_value = it.key();
+        change.new_value = it.value();
+        change.safe = true;
+        changes << change;
+      }
+    }
+  }
+
+  // Scripts.
+  changes << plan_script_changes(new_keys);
+  return changes;
+}
+
+/**
+ * @brief Computes the changes needed to replace tile patterns by other ones
+ * in all maps using a tileset.
+ *
+ * The tileset itself is not modified: the caller is responsible for it.
+ * Maps are found with the quest index and parsed in parallel.
+ * Scripts are not searched since pattern ids are rarely used there and
+ * would give a lot of false positives.
+ *
+ * @param tileset_id Id of the tileset.
+ * @param new_pattern_ids New pattern of each tile to change, indexed by
+ * old pattern id.
+ * @return The changes to apply.
+ */
+QList<Change> QuestRefactoring::plan_pattern_renaming(
+    const QString& tileset_id, const QMap<QString, QString>& new_pattern_ids) {
+
+  QuestIndex& index = quest.get_index();
+  index.update_all();
+
+  QSet<QString> map_ids;
+  Q_FOREACH (const QString& pattern_id, new_pattern_ids.keys()) {
+    map_ids.unite(index.get_maps_using_pattern(tileset_id, pattern_id).keys().toSet());
+  }
+
+  QList<PatternSearch> searches;
+  Q_FOREACH (const QString& map_id, map_ids) {
+    searches << PatternSearch{
+      map_id, quest.get_map_data_file_path(map_id), new_pattern_ids
+    };
+  }
+
+  const QList<QList<Change>>& results =
+      QtConcurrent::blockingMapped<QList<QList<Change>>>(
+        searches, search_patterns_in_worker);
+
+  QList<Change> changes;
+  Q_FOREACH (const QList<Change>& map_changes, results) {
+    changes << map_changes;
+  }
+  return changes;
+}
+
+/**
+ * @brief Converts references from maps into changes.
+ * @param references References to an element.
+ * @param old_id Current id of the element.
+ * @param new_id New id of the element.
+ * @return The corresponding changes.
+ */
+QList<Change> QuestRefactoring::plan_map_changes(
+    const QList<QuestIndex::Reference>& references,
+    const QString& old_id,
+    const QString& new_id) {
+
+  QList<Change> changes;
+  Q_FOREACH (const QuestIndex::Reference& reference, references) {
+
+    Change change;
+    change.file_path = quest.get_map_data_file_path(reference.map_id);
+    change.entity_index = reference.entity_index;
+    change.key = reference.key;
+    change.line = 0;
+    change.old_value = old_id;
+    change.new_value = new_id;
+    change.safe = true;
+
+    if (!reference.entity_index.is_valid()) {
+      change.kind = ChangeKind::MAP_PROPERTY;
+      change.location = tr("Map '%1'").arg(reference.map_id);
+    }
+    else {
+      change.kind = ChangeKind::ENTITY_FIELD;
+      const QString& type_name = EntityTraits::get_friendly_name(reference.entity_type);
+      if (!reference.entity_name.isEmpty()) {
+        change.location = tr("Map '%1', %2 '%3'").
+            arg(reference.map_id, type_name, reference.entity_name);
+      }
+      else {
+        change.location = tr("Map '%1', %2 on layer %3 (#%4)").
+            arg(reference.map_id, type_name).
+            arg(reference.entity_index.layer).
+            arg(reference.entity_index.order);
+      }
+    }
+
+    if (reference.key == "behavior") {
+      // "dialog#xxx" or "item#xxx".
+      const QString& prefix =
+          reference.kind == QuestIndex::ReferenceKind::DIALOG ? "dialog#" : "item#";
+      change.old_value = prefix + old_id;
+      change.new_value = prefix + new_id;
+    }
+
+    changes << change;
+  }
+  return changes;
+}
+
+/**
+ * @brief Finds string literals to replace in all Lua scripts of the quest.
+ *
+ * Scripts are searched in parallel.
+ * Since this is a textual search, the changes found are not marked as safe.
+ *
+ * @param new_values New value of each literal to replace, indexed by old value.
+ * @return The corresponding changes.
+ */
+QList<Change> QuestRefactoring::plan_script_changes(
+    const QMap<QString, QString>& new_values) {
+
+  if (new_values.isEmpty()) {
+    return QList<Change>();
+  }
+
+  const QString& pattern = make_literals_pattern(new_values.keys());
+  QList<ScriptSearch> searches;
+  Q_FOREACH (const QString& path, get_script_paths()) {
+    searches << ScriptSearch{ path, pattern };
+  }
+
+  const QList<QList<ScriptMatch>>& results =
+      QtConcurrent::blockingMapped<QList<QList<ScriptMatch>>>(
+        searches, search_script_in_worker);
+
+  const QString& data_path = quest.get_data_path();
+  QList<Change> changes;
+  Q_FOREACH (const QList<ScriptMatch>& matches, results) {
+    Q_FOREACH (const ScriptMatch& match, matches) {
+      Change change;
+      change.kind = ChangeKind::SCRIPT_TEXT;
+      change.file_path = match.path;
+      change.location = tr("%1, line %2").
+          arg(match.path.mid(data_path.length() + 1)).arg(match.line);
+      change.entity_index = EntityIndex();
+      change.line = match.line;
+      change.old_value = match.value;
+      change.new_value = new_values.value(match.value);
+      change.safe = false;
+      changes << change;
+    }
+  }
+  return changes;
+}
+
+/**
+ * @brief Returns the paths of all Lua scripts of the quest.
+ * @return The scripts in the data directory.
+ */
+QStringList QuestRefactoring::get_script_paths() const {
+
+  QStringList paths;
+  QDirIterator it(quest.get_data_path(),
+                  QStringList() << "*.lua",
+                  QDir::Files,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    paths << it.next();
+  }
+  return paths;
+}
+
+/**
+ * @brief Applies changes to the files of the quest.
+ *
+ * New versions of all files are first written in parallel next to the
+ * original ones. Only if all of them succeed, original files are replaced.
+ * If anything fails, no file is modified.
+ *
+ * @param changes The changes to apply.
+ * @throws EditorException If a file is open or in case of error.
+ */
+void QuestRefactoring::apply(const QList<Change>& changes) {
+
+  if (changes.isEmpty()) {
+    return;
+  }
+
+  // Group changes by file.
+  QMap<QString, FileChanges> changes_by_file;
+  Q_FOREACH (const Change& change, changes) {
+    FileChanges& file_changes = changes_by_file[change.file_path];
+    file_changes.path = change.file_path;
+    file_changes.changes << change;
+  }
+
+  Q_FOREACH (const QString& path, changes_by_file.keys()) {
+    if (quest.is_path_open(path)) {
+      throw EditorException(
+            tr("File '%1' is open, please close it before updating references").
+            arg(path));
+    }
+  }
+
+  // Write new files in parallel.
+  const QList<FileChanges>& files = changes_by_file.values();
+  const QStringList& errors =
+      QtConcurrent::blockingMapped<QStringList>(files, rewrite_file_in_worker);
+
+  QString error;
+  Q_FOREACH (const QString& file_error, errors) {
+    if (!file_error.isEmpty()) {
+      error = file_error;
+      break;
+    }
+  }
+
+  if (!error.isEmpty()) {
+    Q_FOREACH (const FileChanges& file_changes, files) {
+      QFile::remove(file_changes.path + new_file_suffix);
+    }
+    throw EditorException(error);
+  }
+
+  // Replace the original files, keeping a backup until all of them are done.
+  QStringList replaced_paths;
+  Q_FOREACH (const FileChanges& file_changes, files) {
+    const QString& path = file_changes.path;
+    QFile::remove(path + old_file_suffix);
+    if (!QFile::rename(path, path + old_file_suffix)) {
+      error = tr("Cannot rename file '%1'").arg(path);
+      break;
+    }
+    if (!QFile::rename(path + new_file_suffix, path)) {
+      QFile::rename(path + old_file_suffix, path);
+      error = tr("Cannot rename file '%1'").arg(path + new_file_suffix);
+      break;
+    }
+    replaced_paths << path;
+  }
+
+  if (!error.isEmpty()) {
+    // Roll back.
+    Q_FOREACH (const QString& path, replaced_paths) {
+      QFile::remove(path);
+      QFile::rename(path + old_file_suffix, path);
+    }
+    Q_FOREACH (const FileChanges& file_changes, files) {
+      QFile::remove(file_changes.path + new_file_suffix);
+    }
+    throw EditorException(error);
+  }
+
+  Q_FOREACH (const QString& path, replaced_paths) {
+    QFile::remove(path + old_file_suffix);
+  }
+
+  quest.get_index().update_all();
+}
+
+/**
+ * @brief Returns the changes that undo other changes.
+ *
+ * Applying them after the original changes restores the files as they were.
+ *
+ * @param changes Changes already applied.
+ * @return The inverse changes.
+ */
+QList<Change> QuestRefactoring::get_inverse_changes(const QList<Change>& changes) {
+
+  QList<Change> inverse_changes;
+  Q_FOREACH (const Change& change, changes) {
+    Change inverse_change = change;
+    inverse_change.old_value = change.new_value;
+    inverse_change.new_value = change.old_value;
+    inverse_changes << inverse_change;
+  }
+  return inverse_changes;
+}
+
+/**
+ * @brief Records that an id was renamed in a list of pending renamings.
+ *
+ * The list gives the current id of each element renamed, indexed by its id
+ * in the saved file, so that successive renamings and their undo are
+ * combined into the net result.
+ * Elements that do not exist in the saved file are not recorded.
+ *
+ * @param new_ids The pending renamings to update.
+ * @param old_id The id before this renaming.
+ * @param new_id The id after this renaming.
+ */
+void QuestRefactoring::add_renaming(
+    QMap<QString, QString>& new_ids, const QString& old_id, const QString& new_id) {
+
+  QString saved_id = old_id;
+  bool found = false;
+  for (auto it = new_ids.constBegin(); it != new_ids.constEnd(); ++it) {
+    if (it.value() == old_id) {
+      saved_id = it.key();
+      found = true;
+      break;
+    }
+  }
+
+  if (!found && new_ids.contains(old_id)) {
+    // The saved element with this id was renamed earlier:
+    // this one was created since the last save.
+    return;
+  }
+
+  if (saved_id == new_id) {
+    new_ids.remove(saved_id);
+  }
+  else {
+    new_ids.insert(saved_id, new_id);
+  }
+}
+
+/**
+ * @brief Forgets a deleted element in a list of pending renamings.
+ * @param new_ids The pending renamings to update.
+ * @param id Current id of the element deleted.
+ */
+void QuestRefactoring::remove_renaming(QMap<QString, QString>& new_ids, const QString& id) {
+
+  for (auto it = new_ids.begin(); it != new_ids.end(); ++it) {
+    if (it.value() == id) {
+      new_ids.erase(it);
+      return;
+    }
+  }
+}
+
+}
@@ -0,0 +1,1109 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "dialogs_model.h"
+#include "quest.h"
+#include "quest_text_index.h"
+#include "strings_model.h"
+#include <solarus/DialogResources.h>
+#include <solarus/StringResources.h>
+#include <QtConcurrentMap>
+#include <algorithm>
+#include <iterator>
+
+namespace SolarusEditor {
+
+using Entry = QuestTextIndex::Entry;
+using EntryKind = QuestTextIndex::EntryKind;
+using LanguageTexts = QuestTextIndex::LanguageTexts;
+
+namespace {
+
+/**
+ * @brief Language files to be read in a worker thread.
+ */
+struct LanguageFiles {
+  QString language_id;
+  QString strings_path;
+  QString dialogs_path;
+};
+
+/**
+ * @brief Builds the key identifying a string or a dialog of a language.
+ *
+ * The text and the properties of a dialog have the same group key.
+ *
+ * @param language_id A language.
+ * @param kind Kind of entry.
+ * @param id String key or dialog id.
+ * @return The group key.
+ */
+QString make_group_key(
+    const QString& language_id, EntryKind kind, const QString& id) {
+
+  const QChar type = (kind == EntryKind::STRING) ? 's' : 'd';
+  return language_id + '\n' + type + '\n' + id;
+}
+
+/**
+ * @brief Builds the key identifying an entry of the index.
+ * @param language_id A language.
+ * @param kind Kind of entry.
+ * @param id String key or dialog id.
+ * @param property_key Name of the dialog property if any.
+ * @return A string unique for each entry.
+ */
+QString make_entry_key(
+    const QString& language_id,
+    EntryKind kind,
+    const QString& id,
+    const QString& property_key) {
+
+  return make_group_key(language_id, kind, id) + '\n' +
+      QString::number(static_cast<int>(kind)) + '\n' + property_key;
+}
+
+/**
+ * @brief Builds the key identifying an entry of the index.
+ * @param entry An entry.
+ * @return A string unique for each entry.
+ */
+QString make_entry_key(const Entry& entry) {
+
+  return make_entry_key(
+        entry.language_id, entry.kind, entry.id, entry.property_key);
+}
+
+/**
+ * @brief Creates an entry.
+ * @param language_id Language of the text.
+ * @param kind Where the text comes from.
+ * @param id String key or dialog id.
+ * @param property_key Name of the dialog property if any.
+ * @param text The text.
+ * @return The entry.
+ */
+Entry make_entry(
+    const QString& language_id,
+    EntryKind kind,
+    const QString& id,
+    const QString& property_key,
+    const QString& text) {
+
+  Entry entry;
+  entry.language_id = language_id;
+  entry.kind = kind;
+  entry.id = id;
+  entry.property_key = property_key;
+  entry.text = text;
+  return entry;
+}
+
+/**
+ * @brief Returns whether a list of words contains a phrase.
+ * @param words The words of a text.
+ * @param phrase The words to find consecutively.
+ * @return @c true if the phrase is in the text.
+ */
+bool contains_phrase(const QStringList& words, const QStringList& phrase) {
+
+  for (int i = 0; i + phrase.size() <= words.size(); ++i) {
+    int j = 0;
+    while (j < phrase.size() && words[i + j] == phrase[j]) {
+      ++j;
+    }
+    if (j == phrase.size()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Compares entries to sort search results.
+ * @param first An entry.
+ * @param second Another entry.
+ * @return @c true if the first one should be listed first.
+ */
+bool entry_less(const Entry& first, const Entry& second) {
+
+  if (first.language_id != second.language_id) {
+    return first.language_id < second.language_id;
+  }
+  if (first.kind != second.kind) {
+    return first.kind < second.kind;
+  }
+  if (first.id != second.id) {
+    return first.id < second.id;
+  }
+  return first.property_key < second.property_key;
+}
+
+/**
+ * @brief Reads the texts of a language in a worker thread.
+ * @param files The language to read.
+ * @return The texts of the language and their words.
+ */
+LanguageTexts read_language_in_worker(const LanguageFiles& files) {
+
+  return QuestTextIndex::read_language(
+        files.language_id, files.strings_path, files.dialogs_path);
+}
+
+}  // Anonymous namespace.
+
+/**
+ * @brief Creates the text index of a quest.
+ *
+ * The index is automatically built when the quest path changes.
+ *
+ * @param quest The quest to index.
+ */
+QuestTextIndex::QuestTextIndex(Quest& quest) :
+  quest(quest),
+  entries(),
+  free_slots(),
+  entry_slots(),
+  group_slots(),
+  postings(),
+  followed_strings(),
+  followed_dialogs(),
+  build_watcher(),
+  pending_languages() {
+
+  connect(&build_watcher, SIGNAL(resultReadyAt(int)),
+          this, SLOT(language_read(int)));
+  connect(&build_watcher, SIGNAL(finished()),
+          this, SLOT(build_finished_in_worker()));
+
+  connect(&quest, SIGNAL(root_path_changed(const QString&)),
+          this, SLOT(reload()));
+
+  QuestResources& resources = quest.get_resources();
+  connect(&resources, SIGNAL(element_added(ResourceType, QString, QString)),
+          this, SLOT(language_element_added(ResourceType, QString)));
+  connect(&resources, SIGNAL(element_removed(ResourceType, QString)),
+          this, SLOT(language_element_removed(ResourceType, QString)));
+  connect(&resources, SIGNAL(element_renamed(ResourceType, QString, QString)),
+          this, SLOT(language_element_renamed(ResourceType, QString, QString)));
+  reload();
+}
+
+/**
+ * @brief Destroys the index.
+ *
+ * Waits for worker threads.
+ */
+QuestTextIndex::~QuestTextIndex() {
+
+  cancel_build();
+}
+
+/**
+ * @brief Returns whether language files are currently being read in the
+ * background.
+ * @return @c true if the index is being built.
+ */
+bool QuestTextIndex::is_building() const {
+
+  return build_watcher.isRunning();
+}
+
+/**
+ * @brief Returns the number of texts in the index.
+ * @return The number of strings, dialog texts and dialog properties indexed.
+ */
+int QuestTextIndex::get_num_entries() const {
+
+  return entry_slots.size();
+}
+
+/**
+ * @brief Splits a text into lowercase words.
+ *
+ * Words are made of letters and digits. Everything else separates words.
+ *
+ * @param text A text.
+ * @return Its words, in order.
+ */
+QStringList QuestTextIndex::tokenize(const QString& text) {
+
+  QStringList words;
+  const int length = text.length();
+  int i = 0;
+  while (i < length) {
+    while (i < length && !text[i].isLetterOrNumber()) {
+      ++i;
+    }
+    const int start = i;
+    while (i < length && text[i].isLetterOrNumber()) {
+      ++i;
+    }
+    if (i > start) {
+      words << text.mid(start, i - start).toLower();
+    }
+  }
+  return words;
+}
+
+/**
+ * @brief Reads the strings and dialogs of a language and splits them
+ * into words.
+ *
+ * This function can be called from any thread.
+ * Files that cannot be parsed are ignored.
+ *
+ * @param language_id The language.
+ * @param strings_path Path of its strings file.
+ * @param dialogs_path Path of its dialogs file.
+ * @return The texts of the language.
+ */
+LanguageTexts QuestTextIndex::read_language(
+    const QString& language_id,
+    const QString& strings_path,
+    const QString& dialogs_path) {
+
+  LanguageTexts texts;
+  texts.language_id = language_id;
+
+  Solarus::StringResources strings;
+  if (strings.import_from_file(strings_path.toStdString())) {
+    for (const auto& kvp : strings.get_strings()) {
+      const Entry& entry = make_entry(
+            language_id,
+            EntryKind::STRING,
+            QString::fromStdString(kvp.first),
+            QString(),
+            QString::fromStdString(kvp.second));
+      texts.entries << entry;
+      texts.tokens << tokenize(entry.text);
+    }
+  }
+
+  Solarus::DialogResources dialogs;
+  if (dialogs.import_from_file(dialogs_path.toStdString())) {
+    for (const auto& kvp : dialogs.get_dialogs()) {
+      const QString& id = QString::fromStdString(kvp.first);
+      const Entry& entry = make_entry(
+            language_id,
+            EntryKind::DIALOG_TEXT,
+            id,
+            QString(),
+            QString::fromStdString(kvp.second.get_text()));
+      texts.entries << entry;
+      texts.tokens << tokenize(entry.text);
+
+      for (const auto& property : kvp.second.get_properties()) {
+        const Entry& property_entry = make_entry(
+              language_id,
+              EntryKind::DIALOG_PROPERTY,
+              id,
+              QString::fromStdString(property.first),
+              QString::fromStdString(property.second));
+        texts.entries << property_entry;
+        texts.tokens << tokenize(property_entry.text);
+      }
+    }
+  }
+
+  return texts;
+}
+
+/**
+ * @brief Finds the texts matching a query.
+ *
+ * The query is made of words and of phrases between double quotes.
+ * A text matches if, for each word of the query, it contains a word starting
+ * with it, and if it contains each phrase exactly.
+ * The case is ignored.
+ *
+ * @param query The query.
+ * @param language_id Language to search in, or an empty string to search in
+ * all languages.
+ * @return The matching texts, sorted by language and id.
+ */
+QList<Entry> QuestTextIndex::search(
+    const QString& query, const QString& language_id) const {
+
+  QStringList prefixes;
+  QList<QStringList> phrases;
+  const QStringList& parts = query.split('"');
+  for (int i = 0; i < parts.size(); ++i) {
+    const QStringList& words = tokenize(parts[i]);
+    if (words.isEmpty()) {
+      continue;
+    }
+    if (i % 2 == 1) {
+      phrases << words;
+    }
+    else {
+      prefixes << words;
+    }
+  }
+
+  // Get the texts containing each word, then keep the ones that
+  // contain all of them, starting with the rarest words.
+  QList<QVector<int>> slot_lists;
+  Q_FOREACH (const QString& prefix, prefixes) {
+    slot_lists << find_prefix(prefix);
+  }
+  Q_FOREACH (const QStringList& phrase, phrases) {
+    Q_FOREACH (const QString& word, phrase) {
+      slot_lists << find_word(word);
+    }
+  }
+  if (slot_lists.isEmpty()) {
+    return QList<Entry>();
+  }
+
+  std::sort(slot_lists.begin(), slot_lists.end(),
+            [](const QVector<int>& first, const QVector<int>& second) {
+    return first.size() < second.size();
+  });
+
+  QVector<int> found_slots = slot_lists.first();
+  for (int i = 1; i < slot_lists.size() && !found_slots.isEmpty(); ++i) {
+    const QVector<int>& other_slots = slot_lists[i];
+    QVector<int> intersection;
+    std::set_intersection(found_slots.begin(), found_slots.end(),
+                          other_slots.begin(), other_slots.end(),
+                          std::back_inserter(intersection));
+    found_slots = intersection;
+  }
+
+  // Check the language and the phrases.
+  QList<Entry> results;
+  for (int slot : found_slots) {
+    const Entry& entry = entries[slot];
+    if (!language_id.isEmpty() && entry.language_id != language_id) {
+      continue;
+    }
+
+    if (!phrases.isEmpty()) {
+      const QStringList& words = tokenize(entry.text);
+      bool match = true;
+      for (const QStringList& phrase : phrases) {
+        if (!contains_phrase(words, phrase)) {
+          match = false;
+          break;
+        }
+      }
+      if (!match) {
+        continue;
+      }
+    }
+    results << entry;
+  }
+
+  std::sort(results.begin(), results.end(), entry_less);
+  return results;
+}
+
+/**
+ * @brief Returns the sorted slots of texts containing a word that starts
+ * with a prefix.
+ * @param prefix A lowercase prefix.
+ * @return The slots found.
+ */
+QVector<int> QuestTextIndex::find_prefix(const QString& prefix) const {
+
+  QVector<int> found_slots;
+  int num_words = 0;
+  for (auto it = postings.lowerBound(prefix);
+       it != postings.end() && it.key().startsWith(prefix);
+       ++it) {
+    found_slots += it.value();
+    ++num_words;
+  }
+
+  if (num_words > 1) {
+    std::sort(found_slots.begin(), found_slots.end());
+    found_slots.erase(std::unique(found_slots.begin(), found_slots.end()),
+                      found_slots.end());
+  }
+  return found_slots;
+}
+
+/**
+ * @brief Returns the sorted slots of texts containing a word.
+ * @param word A lowercase word.
+ * @return The slots found.
+ */
+QVector<int> QuestTextIndex::find_word(const QString& word) const {
+
+  return postings.value(word);
+}
+
+/**
+ * @brief Starts following the changes of a strings model.
+ *
+ * Strings of the language are then indexed from the model instead of
+ * the file, until the model is destroyed.
+ *
+ * @param model The model of a language being edited.
+ */
+void QuestTextIndex::watch_strings_model(const StringsModel& model) {
+
+  const QString& language_id = model.get_language_id();
+  followed_strings.insert(&model, language_id);
+
+  Q_FOREACH (const QString& key, model.get_keys("")) {
+    index_string_from_model(model, key);
+  }
+  emit index_changed();
+
+  connect(&model, SIGNAL(destroyed(QObject*)),
+          this, SLOT(model_destroyed(QObject*)));
+  connect(&model, SIGNAL(string_created(QString)),
+          this, SLOT(string_created(QString)));
+  connect(&model, SIGNAL(string_deleted(QString)),
+          this, SLOT(string_deleted(QString)));
+  connect(&model, SIGNAL(string_key_changed(QString, QString)),
+          this, SLOT(string_key_changed(QString, QString)));
+  connect(&model, SIGNAL(string_value_changed(QString, QString)),
+          this, SLOT(string_value_changed(QString, QString)));
+}
+
+/**
+ * @brief Starts following the changes of a dialogs model.
+ *
+ * Dialogs of the language are then indexed from the model instead of
+ * the file, until the model is destroyed.
+ *
+ * @param model The model of a language being edited.
+ */
+void QuestTextIndex::watch_dialogs_model(const DialogsModel& model) {
+
+  const QString& language_id = model.get_language_id();
+  followed_dialogs.insert(&model, language_id);
+
+  Q_FOREACH (const QString& id, model.get_ids("")) {
+    index_dialog_from_model(model, id);
+  }
+  emit index_changed();
+
+  connect(&model, SIGNAL(destroyed(QObject*)),
+          this, SLOT(model_destroyed(QObject*)));
+  connect(&model, SIGNAL(dialog_created(QString)),
+          this, SLOT(dialog_created(QString)));
+  connect(&model, SIGNAL(dialog_deleted(QString)),
+          this, SLOT(dialog_deleted(QString)));
+  connect(&model, SIGNAL(dialog_id_changed(QString, QString)),
+          this, SLOT(dialog_id_changed(QString, QString)));
+  connect(&model, SIGNAL(dialog_text_changed(QString, QString)),
+          this, SLOT(dialog_text_changed(QString, QString)));
+  connect(&model, SIGNAL(dialog_property_created(QString, QString, QString)),
+          this, SLOT(dialog_property_created(QString, QString, QString)));
+  connect(&model, SIGNAL(dialog_property_deleted(QString, QString)),
+          this, SLOT(dialog_property_deleted(QString, QString)));
+  connect(&model, SIGNAL(dialog_property_changed(QString, QString, QString)),
+          this, SLOT(dialog_property_changed(QString, QString, QString)));
+}
+
+/**
+ * @brief Forgets everything and builds the index of the new quest.
+ *
+ * Called when the quest path changes.
+ */
+void QuestTextIndex::reload() {
+
+  cancel_build();
+  clear();
+  emit index_changed();
+
+  if (!quest.is_valid()) {
+    return;
+  }
+
+  rebuild();
+}
+
+/**
+ * @brief Reads again all language files in background threads.
+ *
+ * Languages being edited are not read from their files.
+ * index_changed() is emitted after each language and build_finished()
+ * at the end.
+ */
+void QuestTextIndex::rebuild() {
+
+  cancel_build();
+  pending_languages.clear();
+
+  if (!quest.is_valid()) {
+    return;
+  }
+
+  const QStringList& language_ids =
+      quest.get_resources().get_elements(ResourceType::LANGUAGE);
+  if (language_ids.isEmpty()) {
+    emit build_finished();
+    return;
+  }
+
+  read_languages(language_ids);
+}
+
+/**
+ * @brief Starts reading the files of some languages in background threads.
+ *
+ * Must not be called while a build is running.
+ *
+ * @param language_ids The languages to read.
+ */
+void QuestTextIndex::read_languages(const QStringList& language_ids) {
+
+  QList<LanguageFiles> languages;
+  Q_FOREACH (const QString& language_id, language_ids) {
+    languages << LanguageFiles{
+      language_id,
+      quest.get_strings_path(language_id),
+      quest.get_dialogs_path(language_id)
+    };
+  }
+
+  build_watcher.setFuture(QtConcurrent::mapped(languages, read_language_in_worker));
+}
+
+/**
+ * @brief Stops reading language files in the background.
+ *
+ * Blocks until worker threads have finished their current language.
+ */
+void QuestTextIndex::cancel_build() {
+
+  if (build_watcher.isRunning()) {
+    build_watcher.cancel();
+    build_watcher.waitForFinished();
+  }
+}
+
+/**
+ * @brief Removes all texts from the index.
+ */
+void QuestTextIndex::clear() {
+
+  pending_languages.clear();
+  entries.clear();
+  free_slots.clear();
+  entry_slots.clear();
+  group_slots.clear();
+  postings.clear();
+}
+
+/**
+ * @brief Slot called when a worker thread has read a language.
+ * @param result_index Index of the result in the future.
+ */
+void QuestTextIndex::language_read(int result_index) {
+
+  if (build_watcher.isCanceled()) {
+    return;
+  }
+
+  const LanguageTexts& texts = build_watcher.resultAt(result_index);
+  if (!quest.get_resources().exists(ResourceType::LANGUAGE, texts.language_id)) {
+    // Removed or renamed while its files were being read.
+    return;
+  }
+
+  set_language_texts(texts);
+  emit index_changed();
+}
+
+/**
+ * @brief Slot called when all language files were read.
+ *
+ * Languages to reload that were requested in the meantime are then read.
+ */
+void QuestTextIndex::build_finished_in_worker() {
+
+  if (build_watcher.isCanceled()) {
+    return;
+  }
+
+  if (!pending_languages.isEmpty()) {
+    const QStringList language_ids = pending_languages;
+    pending_languages.clear();
+    read_languages(language_ids);
+    return;
+  }
+
+  emit build_finished();
+}
+
+/**
+ * @brief Reads again the files of a language in a background thread.
+ *
+ * If other languages are already being read, the language is read after
+ * them.
+ *
+ * @param language_id The language to update.
+ */
+void QuestTextIndex::reload_language(const QString& language_id) {
+
+  if (build_watcher.isRunning()) {
+    if (!pending_languages.contains(language_id)) {
+      pending_languages << language_id;
+    }
+    return;
+  }
+
+  read_languages(QStringList() << language_id);
+}
+
+/**
+ * @brief Replaces the texts of a language read from its files.
+ *
+ * Strings or dialogs currently followed through a model are kept.
+ *
+ * @param texts The new texts of the language.
+ */
+void QuestTextIndex::set_language_texts(const LanguageTexts& texts) {
+
+  remove_language(texts.language_id);
+  for (int i = 0; i < texts.entries.size(); ++i) {
+    const Entry& entry = texts.entries[i];
+    if (!is_followed(entry.language_id, entry.kind)) {
+      set_entry(entry, texts.tokens[i]);
+    }
+  }
+}
+
+/**
+ * @brief Removes the texts of a language that are not followed through
+ * a model.
+ * @param language_id The language to remove.
+ */
+void QuestTextIndex::remove_language(const QString& language_id) {
+
+  QStringList entry_keys;
+  for (const Entry& entry : entries) {
+    if (entry.language_id == language_id &&
+        !is_followed(entry.language_id, entry.kind)) {
+      entry_keys << make_entry_key(entry);
+    }
+  }
+
+  Q_FOREACH (const QString& entry_key, entry_keys) {
+    remove_entry(entry_key);
+  }
+}
+
+/**
+ * @brief Returns whether strings or dialogs of a language are currently
+ * followed through a model.
+ * @param language_id A language.
+ * @param kind Kind of texts.
+ * @return @c true if the texts are indexed from a model.
+ */
+bool QuestTextIndex::is_followed(const QString& language_id, EntryKind kind) const {
+
+  if (kind == EntryKind::STRING) {
+    return followed_strings.key(language_id, nullptr) != nullptr;
+  }
+  return followed_dialogs.key(language_id, nullptr) != nullptr;
+}
+
+/**
+ * @brief Adds or replaces a text in the index.
+ * @param entry The text.
+ * @param tokens Its words, as returned by tokenize().
+ */
+void QuestTextIndex::set_entry(const Entry& entry, const QStringList& tokens) {
+
+  const QString& entry_key = make_entry_key(entry);
+  remove_entry(entry_key);
+
+  int slot = 0;
+  if (!free_slots.isEmpty()) {
+    slot = free_slots.takeLast();
+    entries[slot] = entry;
+  }
+  else {
+    slot = entries.size();
+    entries << entry;
+  }
+  entry_slots.insert(entry_key, slot);
+  group_slots[make_group_key(entry.language_id, entry.kind, entry.id)] << slot;
+
+  QStringList words = tokens;
+  words.removeDuplicates();
+  Q_FOREACH (const QString& word, words) {
+    QVector<int>& word_slots = postings[word];
+    auto it = std::lower_bound(word_slots.begin(), word_slots.end(), slot);
+    if (it == word_slots.end() || *it != slot) {
+      word_slots.insert(it, slot);
+    }
+  }
+}
+
+/**
+ * @brief Adds or replaces a text in the index.
+ * @param entry The text.
+ */
+void QuestTextIndex::set_entry(const Entry& entry) {
+
+  set_entry(entry, tokenize(entry.text));
+}
+
+/**
+ * @brief Removes a text from the index if it exists.
+ * @param entry_key Key of the text, as returned by make_entry_key().
+ */
+void QuestTextIndex::remove_entry(const QString& entry_key) {
+
+  auto slot_it = entry_slots.find(entry_key);
+  if (slot_it == entry_slots.end()) {
+    return;
+  }
+  const int slot = *slot_it;
+  entry_slots.erase(slot_it);
+
+  const Entry& entry = entries[slot];
+  QStringList words = tokenize(entry.text);
+  words.removeDuplicates();
+  Q_FOREACH (const QString& word, words) {
+    auto postings_it = postings.find(word);
+    if (postings_it == postings.end()) {
+      continue;
+    }
+    QVector<int>& word_slots = *postings_it;
+    auto it = std::lower_bound(word_slots.begin(), word_slots.end(), slot);
+    if (it != word_slots.end() && *it == slot) {
+      word_slots.erase(it);
+    }
+    if (word_slots.isEmpty()) {
+      postings.erase(postings_it);
+    }
+  }
+
+  const QString& group_key = make_group_key(entry.language_id, entry.kind, entry.id);
+  auto group_it = group_slots.find(group_key);
+  if (group_it != group_slots.end()) {
+    group_it->removeOne(slot);
+    if (group_it->isEmpty()) {
+      group_slots.erase(group_it);
+    }
+  }
+
+  entries[slot] = Entry();
+  free_slots << slot;
+}
+
+/**
+ * @brief Removes all texts of a string or dialog from the index.
+ * @param group_key Key of the string or dialog, as returned by
+ * make_group_key().
+ */
+void QuestTextIndex::remove_group(const QString& group_key) {
+
+  const QVector<int> found_slots = group_slots.value(group_key);
+  for (int slot : found_slots) {
+    remove_entry(make_entry_key(entries[slot]));
+  }
+}
+
+/**
+ * @brief Indexes the current value of a string of a model.
+ * @param model A strings model.
+ * @param key Key of the string.
+ */
+void QuestTextIndex::index_string_from_model(
+    const StringsModel& model, const QString& key) {
+
+  set_entry(make_entry(
+              model.get_language_id(),
+              EntryKind::STRING,
+              key,
+              QString(),
+              model.get_string(key)));
+}
+
+/**
+ * @brief Indexes the current text and properties of a dialog of a model.
+ * @param model A dialogs model.
+ * @param id Id of the dialog.
+ */
+void QuestTextIndex::index_dialog_from_model(
+    const DialogsModel& model, const QString& id) {
+
+  const QString& language_id = model.get_language_id();
+  remove_group(make_group_key(language_id, EntryKind::DIALOG_TEXT, id));
+
+  if (!model.dialog_exists(id)) {
+    return;
+  }
+
+  set_entry(make_entry(
+              language_id,
+              EntryKind::DIALOG_TEXT,
+              id,
+              QString(),
+              model.get_dialog_text(id)));
+
+  const QMap<QString, QString>& properties = model.get_dialog_properties(id);
+  for (auto it = properties.begin(); it != properties.end(); ++it) {
+    set_entry(make_entry(
+                language_id,
+                EntryKind::DIALOG_PROPERTY,
+                id,
+                it.key(),
+                it.value()));
+  }
+}
+
+/**
+ * @brief Slot called when a resource element is added to the quest.
+ * @param type Type of resource.
+ * @param id Id of the new element.
+ */
+void QuestTextIndex::language_element_added(ResourceType type, const QString& id) {
+
+  if (type != ResourceType::LANGUAGE) {
+    return;
+  }
+
+  reload_language(id);
+}
+
+/**
+ * @brief Slot called when a resource element is removed from the quest.
+ * @param type Type of resource.
+ * @param id Id of the removed element.
+ */
+void QuestTextIndex::language_element_removed(ResourceType type, const QString& id) {
+
+  if (type != ResourceType::LANGUAGE) {
+    return;
+  }
+
+  remove_language(id);
+  emit index_changed();
+}
+
+/**
+ * @brief Slot called when a resource element is renamed.
+ * @param type Type of resource.
+ * @param old_id Old id of the element.
+ * @param new_id New id of the element.
+ */
+void QuestTextIndex::language_element_renamed(
+    ResourceType type, const QString& old_id, const QString& new_id) {
+
+  if (type != ResourceType::LANGUAGE) {
+    return;
+  }
+
+  remove_language(old_id);
+  emit index_changed();
+  reload_language(new_id);
+}
+
+/**
+ * @brief Slot called when a followed model is destroyed.
+ *
+ * The language is indexed again from its files, so that unsaved changes
+ * are forgotten.
+ *
+ * @param model The model destroyed.
+ */
+void QuestTextIndex::model_destroyed(QObject* model) {
+
+  QString language_id = followed_strings.take(model);
+  if (language_id.isEmpty()) {
+    language_id = followed_dialogs.take(model);
+  }
+  if (language_id.isEmpty() || !quest.is_valid()) {
+    return;
+  }
+
+  reload_language(language_id);
+}
+
+/**
+ * @brief Slot called when a string is created in a followed model.
+ * @param key Key of the new string.
+ */
+void QuestTextIndex::string_created(const QString& key) {
+
+  const StringsModel* model = qobject_cast<const StringsModel*>(sender());
+  if (model == nullptr) {
+    return;
+  }
+
+  index_string_from_model(*model, key);
+  emit index_changed();
+}
+
+/**
+ * @brief Slot called when a string is deleted in a followed model.
+ * @param key Key of the deleted string.
+ */
+void QuestTextIndex::string_deleted(const QString& key) {
+
+  const QString& language_id = followed_strings.value(sender());
+  if (language_id.isEmpty()) {
+    return;
+  }
+
+  remove_group(make_group_key(language_id, EntryKind::STRING, key));
+  emit index_changed();
+}
+
+/**
+ * @brief Slot called when a string key is changed in a followed model.
+ * @param key Old key of the string.
+ * @param new_key New key of the string.
+ */
+void QuestTextIndex::string_key_changed(const QString& key, const QString& new_key) {
+
+  const StringsModel* model = qobject_cast<const StringsModel*>(sender());
+  if (model == nullptr) {
+    return;
+  }
+
+  remove_group(make_group_key(model->get_language_id(), EntryKind::STRING, key));
+  index_string_from_model(*model, new_key);
+  emit index_changed();
+}
+
+/**
+ * @brief Slot called when a string value is changed in a followed model.
+ * @param key Key of the string.
+ * @param value New value of the string.
+ */
+void QuestTextIndex::string_value_changed(const QString& key, const QString& value) {
+
+  const QString& language_id = followed_strings.value(sender());
+  if (language_id.isEmpty()) {
+    return;
+  }
+
+  set_entry(make_entry(language_id, EntryKind::STRING, key, QString(), value));
+  emit index_changed();
+}
+
+/**
+ * @brief Slot called when a dialog is created in a followed model.
+ * @param id Id of the new dialog.
+ */
+void QuestTextIndex::dialog_created(const QString& id) {
+
+  const DialogsModel* model = qobject_cast<const DialogsModel*>(sender());
+  if (model == nullptr) {
+    return;
+  }
+
+  index_dialog_from_model(*model, id);
+  emit index_changed();
+}
+
+/**
+ * @brief Slot called when a dialog is deleted in a followed model.
+ * @param id Id of the deleted dialog.
+ */
+void QuestTextIndex::dialog_deleted(const QString& id) {
+
+  const QString& language_id = followed_dialogs.value(sender());
+  if (language_id.isEmpty()) {
+    return;
+  }
+
+  remove_group(make_group_key(language_id, EntryKind::DIALOG_TEXT, id));
+  emit index_changed();
+}
+
+/**
+ * @brief Slot called when a dialog id is changed in a followed model.
+ * @param id Old id of the dialog.
+ * @param new_id New id of the dialog.
+ */
+void QuestTextIndex::dialog_id_changed(const QString& id, const QString& new_id) {
+
+  const DialogsModel* model = qobject_cast<const DialogsModel*>(sender());
+  if (model == nullptr) {
+    return;
+  }
+
+  remove_group(make_group_key(model->get_language_id(), EntryKind::DIALOG_TEXT, id));
+  index_dialog_from_model(*model, new_id);
+  emit index_changed();
+}
+
+/**
+ * @brief Slot called when a dialog text is changed in a followed model.
+ * @param id Id of the dialog.
+ * @param text New text of the dialog.
+ */
+void QuestTextIndex::dialog_text_changed(const QString& id, const QString& text) {
+
+  const QString& language_id = followed_dialogs.value(sender());
+  if (language_id.isEmpty()) {
+    return;
+  }
+
+  set_entry(make_entry(language_id, EntryKind::DIALOG_TEXT, id, QString(), text));
+  emit index_changed();
+}
+
+/**
+ * @brief Slot called when a dialog property is created in a followed model.
+ * @param id Id of the dialog.
+ * @param key Name of the new property.
+ * @param value Value of the new property.
+ */
+void QuestTextIndex::dialog_property_created(
+    const QString& id, const QString& key, const QString& value) {
+
+  dialog_property_changed(id, key, value);
+}
+
+/**
+ * @brief Slot called when a dialog property is deleted in a followed model.
+ * @param id Id of the dialog.
+ * @param key Name of the deleted property.
+ */
+void QuestTextIndex::dialog_property_deleted(const QString& id, const QString& key) {
+
+  const QString& language_id = followed_dialogs.value(sender());
+  if (language_id.isEmpty()) {
+    return;
+  }
+
+  remove_entry(make_entry_key(language_id, EntryKind::DIALOG_PROPERTY, id, key));
+  emit index_changed();
+}
+
+/**
+ * @brief Slot called when a dialog property is changed in a followed model.
+ * @param id Id of the dialog.
+ * @param key Name of the property.
+ * @param value New value of the property.
+ */
+void QuestTextIndex::dialog_property_changed(
+    const QString& id, const QString& key, const QString& value) {
+
+  const QString& language_id = followed_dialogs.value(sender());
+  if (language_id.isEmpty()) {
+    return;
+  }
+
+  set_entry(make_entry(language_id, EntryKind::DIALOG_PROPERTY, id, key, value));
+  emit index_changed();
+}
+
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "skyline_packer.h"
+#include <limits>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Creates an empty packer.
+ * @param width Width of the bin.
+ */
+SkylinePacker::SkylinePacker(int width) :
+  width(width),
+  height(0),
+  skyline() {
+
+  skyline.push_back({ 0, 0, width });
+}
+
+/**
+ * @brief Returns the width of the bin.
+ * @return The width.
+ */
+int SkylinePacker::get_width() const {
+  return width;
+}
+
+/**
+ * @brief Returns the height needed to contain all rectangles placed so far.
+ * @return The height used.
+ */
+int SkylinePacker::get_height() const {
+  return height;
+}
+
+/**
+ * @brief Places a rectangle in the bin.
+ * @param size Size of the rectangle.
+ * @return Top-left position of the rectangle,
+ * or (-1, -1) if it is wider than the bin.
+ */
+QPoint SkylinePacker::insert(const QSize& size) {
+
+  int best_index = -1;
+  int best_bottom = std::numeric_limits<int>::max();
+  int best_segment_width = std::numeric_limits<int>::max();
+  int best_y = 0;
+
+  for (size_t i = 0; i < skyline.size(); ++i) {
+    const int y = get_fit_y(i, size.width());
+    if (y == -1) {
+      continue;
+    }
+
+    // Prefer the lowest bottom edge, then the narrowest segment
+    // to leave wide spaces for next rectangles.
+    const int bottom = y + size.height();
+    if (bottom < best_bottom ||
+        (bottom == best_bottom && skyline[i].width < best_segment_width)) {
+      best_index = i;
+      best_bottom = bottom;
+      best_segment_width = skyline[i].width;
+      best_y = y;
+    }
+  }
+
+  if (best_index == -1) {
+    return QPoint(-1, -1);
+  }
+
+  const QPoint position(skyline[best_index].x, best_y);
+  add_segment(best_index, position, size);
+  height = qMax(height, best_bottom);
+  return position;
+}
+
+/**
+ * @brief Returns the y coordinate where a rectangle can be placed
+ * if its left edge is at the start of a segment.
+ * @param segment_index Index of a segment in the skyline.
+ * @param width Width of the rectangle.
+ * @return The lowest y coordinate free above all segments covered,
+ * or -1 if the rectangle does not fit in the bin.
+ */
+int SkylinePacker::get_fit_y(int segment_index, int width) const {
+
+  const int x = skyline[segment_index].x;
+  if (x + width > this->width) {
+    return -1;
+  }
+
+  int y = 0;
+  int width_left = width;
+  for (size_t i = segment_index; width_left > 0 && i < skyline.size(); ++i) {
+    y = qMax(y, skyline[i].y);
+    width_left -= skyline[i].width;
+  }
+  return y;
+}
+
+/**
+ * @brief Updates the skyline after a rectangle was placed.
+ * @param segment_index Index of the segment where the rectangle starts.
+ * @param position Position of the rectangle.
+ * @param size Size of the rectangle.
+ */
+void SkylinePacker::add_segment(
+    int segment_index, const QPoint& position, const QSize& size) {
+
+  const Segment new_segment = {
+    position.x(), position.y() + size.height(), size.width()
+  };
+  skyline.insert(skyline.begin() + segment_index, new_segment);
+
+  // Shrink or remove the segments now covered by the new one.
+  const int right = new_segment.x + new_segment.width;
+  size_t i = segment_index + 1;
+  while (i < skyline.size() && skyline[i].x < right) {
+    Segment& segment = skyline[i];
+    const int overlap = right - segment.x;
+    if (overlap < segment.width) {
+      segment.x += overlap;
+      segment.width -= overlap;
+      break;
+    }
+    skyline.erase(skyline.begin() + i);
+  }
+
+  // Merge neighbor segments at the same height.
+  for (size_t j = 0; j + 1 < skyline.size(); ) {
+    if (skyline[j].y == skyline[j + 1].y) {
+      skyline[j].width += skyline[j + 1].width;
+      skyline.erase(skyline.begin() + j + 1);
+    }
+    else {
+      ++j;
+    }
+  }
+}
+
+}
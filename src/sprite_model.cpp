@@ -1329,87 +1329,116 @@ QImage SpriteModel::get_animation_image(const Index& index) const {
 
   if (animation.image.isNull()) {
     // Lazily load image.
-    if (is_animation_image_is_tileset(index)) {
-      animation.image = QImage(quest.get_tileset_entities_image_path(tileset_id));
-    } else {
-      QString src_image = get_animation_source_image(index);
-      animation.image = QImage(quest.get_sprite_image_path(src_image));
-    }
+    animation.image = quest.get_image_cache().get_image(get_animation_image_path(index));
   }
 
   return animation.image;
 }
 
 /**
- * @brief Returns alls images representing frames of a specified direction.
- * @param index A direction index.
- * @return The corresponding images.
- * Returns an empty list if the animation image is not loaded.
+ * @brief Returns the path of the image file of an animation.
+ * @param index An animation or direction index.
+ * @return The sprite image or the entities image of the tileset.
  */
-QList<QPixmap> SpriteModel::get_direction_all_frames(const Index& index) const {
+QString SpriteModel::get_animation_image_path(const Index& index) const {
 
-  if (!direction_exists(index)) {
-    // No such direction.
-    return QList<QPixmap>();
+  if (is_animation_image_is_tileset(index)) {
+    return quest.get_tileset_entities_image_path(tileset_id);
+  }
+  return quest.get_sprite_image_path(get_animation_source_image(index));
+}
+
+/**
+ * @brief Returns the image of an animation as a pixmap ready to be drawn.
+ *
+ * The pixmap is shared by all frames of the animation.
+ *
+ * @param index An animation or direction index.
+ * @return The corresponding pixmap.
+ * Returns a null pixmap if the animation image is not loaded.
+ */
+QPixmap SpriteModel::get_animation_pixmap(const Index& index) const {
+
+  if (!animation_exists(index)) {
+    // No such animation.
+    return QPixmap();
   }
 
   const AnimationModel& animation = animations[get_animation_nb(index)];
-  const DirectionModel& direction = animation.directions[index.direction_nb];
 
-  if (direction.frames.size() > 0) {
-    // Frames already created.
-    return direction.frames;
+  if (animation.pixmap.isNull()) {
+    // Lazily get the pixmap, shared with other sprites using the same image.
+    animation.pixmap = quest.get_image_cache().get_pixmap(get_animation_image_path(index));
   }
 
-  QImage image = get_animation_image(index);
-  if (image.isNull()) {
-    // No image.
-    return QList<QPixmap>();
+  return animation.pixmap;
+}
+
+/**
+ * @brief Returns all frames of a specified direction.
+ *
+ * Frames share the pixmap of the animation: no pixel is copied.
+ *
+ * @param index A direction index.
+ * @return The corresponding frames.
+ * Returns an empty list if the animation image is not loaded.
+ */
+QList<SpriteModel::Frame> SpriteModel::get_direction_all_frames(const Index& index) const {
+
+  QList<Frame> frames;
+  if (!direction_exists(index)) {
+    // No such direction.
+    return frames;
   }
 
-  // Lazily create frames.
-  std::string name = index.animation_name.toStdString();
-  const auto& data = sprite.get_animation(name).get_direction(index.direction_nb);
+  const QPixmap& pixmap = get_animation_pixmap(index);
+  if (pixmap.isNull()) {
+    // No image.
+    return frames;
+  }
 
-  for (const Solarus::Rectangle& rect: data.get_all_frames()) {
-    QRect r(rect.get_x(), rect.get_y(), rect.get_width(), rect.get_height());
-    direction.frames.append(QPixmap::fromImage(image.copy(r)));
+  Q_FOREACH (const QRect& rect, get_direction_frames(index)) {
+    frames.append({ pixmap, rect });
   }
-  return direction.frames;
+  return frames;
 }
 
 /**
- * @brief Returns an image representing the first frame of a specified direction.
+ * @brief Returns the first frame of a specified direction.
  * @param index A direction index.
- * @return The corresponding image.
- * Returns a null pixmap if the animation image is not loaded.
+ * @return The corresponding frame.
+ * Returns a null frame if the animation image is not loaded.
  */
-QPixmap SpriteModel::get_direction_first_frame(const Index& index) const {
+SpriteModel::Frame SpriteModel::get_direction_first_frame(const Index& index) const {
 
   return get_direction_frame(index, 0);
 }
 
 /**
- * @brief Returns an image representing a frame of a specified direction.
+ * @brief Returns a frame of a specified direction.
  * @param index A direction index.
  * @param frame The frame number.
- * @return The corresponding image.
- * Returns a null pixmap if the animation image is not loaded
+ * @return The corresponding frame.
+ * Returns a null frame if the animation image is not loaded
  * or if the frame number is out of range.
  */
-QPixmap SpriteModel::get_direction_frame(const Index& index, int frame) const {
+SpriteModel::Frame SpriteModel::get_direction_frame(const Index& index, int frame) const {
 
-  QList<QPixmap> frames = get_direction_all_frames(index);
+  if (!direction_exists(index)) {
+    return Frame();
+  }
 
-  if (frames.empty()) {
-    return QPixmap();
+  const auto& frames = get_direction(index).get_all_frames();
+  if (frame < 0 || frame >= static_cast<int>(frames.size())) {
+    return Frame();
   }
 
-  if (frame < 0 || frame >= frames.size()) {
-    return QPixmap();
+  const QPixmap& pixmap = get_animation_pixmap(index);
+  if (pixmap.isNull()) {
+    return Frame();
   }
 
-  return frames[frame];
+  return { pixmap, Rectangle::to_qrect(frames[frame]) };
 }
 
 /**
@@ -1420,9 +1449,9 @@ QPixmap SpriteModel::get_direction_frame(const Index& index, int frame) const {
  */
 QPixmap SpriteModel::get_direction_icon(const Index& index) const {
 
-  QPixmap pixmap = get_direction_first_frame(index);
+  const Frame& frame = get_direction_first_frame(index);
 
-  if (pixmap.isNull()) {
+  if (frame.is_null()) {
     // No image available.
     return QPixmap();
   }
@@ -1437,9 +1466,23 @@ QPixmap SpriteModel::get_direction_icon(const Index& index) const {
   }
 
   // Lazily create the icon.
-  QImage image = pixmap.toImage();
+  QImage image = create_icon_image(get_animation_image(index).copy(frame.rect));
+  direction.icon = QPixmap::fromImage(image);
+  return direction.icon;
+}
+
+/**
+ * @brief Builds a 32x32 icon from the image of a frame.
+ *
+ * This function can be called from worker threads.
+ *
+ * @param frame_image Full-size image of a frame.
+ * @return The icon.
+ */
+QImage SpriteModel::create_icon_image(const QImage& frame_image) {
+
   // Make sure we have an alpha channel.
-  image = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+  QImage image = frame_image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
 
   if (image.height() <= 16) {
     image = image.scaledToHeight(image.height() * 2);
@@ -1448,13 +1491,10 @@ QPixmap SpriteModel::get_direction_icon(const Index& index) const {
     image = image.scaledToHeight(32);
   }
 
-  // Center the pattern in a 32x32 pixmap.
+  // Center the frame in a 32x32 image.
   int dx = (32 - image.width()) / 2;
   int dy = (32 - image.height()) / 2;
-  image = image.copy(-dx, -dy, 32, 32);
-
-  direction.icon = QPixmap::fromImage(image);
-  return direction.icon;
+  return image.copy(-dx, -dy, 32, 32);
 }
 
 /**
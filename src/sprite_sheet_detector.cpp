@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "sprite_sheet_detector.h"
+#include <QPair>
+#include <algorithm>
+#include <vector>
+
+namespace SolarusEditor {
+
+namespace {
+
+/**
+ * @brief First and last coordinates of a segment along one axis.
+ */
+using Interval = QPair<int, int>;
+
+/**
+ * @brief Returns the root of a label in a union-find forest.
+ *
+ * Paths are halved on the way to keep the trees flat.
+ *
+ * @param parents Parent of each label.
+ * @param label A label.
+ * @return The root label of its set.
+ */
+int find_root(std::vector<int>& parents, int label) {
+
+  while (parents[label] != label) {
+    parents[label] = parents[parents[label]];
+    label = parents[label];
+  }
+  return label;
+}
+
+/**
+ * @brief Merges the sets of two labels in a union-find forest.
+ * @param parents Parent of each label.
+ * @param label A label, or 0 for the background.
+ * @param other_label Another label, or 0 for the background.
+ * @return The root of the merged set, or 0 if both labels are background.
+ */
+int unite(std::vector<int>& parents, int label, int other_label) {
+
+  if (other_label == 0) {
+    return label;
+  }
+  if (label == 0) {
+    return other_label;
+  }
+
+  const int root = find_root(parents, label);
+  const int other_root = find_root(parents, other_label);
+  if (root < other_root) {
+    parents[other_root] = root;
+    return root;
+  }
+  parents[root] = other_root;
+  return other_root;
+}
+
+/**
+ * @brief Merges rectangles that intersect each other until none does.
+ * @param rects The rectangles to merge.
+ */
+void merge_overlapping_rects(QList<QRect>& rects) {
+
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (int i = 0; i < rects.size(); ++i) {
+      int j = i + 1;
+      while (j < rects.size()) {
+        if (rects[i].intersects(rects[j])) {
+          rects[i] |= rects[j];
+          rects.removeAt(j);
+          merged = true;
+        }
+        else {
+          ++j;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Merges overlapping intervals.
+ * @param intervals The intervals to merge.
+ * @return The merged intervals, sorted.
+ */
+QList<Interval> get_bands(QList<Interval> intervals) {
+
+  std::sort(intervals.begin(), intervals.end());
+
+  QList<Interval> bands;
+  Q_FOREACH (const Interval& interval, intervals) {
+    if (!bands.isEmpty() && interval.first <= bands.last().second) {
+      bands.last().second = qMax(bands.last().second, interval.second);
+    }
+    else {
+      bands << interval;
+    }
+  }
+  return bands;
+}
+
+/**
+ * @brief Infers the cells of a grid along one axis.
+ * @param bands Columns or rows of sprites found, sorted.
+ * @param area_start First coordinate of the area searched.
+ * @param area_length Length of the area searched.
+ * @param max_sprite_length Length of the biggest sprite.
+ * @param[out] start First coordinate of the grid.
+ * @return The length of a cell.
+ */
+int get_cell_length(
+    const QList<Interval>& bands,
+    int area_start,
+    int area_length,
+    int max_sprite_length,
+    int& start) {
+
+  const int num_cells = bands.size();
+
+  // If the area divides evenly into cells big enough for all sprites,
+  // it is probably the exact grid.
+  if (area_length % num_cells == 0 &&
+      area_length / num_cells >= max_sprite_length) {
+    start = area_start;
+    return area_length / num_cells;
+  }
+
+  // Otherwise, use the average distance between sprites.
+  const int first_center = (bands.first().first + bands.first().second) / 2;
+  int cell_length = max_sprite_length;
+  if (num_cells > 1) {
+    const int last_center = (bands.last().first + bands.last().second) / 2;
+    cell_length = qMax(cell_length, qRound(
+        (last_center - first_center) / static_cast<double>(num_cells - 1)));
+  }
+
+  // Center sprites in their cells when possible.
+  start = first_center - cell_length / 2;
+  start = qMin(start, area_start + area_length - num_cells * cell_length);
+  start = qBound(area_start, start, bands.first().first);
+  return cell_length;
+}
+
+}
+
+/**
+ * @brief Returns whether frames were detected.
+ * @return @c true if the grid has at least one frame.
+ */
+bool SpriteSheetDetector::Grid::is_valid() const {
+  return num_frames > 0 && !first_frame.isEmpty();
+}
+
+/**
+ * @brief Creates a detector for an image.
+ * @param image The sprite sheet.
+ */
+SpriteSheetDetector::SpriteSheetDetector(const QImage& image) :
+  image(image.convertToFormat(QImage::Format_ARGB32)),
+  has_alpha(image.hasAlphaChannel()) {
+
+}
+
+/**
+ * @brief Finds the bounding boxes of sprites in an area of the image.
+ * @param area The area to search, in image coordinates.
+ * @return The bounding box of each sprite found, in image coordinates.
+ */
+QList<QRect> SpriteSheetDetector::find_sprites(const QRect& area) const {
+
+  const QRect bounds = area.intersected(image.rect());
+  if (bounds.isEmpty()) {
+    return QList<QRect>();
+  }
+
+  const int width = bounds.width();
+  const int height = bounds.height();
+  const QRgb transparent_color = image.pixel(bounds.topLeft());
+  auto is_opaque = [this, transparent_color](QRgb pixel) {
+    return has_alpha ? qAlpha(pixel) != 0 : pixel != transparent_color;
+  };
+
+  // First pass: give a provisional label to each opaque pixel and record
+  // which labels touch each other, including diagonally.
+  std::vector<int> labels(width * height, 0);
+  std::vector<int> parents(1, 0);  // Label 0 is the background.
+  for (int j = 0; j < height; ++j) {
+
+    const QRgb* line = reinterpret_cast<const QRgb*>(
+          image.constScanLine(bounds.y() + j)) + bounds.x();
+    int* line_labels = &labels[j * width];
+    const int* previous_line_labels = j > 0 ? line_labels - width : nullptr;
+
+    for (int i = 0; i < width; ++i) {
+
+      if (!is_opaque(line[i])) {
+        continue;
+      }
+
+      // Neighbors already visited: west, north-west, north and north-east.
+      int label = 0;
+      if (i > 0) {
+        label = unite(parents, label, line_labels[i - 1]);
+      }
+      if (previous_line_labels != nullptr) {
+        for (int k = qMax(0, i - 1); k <= qMin(width - 1, i + 1); ++k) {
+          label = unite(parents, label, previous_line_labels[k]);
+        }
+      }
+
+      if (label == 0) {
+        label = parents.size();
+        parents.push_back(label);
+      }
+      line_labels[i] = label;
+    }
+  }
+
+  // Second pass: compute the bounding box of each set of labels.
+  std::vector<int> sprite_indexes(parents.size(), -1);
+  QList<QRect> sprites;
+  for (int j = 0; j < height; ++j) {
+
+    const int* line_labels = &labels[j * width];
+    const int y = bounds.y() + j;
+
+    for (int i = 0; i < width; ++i) {
+
+      if (line_labels[i] == 0) {
+        continue;
+      }
+
+      const int x = bounds.x() + i;
+      int& sprite_index = sprite_indexes[find_root(parents, line_labels[i])];
+      if (sprite_index == -1) {
+        sprite_index = sprites.size();
+        sprites << QRect(x, y, 1, 1);
+      }
+      else {
+        QRect& sprite = sprites[sprite_index];
+        sprite.setLeft(qMin(sprite.left(), x));
+        sprite.setRight(qMax(sprite.right(), x));
+        sprite.setBottom(y);
+      }
+    }
+  }
+
+  // Detached parts of a sprite, like a weapon, are in the same box.
+  merge_overlapping_rects(sprites);
+  return sprites;
+}
+
+/**
+ * @brief Detects the frames of a direction in an area of the image.
+ *
+ * Sprites are assumed to be aligned on a uniform grid and stored in rows
+ * from left to right, like the frames of a sprite direction.
+ * The origin is placed at the horizontal center of frames, on the lowest
+ * opaque row of sprites.
+ *
+ * @param area The area to search, in image coordinates.
+ * @return The frames detected, or an invalid grid if there is no sprite.
+ */
+SpriteSheetDetector::Grid SpriteSheetDetector::detect_grid(
+    const QRect& area) const {
+
+  Grid grid = { QRect(), 0, 0, QPoint() };
+
+  const QList<QRect> sprites = find_sprites(area);
+  if (sprites.isEmpty()) {
+    return grid;
+  }
+
+  QList<Interval> columns;
+  QList<Interval> rows;
+  int max_width = 0;
+  int max_height = 0;
+  Q_FOREACH (const QRect& sprite, sprites) {
+    columns << Interval(sprite.left(), sprite.right());
+    rows << Interval(sprite.top(), sprite.bottom());
+    max_width = qMax(max_width, sprite.width());
+    max_height = qMax(max_height, sprite.height());
+  }
+  columns = get_bands(columns);
+  rows = get_bands(rows);
+
+  const QRect bounds = area.intersected(image.rect());
+  int x = 0;
+  int y = 0;
+  const int width = get_cell_length(
+        columns, bounds.x(), bounds.width(), max_width, x);
+  const int height = get_cell_length(
+        rows, bounds.y(), bounds.height(), max_height, y);
+  const int num_columns = columns.size();
+
+  // Put each sprite in its cell.
+  int last_cell = 0;
+  int origin_y = 0;
+  Q_FOREACH (const QRect& sprite, sprites) {
+    const int column = qBound(
+          0, (sprite.center().x() - x) / width, num_columns - 1);
+    const int row = qMax(0, (sprite.center().y() - y) / height);
+    last_cell = qMax(last_cell, row * num_columns + column);
+    origin_y = qMax(origin_y, sprite.bottom() + 1 - (y + row * height));
+  }
+
+  grid.first_frame = QRect(x, y, width, height);
+  grid.num_frames = last_cell + 1;
+  grid.num_columns = qMin(num_columns, grid.num_frames);
+  grid.origin = QPoint(width / 2, qMin(origin_y, height));
+  return grid;
+}
+
+}
@@ -18,9 +18,30 @@
 #include "quest.h"
 #include "strings_model.h"
 #include <QIcon>
+#include <QtConcurrentRun>
 
 namespace SolarusEditor {
 
+namespace {
+
+/**
+ * @brief Parses a strings data file in a worker thread.
+ * @param language_id Language of the translation.
+ * @param path The strings data file.
+ * @return The translated strings.
+ */
+StringsModel::TranslationData load_translation_in_worker(
+    const QString& language_id, const QString& path) {
+
+  StringsModel::TranslationData data;
+  data.language_id = language_id;
+  data.path = path;
+  data.valid = data.resources.import_from_file(path.toStdString());
+  return data;
+}
+
+}
+
 using StringResources = Solarus::StringResources;
 
 /**
@@ -47,6 +68,9 @@ StringsModel::StringsModel(
 
   // Create the indexed tree.
   build_string_tree();
+
+  connect(&translation_watcher, SIGNAL(finished()),
+          this, SLOT(translation_loaded()));
 }
 
 /**
@@ -130,16 +154,13 @@ QModelIndex StringsModel::index(
     return QModelIndex();
   }
 
-  if (!parent.isValid()) {
-    return key_to_index(string_tree.get_row_key(row), column);
-  }
-
-  QString key = index_to_key(parent);
-  if (row >= string_tree.get_row_count(key)) {
+  QString* internal_key =
+      string_tree.get_row_internal_key(row, index_to_key(parent));
+  if (internal_key == nullptr) {
     return QModelIndex();
   }
 
-  return key_to_index(string_tree.get_row_key(row, key), column);
+  return createIndex(row, column, internal_key);
 }
 
 /**
@@ -414,6 +435,7 @@ void StringsModel::create_string(const QString& key, const QString& value) {
   } else {
     dataChanged(key_to_index(key), key_to_index(key, 2));
   }
+  set_missing_translation(key, false);
 
   // Notify people.
   emit string_created(key);
@@ -546,6 +568,7 @@ QString StringsModel::set_string_key(const QString& key, const QString& new_key)
   } else if (string_tree.remove_key(key)) {
     dataChanged(key_to_index(key), key_to_index(key, 2));
   }
+  set_missing_translation(key, translated_string_exists(key));
 
   // Add to the indexed tree.
   if (string_tree.add_key(new_key, parent_key, index)) {
@@ -556,6 +579,7 @@ QString StringsModel::set_string_key(const QString& key, const QString& new_key)
   } else {
     dataChanged(key_to_index(key), key_to_index(key, 2));
   }
+  set_missing_translation(new_key, false);
 
   // Notify people.
   emit string_key_changed(key, new_key);
@@ -661,6 +685,7 @@ void StringsModel::delete_string(const QString& key) {
   } else if (string_tree.remove_key(key)) {
     dataChanged(key_to_index(key), key_to_index(key, 2));
   }
+  set_missing_translation(key, translated_string_exists(key));
 
   // Notify people.
   emit string_deleted(key);
@@ -685,6 +710,108 @@ QList<QPair<QString, QString>> StringsModel::delete_prefix(const QString& prefix
   return list;
 }
 
+/**
+ * @brief Creates, changes or deletes several strings at once.
+ *
+ * Unlike the functions that change one string, views are notified with
+ * a single layout change, which is much faster for many strings.
+ * Then, emits string_created(), string_value_changed() or string_deleted()
+ * for each string actually changed.
+ *
+ * The existing selection is preserved if its string still exists.
+ *
+ * @param values The new value of each string to change.
+ * A null value deletes the string.
+ * @return The previous value of each string actually changed,
+ * or a null value for strings that did not exist.
+ * Passing it to this function again cancels the changes.
+ */
+QMap<QString, QString> StringsModel::set_strings(
+    const QMap<QString, QString>& values) {
+
+  QMap<QString, QString> old_values;
+  for (auto it = values.begin(); it != values.end(); ++it) {
+    const QString& key = it.key();
+    const bool exists = string_exists(key);
+    if (it.value().isNull()) {
+      if (exists) {
+        old_values.insert(key, get_string(key));
+      }
+    }
+    else if (!exists) {
+      if (is_valid_key(key)) {
+        old_values.insert(key, QString());
+      }
+    }
+    else if (get_string(key) != it.value()) {
+      old_values.insert(key, get_string(key));
+    }
+  }
+
+  if (old_values.isEmpty()) {
+    return old_values;
+  }
+
+  // Save and clear the selection since a lot of indexes may change.
+  QString old_selection = get_selected_key();
+  clear_selection();
+
+  emit layoutAboutToBeChanged();
+
+  // Remember persistent indexes by key before nodes are destroyed.
+  const QModelIndexList old_indexes = persistentIndexList();
+  QStringList old_keys;
+  for (const QModelIndex& index : old_indexes) {
+    old_keys << index_to_key(index);
+  }
+
+  for (auto it = old_values.begin(); it != old_values.end(); ++it) {
+    const QString& key = it.key();
+    const QString& value = values.value(key);
+    if (value.isNull()) {
+      resources.remove_string(key.toStdString());
+      string_tree.remove_key(key);
+      string_tree.set_flagged(key, translated_string_exists(key));
+    }
+    else if (it.value().isNull()) {
+      resources.add_string(key.toStdString(), value.toStdString());
+      string_tree.add_key(key);
+      string_tree.set_flagged(key, false);
+    }
+    else {
+      resources.get_string(key.toStdString()) = value.toStdString();
+    }
+  }
+
+  QModelIndexList new_indexes;
+  for (int i = 0; i < old_indexes.size(); ++i) {
+    new_indexes << key_to_index(old_keys[i], old_indexes[i].column());
+  }
+  changePersistentIndexList(old_indexes, new_indexes);
+
+  emit layoutChanged();
+
+  // Notify people.
+  for (auto it = old_values.begin(); it != old_values.end(); ++it) {
+    const QString& key = it.key();
+    const QString& value = values.value(key);
+    if (value.isNull()) {
+      emit string_deleted(key);
+    }
+    else if (it.value().isNull()) {
+      emit string_created(key);
+    }
+    else {
+      emit string_value_changed(key, value);
+    }
+  }
+
+  // Restore the selection.
+  set_selected_key(old_selection);
+
+  return old_values;
+}
+
 /**
  * @brief Returns the selection model.
  * @return The selection info.
@@ -744,6 +871,18 @@ QString StringsModel::get_translation_id() const {
   return translation_id;
 }
 
+/**
+ * @brief Returns whether the translation file is being parsed.
+ *
+ * Translated texts are not up to date until translation_changed() or
+ * translation_load_failed() is emitted.
+ *
+ * @return @c true if the translation is being loaded.
+ */
+bool StringsModel::is_loading_translation() const {
+  return !translation_id.isEmpty() && translation_watcher.isRunning();
+}
+
 /**
  * @brief Changes the language of the current translation.
  * @param language_id The language id of the translation.
@@ -767,39 +906,85 @@ void StringsModel::clear_translation() {
   }
 
   translation_id = "";
-  clear_translation_from_tree();
-  translation_resources.clear();
-  headerDataChanged(Qt::Horizontal, 2, 2);
+  set_translation_resources(Solarus::StringResources());
 }
 
 /**
  * @brief Reload the current translation.
+ *
+ * The strings file is parsed in a worker thread.
+ * translation_changed() is emitted when the new translation is shown,
+ * or translation_load_failed() if the file cannot be parsed.
  */
 void StringsModel::reload_translation() {
 
-  clear_translation_from_tree();
-
   QString path = quest.get_strings_path(translation_id);
-  translation_resources.clear();
-  if (!translation_resources.import_from_file(path.toStdString())) {
+  translation_watcher.setFuture(QtConcurrent::run(
+      load_translation_in_worker, translation_id, path));
+}
+
+/**
+ * @brief Slot called when the translation file was parsed.
+ */
+void StringsModel::translation_loaded() {
+
+  const TranslationData data = translation_watcher.result();
+  if (data.language_id != translation_id) {
+    // The translation was changed or cleared in the meantime.
+    return;
+  }
+
+  if (!data.valid) {
     translation_id = "";
-    throw EditorException(tr("Cannot open strings data file '%1'").arg(path));
+    set_translation_resources(Solarus::StringResources());
+    emit translation_load_failed(
+          tr("Cannot open strings data file '%1'").arg(data.path));
+    return;
+  }
+
+  set_translation_resources(data.resources);
+}
+
+/**
+ * @brief Replaces the translated strings.
+ *
+ * The indexed tree is updated in a single layout change rather than with
+ * a row insertion or removal for each key, and persistent indexes like the
+ * selection or the expanded items of views are kept.
+ *
+ * @param resources The new translated strings.
+ */
+void StringsModel::set_translation_resources(
+    const Solarus::StringResources& resources) {
+
+  emit layoutAboutToBeChanged();
+
+  // Remember persistent indexes by key before nodes are destroyed.
+  const QModelIndexList old_indexes = persistentIndexList();
+  QStringList old_keys;
+  for (const QModelIndex& index : old_indexes) {
+    old_keys << index_to_key(index);
   }
 
+  clear_translation_from_tree();
+  translation_resources = resources;
   for (const auto& kvp : translation_resources.get_strings()) {
     QString key = QString::fromStdString(kvp.first);
     QString parent_key;
     int index;
-    if (string_tree.add_ref(key, parent_key, index)) {
-      beginInsertRows(key_to_index(parent_key), index, index);
-      endInsertRows();
-    } else {
-      QModelIndex model_index = key_to_index(key, 2);
-      dataChanged(model_index, model_index);
-    }
+    string_tree.add_ref(key, parent_key, index);
+    string_tree.set_flagged(key, !string_exists(key));
   }
 
+  QModelIndexList new_indexes;
+  for (int i = 0; i < old_indexes.size(); ++i) {
+    new_indexes << key_to_index(old_keys[i], old_indexes[i].column());
+  }
+  changePersistentIndexList(old_indexes, new_indexes);
+
+  emit layoutChanged();
   headerDataChanged(Qt::Horizontal, 2, 2);
+  emit translation_changed();
 }
 
 /**
@@ -831,22 +1016,16 @@ QStringList StringsModel::get_translated_keys(const QString& prefix) const {
 
 /**
  * @brief Returns whether string or sub string has translation and don't exists.
+ *
+ * Missing translations are flagged in the indexed tree,
+ * so this is a constant-time operation.
+ *
  * @param key The key of the string.
  * @return @c true if the string or sub string has tanslation and don't exists.
  */
 bool StringsModel::has_missing_translation(const QString& key) const {
 
-  if (!string_exists(key) && translated_string_exists(key)) {
-    return true;
-  }
-
-  Q_FOREACH (const QString& sub_key, get_translated_keys(key + ".")) {
-    if (!string_exists(sub_key)) {
-      return true;
-    }
-  }
-
-  return false;
+  return string_tree.get_num_flagged(key) > 0;
 }
 
 /**
@@ -877,26 +1056,37 @@ void StringsModel::build_string_tree() {
 
 /**
  * @brief Removes all translated string from the indexed string tree.
+ *
+ * No signal is emitted: this is done by set_translation_resources().
  */
 void StringsModel::clear_translation_from_tree() {
 
   for (const auto& kvp : translation_resources.get_strings()) {
     QString key = QString::fromStdString(kvp.first);
-    QString parent_key;
-    int index;
-    if (string_tree.can_remove_ref(key, parent_key, index)) {
-      if (!string_exists(key)) {
-        beginRemoveRows(key_to_index(parent_key), index, index);
-        string_tree.remove_ref(key, false);
-        endRemoveRows();
-      } else if (string_tree.remove_ref(key, true)) {
-        QModelIndex model_index = key_to_index(key, 2);
-        dataChanged(model_index, model_index);
-      }
-    } else if (string_tree.remove_ref(key, string_exists(key))) {
-      QModelIndex model_index = key_to_index(key, 2);
-      dataChanged(model_index, model_index);
-    }
+    string_tree.set_flagged(key, false);
+    string_tree.remove_ref(key, string_exists(key));
+  }
+}
+
+/**
+ * @brief Flags or unflags a key as a missing translation in the indexed tree.
+ *
+ * Emits dataChanged() for the key and its parents if their icon changes.
+ *
+ * @param key The key of the string.
+ * @param missing @c true if the string is translated but does not exist.
+ */
+void StringsModel::set_missing_translation(const QString& key, bool missing) {
+
+  if (!string_tree.set_flagged(key, missing)) {
+    return;
+  }
+
+  QString parent_key = key;
+  while (!parent_key.isEmpty()) {
+    QModelIndex model_index = key_to_index(parent_key);
+    dataChanged(model_index, model_index);
+    parent_key = string_tree.get_parent(parent_key);
   }
 }
 
@@ -17,15 +17,311 @@
 #include "color.h"
 #include "editor_exception.h"
 #include "quest.h"
+#include "quest_index.h"
 #include "rectangle.h"
 #include "pattern_animation_traits.h"
+#include "skyline_packer.h"
 #include "tileset_model.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
 #include <QIcon>
+#include <QSet>
+#include <QPainter>
+#include <QSaveFile>
+#include <QStringList>
+#include <QtConcurrentMap>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <vector>
 
 namespace SolarusEditor {
 
 using TilePatternData = Solarus::TilePatternData;
 
+namespace {
+
+/**
+ * @brief Magic number at the beginning of icon cache files.
+ */
+constexpr quint32 icon_cache_magic = 0x53544943;  // "STIC"
+
+/**
+ * @brief Version of the icon cache file format.
+ *
+ * Increment it whenever icons are built differently.
+ */
+constexpr quint32 icon_cache_version = 2;
+
+/**
+ * @brief Number of icons to build in advance around the requested ones.
+ */
+constexpr int icon_prefetch_count = 64;
+
+/**
+ * @brief Returns the key of the icon of a pattern frame in the icon cache.
+ * @param frame The frame.
+ * @return The corresponding key.
+ */
+QString get_icon_key(const QRect& frame) {
+
+  return QString("%1,%2,%3,%4").
+      arg(frame.x()).arg(frame.y()).arg(frame.width()).arg(frame.height());
+}
+
+/**
+ * @brief Builds a 32x32 icon from the image of a pattern.
+ *
+ * This function can be called from worker threads.
+ *
+ * @param pattern_image Full-size image of the pattern.
+ * @return The icon.
+ */
+QImage make_icon_image(const QImage& pattern_image) {
+
+  // Make sure we have an alpha channel.
+  QImage image = pattern_image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+
+  if (image.height() <= 16) {
+    image = image.scaledToHeight(image.height() * 2);
+  }
+  else if (image.height() > 32) {
+    image = image.scaledToHeight(32);
+  }
+
+  // Center the pattern in a 32x32 image.
+  int dx = (32 - image.width()) / 2;
+  int dy = (32 - image.height()) / 2;
+  return image.copy(-dx, -dy, 32, 32);
+}
+
+/**
+ * @brief Computes a hash of the pixels of an image.
+ *
+ * Each scanline is read as 64-bit words spread over four independent
+ * accumulators, which lets the compiler process them in parallel.
+ *
+ * @param image An image in Format_ARGB32_Premultiplied.
+ * @return The hash value.
+ */
+quint64 hash_image(const QImage& image) {
+
+  constexpr quint64 prime = 0x100000001b3ULL;
+  quint64 lanes[4] = {
+    0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL,
+    0x9e3779b97f4a7c15ULL, 0x7f4a7c159e3779b9ULL
+  };
+
+  const int line_bytes = image.width() * 4;
+  const int num_words = line_bytes / 8;
+  for (int y = 0; y < image.height(); ++y) {
+    const uchar* line = image.constScanLine(y);
+    int i = 0;
+    for (; i + 4 <= num_words; i += 4) {
+      for (int lane = 0; lane < 4; ++lane) {
+        quint64 word;
+        memcpy(&word, line + (i + lane) * 8, 8);
+        lanes[lane] = (lanes[lane] ^ word) * prime;
+      }
+    }
+    for (; i < num_words; ++i) {
+      quint64 word;
+      memcpy(&word, line + i * 8, 8);
+      lanes[0] = (lanes[0] ^ word) * prime;
+    }
+    for (int j = num_words * 8; j < line_bytes; ++j) {
+      lanes[1] = (lanes[1] ^ line[j]) * prime;
+    }
+  }
+
+  quint64 hash = image.width() * 31 + image.height();
+  for (quint64 lane : lanes) {
+    hash = (hash ^ lane) * prime;
+  }
+  return hash;
+}
+
+/**
+ * @brief Returns whether two images of the same size have the same pixels.
+ * @param image_1 An image in Format_ARGB32_Premultiplied.
+ * @param image_2 Another image in Format_ARGB32_Premultiplied.
+ * @param tolerance Maximum difference allowed on each color channel.
+ * @return @c true if all pixels match.
+ */
+bool images_match(const QImage& image_1, const QImage& image_2, int tolerance) {
+
+  if (image_1.size() != image_2.size()) {
+    return false;
+  }
+
+  const int line_bytes = image_1.width() * 4;
+  for (int y = 0; y < image_1.height(); ++y) {
+    const uchar* line_1 = image_1.constScanLine(y);
+    const uchar* line_2 = image_2.constScanLine(y);
+    if (tolerance == 0) {
+      if (memcmp(line_1, line_2, line_bytes) != 0) {
+        return false;
+      }
+      continue;
+    }
+    for (int i = 0; i < line_bytes; ++i) {
+      if (qAbs(int(line_1[i]) - int(line_2[i])) > tolerance) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Returns the parts of an image that differ from another one.
+ *
+ * Images are compared by blocks of 8x8 pixels.
+ * Identical lines are skipped with a single memcmp() of the whole line,
+ * which is vectorized by the C library, and only lines that differ are
+ * compared block by block.
+ *
+ * @param old_image The previous image.
+ * @param new_image The new image.
+ * @return The union of all blocks that changed.
+ * The whole image if the size has changed.
+ */
+QRegion get_changed_blocks(const QImage& old_image, const QImage& new_image) {
+
+  if (old_image.size() != new_image.size()) {
+    return QRegion(old_image.rect()).united(new_image.rect());
+  }
+
+  constexpr int block_size = 8;
+  const QImage& image_1 = old_image.convertToFormat(QImage::Format_ARGB32);
+  const QImage& image_2 = new_image.convertToFormat(QImage::Format_ARGB32);
+  const int width = image_1.width();
+  const int height = image_1.height();
+  const int num_block_columns = (width + block_size - 1) / block_size;
+
+  QRegion region;
+  std::vector<bool> changed_columns(num_block_columns);
+  for (int block_y = 0; block_y < height; block_y += block_size) {
+
+    const int block_height = qMin(block_size, height - block_y);
+    std::fill(changed_columns.begin(), changed_columns.end(), false);
+    bool row_changed = false;
+    for (int y = block_y; y < block_y + block_height; ++y) {
+      const uchar* line_1 = image_1.constScanLine(y);
+      const uchar* line_2 = image_2.constScanLine(y);
+      if (memcmp(line_1, line_2, width * 4) == 0) {
+        continue;
+      }
+
+      row_changed = true;
+      for (int column = 0; column < num_block_columns; ++column) {
+        if (changed_columns[column]) {
+          continue;
+        }
+        const int x = column * block_size;
+        const int num_bytes = qMin(block_size, width - x) * 4;
+        if (memcmp(line_1 + x * 4, line_2 + x * 4, num_bytes) != 0) {
+          changed_columns[column] = true;
+        }
+      }
+    }
+
+    if (!row_changed) {
+      continue;
+    }
+
+    // Merge consecutive changed blocks of this row.
+    int column = 0;
+    while (column < num_block_columns) {
+      if (!changed_columns[column]) {
+        ++column;
+        continue;
+      }
+      const int first_column = column;
+      while (column < num_block_columns && changed_columns[column]) {
+        ++column;
+      }
+      const int x = first_column * block_size;
+      const int block_width = qMin(column * block_size, width) - x;
+      region += QRect(x, block_y, block_width, block_height);
+    }
+  }
+  return region;
+}
+
+/**
+ * @brief Returns the rows of a selection as sorted, disjoint ranges.
+ *
+ * Contiguous and overlapping ranges are merged,
+ * so that two equivalent selections give the same result.
+ *
+ * @param selection A selection of a list model.
+ * @return The first and last row of each range.
+ */
+QList<QPair<int, int>> get_row_ranges(const QItemSelection& selection) {
+
+  QList<QPair<int, int>> ranges;
+  Q_FOREACH (const QItemSelectionRange& range, selection) {
+    if (range.isValid()) {
+      ranges << qMakePair(range.top(), range.bottom());
+    }
+  }
+  std::sort(ranges.begin(), ranges.end());
+
+  QList<QPair<int, int>> merged_ranges;
+  Q_FOREACH (const auto& range, ranges) {
+    if (!merged_ranges.isEmpty() && range.first <= merged_ranges.last().second + 1) {
+      merged_ranges.last().second = qMax(merged_ranges.last().second, range.second);
+    }
+    else {
+      merged_ranges << range;
+    }
+  }
+  return merged_ranges;
+}
+
+/**
+ * @brief Returns the frame of an icon from its key in the icon cache.
+ * @param key A key returned by get_icon_key().
+ * @return The corresponding frame, or an invalid rectangle.
+ */
+QRect get_icon_frame(const QString& key) {
+
+  const QStringList& values = key.split(',');
+  if (values.size() != 4) {
+    return QRect();
+  }
+  return QRect(values[0].toInt(), values[1].toInt(),
+               values[2].toInt(), values[3].toInt());
+}
+
+/**
+ * @brief Returns the sum of all color channels of an image divided by its
+ * number of pixels.
+ * @param image An image in Format_ARGB32_Premultiplied.
+ * @return The mean intensity, between 0 and 4 * 255.
+ */
+double get_mean_intensity(const QImage& image) {
+
+  const int line_bytes = image.width() * 4;
+  qint64 sum = 0;
+  for (int y = 0; y < image.height(); ++y) {
+    const uchar* line = image.constScanLine(y);
+    for (int i = 0; i < line_bytes; ++i) {
+      sum += line[i];
+    }
+  }
+  const int num_pixels = image.width() * image.height();
+  return num_pixels == 0 ? 0.0 : double(sum) / num_pixels;
+}
+
+}
+
 /**
  * @brief Creates a tileset model.
  * @param quest The quest.
@@ -40,7 +336,26 @@ TilesetModel::TilesetModel(
   QAbstractListModel(parent),
   quest(quest),
   tileset_id(tileset_id),
-  selection_model(this) {
+  patterns_image_modified(false),
+  image_file_watcher(),
+  image_reload_timer(),
+  pattern_usage_timer(),
+  selection_model(this),
+  selected_flags(),
+  num_selected(0),
+  selection_cache_valid(false),
+  icon_placeholder(32, 32),
+  image_generation(0),
+  icons_to_load(),
+  icon_request_timer(),
+  icon_watcher(),
+  icons_changed_timer(),
+  first_icon_changed(-1),
+  last_icon_changed(-1),
+  icon_cache_loaded(false),
+  icon_cache_key(),
+  cached_icons(),
+  icon_cache_dirty(false) {
 
   // Load the tileset data file.
   QString path = quest.get_tileset_data_file_path(tileset_id);
@@ -55,8 +370,73 @@ TilesetModel::TilesetModel(
     patterns.append(PatternModel(pattern_id));
   }
 
-  // Load the tileset image.
-  patterns_image = QImage(quest.get_tileset_tiles_image_path(tileset_id));
+  // Load the tileset image and reload it when it is modified externally.
+  const QString& image_path = quest.get_tileset_tiles_image_path(tileset_id);
+  patterns_image = quest.get_image_cache().get_image(image_path);
+  watch_patterns_image_file();
+  // Also watch the directory to notice when the file appears again.
+  const QString& image_dir_path = QFileInfo(image_path).absolutePath();
+  if (QFileInfo(image_dir_path).isDir()) {
+    image_file_watcher.addPath(image_dir_path);
+  }
+  connect(&image_file_watcher, SIGNAL(fileChanged(QString)),
+          this, SLOT(patterns_image_file_changed(QString)));
+  connect(&image_file_watcher, SIGNAL(directoryChanged(QString)),
+          this, SLOT(patterns_image_directory_changed()));
+  image_reload_timer.setSingleShot(true);
+  image_reload_timer.setInterval(300);
+  connect(&image_reload_timer, SIGNAL(timeout()),
+          this, SLOT(reload_patterns_image()));
+
+  pattern_usage_timer.setSingleShot(true);
+  pattern_usage_timer.setInterval(0);
+  connect(&pattern_usage_timer, SIGNAL(timeout()),
+          this, SLOT(emit_pattern_usage_changed()));
+  connect(&quest.get_index(), SIGNAL(pattern_usage_changed(QString)),
+          this, SLOT(pattern_usage_changed(QString)));
+  connect(&quest.get_index(), SIGNAL(build_finished()),
+          this, SLOT(index_build_finished()));
+
+  // Keep track of selected patterns for fast lookups.
+  connect(&selection_model, SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
+          this, SLOT(update_selection_cache(QItemSelection, QItemSelection)));
+  connect(this, SIGNAL(rowsInserted(QModelIndex, int, int)),
+          this, SLOT(invalidate_selection_cache()));
+  connect(this, SIGNAL(rowsRemoved(QModelIndex, int, int)),
+          this, SLOT(invalidate_selection_cache()));
+  connect(this, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)),
+          this, SLOT(invalidate_selection_cache()));
+  connect(this, SIGNAL(layoutChanged()),
+          this, SLOT(invalidate_selection_cache()));
+  connect(this, SIGNAL(modelReset()),
+          this, SLOT(invalidate_selection_cache()));
+
+  // Build icons in the background.
+  icon_placeholder.fill(Qt::transparent);
+  icon_request_timer.setSingleShot(true);
+  icon_request_timer.setInterval(0);
+  connect(&icon_request_timer, SIGNAL(timeout()),
+          this, SLOT(start_loading_icons()));
+  icons_changed_timer.setSingleShot(true);
+  icons_changed_timer.setInterval(50);
+  connect(&icons_changed_timer, SIGNAL(timeout()),
+          this, SLOT(emit_icons_changed()));
+  connect(&icon_watcher, SIGNAL(resultReadyAt(int)),
+          this, SLOT(icon_loaded(int)));
+  connect(&icon_watcher, SIGNAL(finished()),
+          this, SLOT(icons_loading_finished()));
+}
+
+/**
+ * @brief Destroys the tileset model.
+ *
+ * Waits for icons being built and saves the icon cache.
+ */
+TilesetModel::~TilesetModel() {
+
+  icon_watcher.cancel();
+  icon_watcher.waitForFinished();
+  save_icon_cache();
 }
 
 /**
@@ -85,6 +465,14 @@ void TilesetModel::save() const {
   if (!tileset.export_to_file(path.toStdString())) {
     throw EditorException(tr("Cannot save tileset data file '%1'").arg(path));
   }
+
+  if (patterns_image_modified) {
+    QString image_path = quest.get_tileset_tiles_image_path(tileset_id);
+    if (!patterns_image.save(image_path, "PNG")) {
+      throw EditorException(tr("Cannot save tileset image '%1'").arg(image_path));
+    }
+    patterns_image_modified = false;
+  }
 }
 
 /**
@@ -126,6 +514,9 @@ int TilesetModel::rowCount(const QModelIndex& /* parent */) const {
 
 /**
  * @brief Returns the datat of an item for a given role.
+ *
+ * Qt::UserRole gives the number of tiles of the quest using the pattern.
+ *
  * @param index Index of the item to get.
  * @param role The wanted role.
  * @return The data.
@@ -138,11 +529,36 @@ QVariant TilesetModel::data(const QModelIndex& index, int role) const {
     return QVariant();  // No text: only the icon.
     break;
 
-  case Qt::DecorationRole:
-    // Show an icon representing the pattern.
-    return get_pattern_icon(index.row());
+  case Qt::ToolTipRole:
+    return get_pattern_usage_tooltip(index.row());
     break;
 
+  case Qt::UserRole:
+    return get_pattern_usage(index.row());
+    break;
+
+  case Qt::DecorationRole:
+  {
+    // Show an icon representing the pattern,
+    // or a placeholder until it is built in the background.
+    const int row = index.row();
+    if (!pattern_exists(row)) {
+      return QVariant();
+    }
+    const PatternModel& pattern = patterns.at(row);
+    if (pattern.icon.isNull()) {
+      const QImage& cached_icon = get_cached_icon(get_pattern_frame(row));
+      if (!cached_icon.isNull()) {
+        pattern.icon = QPixmap::fromImage(cached_icon);
+      }
+      else {
+        request_pattern_icons(row, row);
+        return icon_placeholder;
+      }
+    }
+    return pattern.icon;
+  }
+
   default:
     break;
   }
@@ -150,6 +566,111 @@ QVariant TilesetModel::data(const QModelIndex& index, int role) const {
   return QVariant();
 }
 
+/**
+ * @brief Returns how many tiles of the quest use a pattern.
+ *
+ * The information comes from the quest index, so it reflects map files
+ * as saved on disk.
+ *
+ * @param index A pattern index.
+ * @return The number of tiles and dynamic tiles using this pattern in all
+ * maps of the quest.
+ */
+int TilesetModel::get_pattern_usage(int index) const {
+
+  if (!pattern_exists(index)) {
+    return 0;
+  }
+
+  return quest.get_index().get_pattern_usage(tileset_id, index_to_id(index));
+}
+
+/**
+ * @brief Returns a text that describes the maps using a pattern.
+ * @param index A pattern index.
+ * @return The tooltip text of this pattern.
+ */
+QString TilesetModel::get_pattern_usage_tooltip(int index) const {
+
+  if (!pattern_exists(index)) {
+    return QString();
+  }
+
+  const QString& pattern_id = index_to_id(index);
+  const QMap<QString, int>& maps =
+      quest.get_index().get_maps_using_pattern(tileset_id, pattern_id);
+  if (maps.isEmpty()) {
+    return tr("Pattern '%1' (unused)").arg(pattern_id);
+  }
+
+  QStringList lines;
+  lines << tr("Pattern '%1': %2 tile(s)").arg(pattern_id).arg(get_pattern_usage(index));
+  for (auto it = maps.constBegin(); it != maps.constEnd(); ++it) {
+    lines << tr("%1: %2 tile(s)").arg(it.key()).arg(it.value());
+  }
+  return lines.join('\n');
+}
+
+/**
+ * @brief Returns the indexes of patterns that no map of the quest uses.
+ * @return The unused patterns.
+ */
+QList<int> TilesetModel::get_unused_pattern_indexes() const {
+
+  const QSet<QString>& used_patterns =
+      quest.get_index().get_used_patterns(tileset_id);
+
+  QList<int> indexes;
+  for (int i = 0; i < patterns.size(); ++i) {
+    if (!used_patterns.contains(patterns.at(i).id)) {
+      indexes << i;
+    }
+  }
+  return indexes;
+}
+
+/**
+ * @brief Slot called when the quest index detects changes in maps using a
+ * tileset.
+ *
+ * Views are notified later, once for all changes made in the meantime.
+ *
+ * @param tileset_id Id of the tileset whose pattern usage has changed.
+ */
+void TilesetModel::pattern_usage_changed(const QString& tileset_id) {
+
+  if (tileset_id != this->tileset_id) {
+    return;
+  }
+
+  pattern_usage_timer.start();
+}
+
+/**
+ * @brief Slot called when the quest index has finished parsing maps.
+ *
+ * The usage of patterns may have changed in any map.
+ */
+void TilesetModel::index_build_finished() {
+
+  pattern_usage_timer.start();
+}
+
+/**
+ * @brief Notifies views that the usage of patterns has changed.
+ *
+ * Only the tooltip and the usage count of items change.
+ */
+void TilesetModel::emit_pattern_usage_changed() {
+
+  if (patterns.isEmpty()) {
+    return;
+  }
+
+  emit dataChanged(index(0), index(patterns.size() - 1),
+                   QVector<int>() << Qt::ToolTipRole << Qt::UserRole);
+}
+
 /**
  * @brief Returns the number of patterns in the tileset.
  * @return The number of patterns.
@@ -232,6 +753,37 @@ void TilesetModel::build_index_map() {
   }
 }
 
+/**
+ * @brief Rebuilds the index and the list of patterns after patterns were
+ * added to or removed from the tileset data.
+ *
+ * Image caches of patterns that still exist are kept.
+ * Must be called between beginResetModel() and endResetModel().
+ */
+void TilesetModel::rebuild_pattern_models() {
+
+  QHash<QString, int> old_indexes;
+  for (int i = 0; i < patterns.size(); ++i) {
+    old_indexes.insert(patterns[i].id, i);
+  }
+
+  build_index_map();
+
+  QList<PatternModel> old_patterns = patterns;
+  patterns.clear();
+  patterns.reserve(static_cast<int>(ids_to_indexes.size()));
+  for (const auto& kvp : ids_to_indexes) {
+    const QString& pattern_id = kvp.first;
+    auto it = old_indexes.constFind(pattern_id);
+    if (it != old_indexes.constEnd()) {
+      patterns.append(old_patterns[it.value()]);
+    }
+    else {
+      patterns.append(PatternModel(pattern_id));
+    }
+  }
+}
+
 /**
  * @brief Creates a new pattern in this tileset with default properties.
  *
@@ -266,11 +818,7 @@ int TilesetModel::create_pattern(const QString& pattern_id, const QRect& frame)
   }
 
   // Save and clear the selection since a lot of indexes may change.
-  QModelIndexList old_selected_indexes = selection_model.selection().indexes();
-  QStringList old_selection_ids;
-  Q_FOREACH (const QModelIndex& old_selected_index, old_selected_indexes) {
-    old_selection_ids << index_to_id(old_selected_index.row());
-  }
+  QStringList old_selection_ids = get_selected_ids();
   clear_selection();
 
   // Add the pattern to the tileset file.
@@ -293,137 +841,412 @@ int TilesetModel::create_pattern(const QString& pattern_id, const QRect& frame)
   emit pattern_created(index, pattern_id);
 
   // Restore the selection.
-  Q_FOREACH (QString selected_pattern_id, old_selection_ids) {
-    int new_index = id_to_index(selected_pattern_id);
-    add_to_selected(new_index);
-  }
+  set_selected_ids(old_selection_ids);
 
   return index;
 }
 
 /**
- * @brief Deletes a tile pattern.
- *
- * The index of multiple patterns in the pattern list may change, since
- * patterns are sorted alphabetically.
- * Emits rowsAboutToBeRemoved(), removes the pattern
- * and then emits rowsRemoved(), as required by QAbstractItemModel.
- *
- * Then, emits pattern_deleted().
+ * @brief Creates several tile patterns at once.
  *
- * Except for the deleted pattern, the existing selection is preserved,
- * though the index of many patterns can change.
- * The selection is cleared before the operations and restored after,
- * updated with the new indexes.
+ * This is much faster than calling create_pattern() for each pattern:
+ * the index is rebuilt only once and views are reset instead of being
+ * notified of each insertion.
+ * Emits modelAboutToBeReset() and modelReset().
  *
- * If you have multiple patterns to delete, call delete_patterns()
- * for better performance.
+ * The existing selection is preserved.
  *
- * @param index Index of the pattern to delete.
- * @throws EditorException in case of error.
+ * @param frames Frame of each pattern to create, indexed by pattern id.
+ * @return Index of each pattern created, ordered like @c frames.
+ * @throws EditorException If an id is invalid or already exists.
+ * In this case, nothing is created.
  */
-void TilesetModel::delete_pattern(int index) {
-
-  QString pattern_id = index_to_id(index);
+QList<int> TilesetModel::create_patterns(const QMap<QString, QRect>& frames) {
 
   // Make some checks first.
-  if (pattern_id.isEmpty()) {
-      throw EditorException(tr("Invalid tile pattern index: %1").arg(index));
+  Q_FOREACH (const QString& pattern_id, frames.keys()) {
+    if (!is_valid_pattern_id(pattern_id)) {
+      throw EditorException(tr("Invalid tile pattern id: '%1'").arg(pattern_id));
+    }
+    if (id_to_index(pattern_id) != -1) {
+      throw EditorException(tr("Tile pattern '%1' already exists").arg(pattern_id));
+    }
   }
 
-  // Save and clear the selection since a lot of indexes may change.
-  QModelIndexList old_selected_indexes = selection_model.selection().indexes();
-  QStringList old_selection_ids;
-  Q_FOREACH (const QModelIndex& old_selected_index, old_selected_indexes) {
-    old_selection_ids << index_to_id(old_selected_index.row());
+  if (frames.isEmpty()) {
+    return QList<int>();
   }
-  clear_selection();
 
-  // Delete the pattern in the tileset file.
-  tileset.remove_pattern(pattern_id.toStdString());
-
-  // Rebuild indexes in the list model (indexes were shifted).
-  build_index_map();
-
-  // Call beginRemoveRows() as requested by QAbstractItemModel.
-  beginRemoveRows(QModelIndex(), index, index);
+  // Save the selection: resetting the model clears it.
+  const QStringList& old_selection_ids = get_selected_ids();
 
-  // Update our pattern model list.
-  patterns.removeAt(index);
+  beginResetModel();
 
-  // Notify people before restoring the selection, so that they have a
-  // chance to know new indexes before receiving selection signals.
-  endRemoveRows();
-  emit pattern_deleted(index, pattern_id);
+  // Add the patterns to the tileset file.
+  for (auto it = frames.constBegin(); it != frames.constEnd(); ++it) {
+    TilePatternData pattern(Rectangle::to_solarus_rect(it.value()));
+    tileset.add_pattern(it.key().toStdString(), pattern);
+  }
 
-  // Restore the selection.
-  Q_FOREACH (const QString& selected_pattern_id, old_selection_ids) {
+  rebuild_pattern_models();
+  endResetModel();
 
-    if (selected_pattern_id == pattern_id) {
-      // Exclude the deleted one.
-      continue;
-    }
+  set_selected_ids(old_selection_ids);
 
-    int new_index = id_to_index(selected_pattern_id);
-    add_to_selected(new_index);
+  QList<int> indexes;
+  Q_FOREACH (const QString& pattern_id, frames.keys()) {
+    indexes << id_to_index(pattern_id);
   }
+  return indexes;
 }
 
 /**
- * @brief Deletes some tile patterns.
+ * @brief Finds areas of the tileset image that could become new patterns.
  *
- * The index of multiple patterns in the pattern list may change, since
- * patterns are sorted alphabetically.
- * For each pattern, emits rowsAboutToBeRemoved(), removes the pattern,
- * emits rowsRemoved() as required by QAbstractItemModel,
- * and then, emits pattern_deleted().
+ * The image is cut into cells of the given size.
+ * Cells where all pixels are fully transparent, cells that overlap
+ * an existing pattern and incomplete cells at the right and bottom edges
+ * of the image are ignored.
  *
- * Except for the deleted patterns, the existing selection is preserved,
- * though the index of many patterns can change.
- * The selection is cleared before the operations and restored after,
+ * @param cell_size Size of a cell of the grid.
+ * @param merge_connected @c true to group adjacent non-empty cells into
+ * larger areas instead of returning one area per cell.
+ * Each group is split into rectangles that only contain cells of the group.
+ * @return The areas found, from top to bottom and left to right.
+ */
+QList<QRect> TilesetModel::find_unused_image_areas(
+    const QSize& cell_size, bool merge_connected) const {
+
+  QList<QRect> areas;
+  if (patterns_image.isNull() || cell_size.isEmpty()) {
+    return areas;
+  }
+
+  const QImage image = patterns_image.convertToFormat(QImage::Format_ARGB32);
+  const int num_columns = image.width() / cell_size.width();
+  const int num_rows = image.height() / cell_size.height();
+  if (num_columns == 0 || num_rows == 0) {
+    return areas;
+  }
+  const auto cell_index = [num_columns](int column, int row) {
+    return row * num_columns + column;
+  };
+
+  // Find non-empty cells. The alpha channel of two pixels is tested at once.
+  constexpr quint64 alpha_mask = 0xFF000000FF000000ULL;
+  std::vector<bool> non_empty(num_columns * num_rows, false);
+  for (int y = 0; y < num_rows * cell_size.height(); ++y) {
+    const uchar* line = image.constScanLine(y);
+    const int row = y / cell_size.height();
+    for (int column = 0; column < num_columns; ++column) {
+      if (non_empty[cell_index(column, row)]) {
+        continue;
+      }
+      const int x_start = column * cell_size.width();
+      const int x_end = x_start + cell_size.width();
+      int x = x_start;
+      quint64 alpha = 0;
+      for (; x + 2 <= x_end; x += 2) {
+        quint64 pixels;
+        memcpy(&pixels, line + x * 4, 8);
+        alpha |= pixels & alpha_mask;
+      }
+      if (x < x_end) {
+        quint32 pixel;
+        memcpy(&pixel, line + x * 4, 4);
+        alpha |= pixel & 0xFF000000U;
+      }
+      if (alpha != 0) {
+        non_empty[cell_index(column, row)] = true;
+      }
+    }
+  }
+
+  // Ignore cells already covered by patterns.
+  for (int i = 0; i < patterns.size(); ++i) {
+    Q_FOREACH (const QRect& frame, get_pattern_frames(i)) {
+      const QRect& cells = QRect(
+            frame.left() / cell_size.width(),
+            frame.top() / cell_size.height(),
+            1, 1).united(QRect(
+            frame.right() / cell_size.width(),
+            frame.bottom() / cell_size.height(),
+            1, 1)).intersected(QRect(0, 0, num_columns, num_rows));
+      for (int row = cells.top(); row <= cells.bottom(); ++row) {
+        for (int column = cells.left(); column <= cells.right(); ++column) {
+          non_empty[cell_index(column, row)] = false;
+        }
+      }
+    }
+  }
+
+  const auto cells_to_rect = [&](const QRect& cells) {
+    return QRect(cells.x() * cell_size.width(),
+                 cells.y() * cell_size.height(),
+                 cells.width() * cell_size.width(),
+                 cells.height() * cell_size.height());
+  };
+
+  if (!merge_connected) {
+    for (int row = 0; row < num_rows; ++row) {
+      for (int column = 0; column < num_columns; ++column) {
+        if (non_empty[cell_index(column, row)]) {
+          areas << cells_to_rect(QRect(column, row, 1, 1));
+        }
+      }
+    }
+    return areas;
+  }
+
+  // Label groups of adjacent non-empty cells with a flood fill.
+  std::vector<int> groups(num_columns * num_rows, -1);
+  int num_groups = 0;
+  for (int row = 0; row < num_rows; ++row) {
+    for (int column = 0; column < num_columns; ++column) {
+      if (!non_empty[cell_index(column, row)] ||
+          groups[cell_index(column, row)] != -1) {
+        continue;
+      }
+
+      const int group = num_groups++;
+      groups[cell_index(column, row)] = group;
+      QList<QPoint> to_visit;
+      to_visit << QPoint(column, row);
+      while (!to_visit.isEmpty()) {
+        const QPoint cell = to_visit.takeLast();
+        const QPoint neighbors[] = {
+          cell + QPoint(1, 0), cell + QPoint(-1, 0),
+          cell + QPoint(0, 1), cell + QPoint(0, -1)
+        };
+        for (const QPoint& neighbor : neighbors) {
+          if (neighbor.x() >= 0 && neighbor.x() < num_columns &&
+              neighbor.y() >= 0 && neighbor.y() < num_rows &&
+              non_empty[cell_index(neighbor.x(), neighbor.y())] &&
+              groups[cell_index(neighbor.x(), neighbor.y())] == -1) {
+            groups[cell_index(neighbor.x(), neighbor.y())] = group;
+            to_visit << neighbor;
+          }
+        }
+      }
+    }
+  }
+
+  // Split each group into rectangles made only of its own cells:
+  // take the widest run of cells on a row, then extend it downwards
+  // as long as the same run belongs to the group.
+  std::vector<bool> assigned(num_columns * num_rows, false);
+  for (int row = 0; row < num_rows; ++row) {
+    for (int column = 0; column < num_columns; ++column) {
+      const int group = groups[cell_index(column, row)];
+      if (group == -1 || assigned[cell_index(column, row)]) {
+        continue;
+      }
+
+      int width = 1;
+      while (column + width < num_columns &&
+             groups[cell_index(column + width, row)] == group &&
+             !assigned[cell_index(column + width, row)]) {
+        ++width;
+      }
+
+      int height = 1;
+      bool can_extend = true;
+      while (can_extend && row + height < num_rows) {
+        for (int i = 0; i < width; ++i) {
+          const int index = cell_index(column + i, row + height);
+          if (groups[index] != group || assigned[index]) {
+            can_extend = false;
+            break;
+          }
+        }
+        if (can_extend) {
+          ++height;
+        }
+      }
+
+      for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+          assigned[cell_index(column + i, row + j)] = true;
+        }
+      }
+      areas << cells_to_rect(QRect(column, row, width, height));
+    }
+  }
+
+  return areas;
+}
+
+/**
+ * @brief Deletes a tile pattern.
+ *
+ * The index of multiple patterns in the pattern list may change, since
+ * patterns are sorted alphabetically.
+ * Emits rowsAboutToBeRemoved(), removes the pattern
+ * and then emits rowsRemoved(), as required by QAbstractItemModel.
+ *
+ * Then, emits pattern_deleted().
+ *
+ * Except for the deleted pattern, the existing selection is preserved,
+ * though the index of many patterns can change.
+ * The selection is cleared before the operations and restored after,
  * updated with the new indexes.
  *
+ * If you have multiple patterns to delete, call delete_patterns()
+ * for better performance.
+ *
+ * @param index Index of the pattern to delete.
+ * @throws EditorException in case of error.
+ */
+void TilesetModel::delete_pattern(int index) {
+
+  QString pattern_id = index_to_id(index);
+
+  // Make some checks first.
+  if (pattern_id.isEmpty()) {
+      throw EditorException(tr("Invalid tile pattern index: %1").arg(index));
+  }
+
+  // Save and clear the selection since a lot of indexes may change.
+  QStringList old_selection_ids = get_selected_ids();
+  clear_selection();
+
+  // Delete the pattern in the tileset file.
+  tileset.remove_pattern(pattern_id.toStdString());
+
+  // Rebuild indexes in the list model (indexes were shifted).
+  build_index_map();
+
+  // Call beginRemoveRows() as requested by QAbstractItemModel.
+  beginRemoveRows(QModelIndex(), index, index);
+
+  // Update our pattern model list.
+  patterns.removeAt(index);
+
+  // Notify people before restoring the selection, so that they have a
+  // chance to know new indexes before receiving selection signals.
+  endRemoveRows();
+  emit pattern_deleted(index, pattern_id);
+
+  // Restore the selection (the deleted one no longer exists).
+  set_selected_ids(old_selection_ids);
+}
+
+/**
+ * @brief Deletes some tile patterns.
+ *
+ * This is much faster than calling delete_pattern() for each pattern:
+ * the index is rebuilt only once and views are reset instead of being
+ * notified of each removal.
+ * Emits modelAboutToBeReset() and modelReset().
+ *
+ * Except for the deleted patterns, the existing selection is preserved,
+ * though the index of many patterns can change.
+ *
  * @param indexes Indexes of the patterns to delete.
  * @throws EditorException in case of error.
+ * In this case, nothing is deleted.
  */
 void TilesetModel::delete_patterns(const QList<int>& indexes) {
 
-  QStringList ids_to_delete;
+  QSet<QString> ids_to_delete;
   Q_FOREACH (int index, indexes) {
     QString pattern_id = index_to_id(index);
     if (pattern_id.isEmpty()) {
         throw EditorException(tr("Invalid tile pattern index: %1").arg(index));
     }
-    ids_to_delete << index_to_id(index);
+    ids_to_delete << pattern_id;
   }
 
-  // Save and clear the selection during the whole operation.
-  QModelIndexList old_selected_indexes = selection_model.selection().indexes();
-  QStringList old_selection_ids;
-  Q_FOREACH (const QModelIndex& old_selected_index, old_selected_indexes) {
-    old_selection_ids << index_to_id(old_selected_index.row());
+  if (ids_to_delete.isEmpty()) {
+    return;
   }
-  clear_selection();
 
-  // Delete patterns.
-  Q_FOREACH (const QString id, ids_to_delete) {
-    int index = id_to_index(id);
-    if (index == -1) {
-      throw EditorException(tr("No such tile pattern: %1").arg(id));
+  // Save the selection: resetting the model clears it.
+  QStringList old_selection_ids = get_selected_ids();
+
+  beginResetModel();
+
+  // Delete patterns in the tileset file.
+  Q_FOREACH (const QString& pattern_id, ids_to_delete) {
+    tileset.remove_pattern(pattern_id.toStdString());
+  }
+
+  rebuild_pattern_models();
+  endResetModel();
+
+  // Restore the selection without deleted patterns.
+  QStringList new_selection_ids;
+  Q_FOREACH (const QString& pattern_id, old_selection_ids) {
+    if (!ids_to_delete.contains(pattern_id)) {
+      new_selection_ids << pattern_id;
     }
-    delete_pattern(index);
   }
+  set_selected_ids(new_selection_ids);
+}
 
-  // Restore the selection.
-  Q_FOREACH (QString selected_pattern_id, old_selection_ids) {
+/**
+ * @brief Changes the string id of several patterns.
+ *
+ * This is much faster than calling set_pattern_id() for each pattern:
+ * the index is rebuilt only once and views are reset instead of being
+ * notified of each move.
+ * Ids can be swapped or permuted: a new id may be the old id of another
+ * pattern renamed at the same time.
+ * Emits modelAboutToBeReset() and modelReset().
+ *
+ * The selection is preserved, though the index of many patterns can change.
+ *
+ * @param new_ids New id of each pattern to rename, indexed by old id.
+ * @throws EditorException in case of error.
+ * In this case, no pattern is renamed.
+ */
+void TilesetModel::set_pattern_ids(const QMap<QString, QString>& new_ids) {
 
-    int new_index = id_to_index(selected_pattern_id);
-    if (new_index == -1) {
-      // This one was just deleted.
-      continue;
+  // Make some checks first.
+  QSet<QString> ids_after;
+  for (auto it = new_ids.constBegin(); it != new_ids.constEnd(); ++it) {
+    const QString& old_id = it.key();
+    const QString& new_id = it.value();
+    if (id_to_index(old_id) == -1) {
+      throw EditorException(tr("No such tile pattern: %1").arg(old_id));
+    }
+    if (!is_valid_pattern_id(new_id)) {
+      throw EditorException(tr("Invalid tile pattern id: '%1'").arg(new_id));
+    }
+    if (ids_after.contains(new_id) ||
+        (id_to_index(new_id) != -1 && !new_ids.contains(new_id))) {
+      throw EditorException(tr("Tile pattern '%1' already exists").arg(new_id));
     }
-    add_to_selected(new_index);
+    ids_after << new_id;
   }
+
+  if (new_ids.isEmpty()) {
+    return;
+  }
+
+  QStringList selection_ids = get_selected_ids();
+
+  beginResetModel();
+
+  // Remove all renamed patterns first so that ids can be swapped.
+  QList<TilePatternData> pattern_data;
+  Q_FOREACH (const QString& old_id, new_ids.keys()) {
+    pattern_data << tileset.get_pattern(old_id.toStdString());
+    tileset.remove_pattern(old_id.toStdString());
+  }
+  int i = 0;
+  Q_FOREACH (const QString& new_id, new_ids.values()) {
+    tileset.add_pattern(new_id.toStdString(), pattern_data[i]);
+    ++i;
+  }
+
+  rebuild_pattern_models();
+  endResetModel();
+
+  for (QString& pattern_id : selection_ids) {
+    pattern_id = new_ids.value(pattern_id, pattern_id);
+  }
+  set_selected_ids(selection_ids);
 }
 
 /**
@@ -467,11 +1290,7 @@ int TilesetModel::set_pattern_id(int index, const QString& new_id) {
   }
 
   // Save and clear the selection since a lot of indexes may change.
-  QModelIndexList old_selected_indexes = selection_model.selection().indexes();
-  QStringList old_selection_ids;
-  Q_FOREACH (const QModelIndex& old_selected_index, old_selected_indexes) {
-    old_selection_ids << index_to_id(old_selected_index.row());
-  }
+  QStringList old_selection_ids = get_selected_ids();
   clear_selection();
 
   // Change the id in the tileset file.
@@ -505,13 +1324,11 @@ int TilesetModel::set_pattern_id(int index, const QString& new_id) {
   emit pattern_id_changed(index, old_id, new_index, new_id);
 
   // Restore the selection.
-  Q_FOREACH (QString pattern_id, old_selection_ids) {
-    if (pattern_id == old_id) {
-      pattern_id = new_id;
-    }
-    int new_index = id_to_index(pattern_id);
-    add_to_selected(new_index);
+  const int renamed_position = old_selection_ids.indexOf(old_id);
+  if (renamed_position != -1) {
+    old_selection_ids[renamed_position] = new_id;
   }
+  set_selected_ids(old_selection_ids);
 
   return new_index;
 }
@@ -1236,24 +2053,321 @@ QPixmap TilesetModel::get_pattern_icon(int index) const {
   }
 
   // Lazily create the icon.
-  QImage image = pixmap.toImage();
-  // Make sure we have an alpha channel.
-  image = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+  QImage image = make_icon_image(pixmap.toImage());
 
-  if (image.height() <= 16) {
-    image = image.scaledToHeight(image.height() * 2);
+  pattern.icon = QPixmap::fromImage(image);
+  return pattern.icon;
+}
+
+/**
+ * @brief Asks icons of some patterns to be built in the background.
+ *
+ * Icons of neighbor patterns are also built in advance.
+ * dataChanged() is emitted when icons are ready.
+ *
+ * @param first_index Index of the first pattern needed.
+ * @param last_index Index of the last pattern needed.
+ */
+void TilesetModel::request_pattern_icons(int first_index, int last_index) const {
+
+  if (patterns_image.isNull()) {
+    return;
   }
-  else if (image.height() > 32) {
-    image = image.scaledToHeight(32);
+
+  first_index = qMax(0, first_index - icon_prefetch_count);
+  last_index = qMin(patterns.size() - 1, last_index + icon_prefetch_count);
+  for (int i = first_index; i <= last_index; ++i) {
+    queue_pattern_icon(i);
   }
+}
 
-  // Center the pattern in a 32x32 pixmap.
-  int dx = (32 - image.width()) / 2;
-  int dy = (32 - image.height()) / 2;
-  image = image.copy(-dx, -dy, 32, 32);
+/**
+ * @brief Adds a pattern to the icons to build if needed.
+ * @param index Index of a pattern.
+ */
+void TilesetModel::queue_pattern_icon(int index) const {
 
-  pattern.icon = QPixmap::fromImage(image);
-  return pattern.icon;
+  const PatternModel& pattern = patterns.at(index);
+  if (!pattern.icon.isNull() || icons_to_load.contains(pattern.id)) {
+    return;
+  }
+
+  icons_to_load.insert(pattern.id);
+  if (!icon_request_timer.isActive()) {
+    icon_request_timer.start();
+  }
+}
+
+/**
+ * @brief Starts building the icons requested in worker threads.
+ */
+void TilesetModel::start_loading_icons() {
+
+  if (icons_to_load.isEmpty() || icon_watcher.isRunning()) {
+    // icons_loading_finished() will call us again.
+    return;
+  }
+
+  QList<IconResult> requests;
+  Q_FOREACH (const QString& pattern_id, icons_to_load) {
+    const int index = id_to_index(pattern_id);
+    if (index == -1 || !patterns.at(index).icon.isNull()) {
+      continue;
+    }
+
+    const QRect& frame = get_pattern_frame(index);
+    const QImage& cached_icon = get_cached_icon(frame);
+    if (!cached_icon.isNull()) {
+      patterns[index].icon = QPixmap::fromImage(cached_icon);
+      continue;
+    }
+
+    IconResult request;
+    request.pattern_id = pattern_id;
+    request.frame = frame;
+    request.image_generation = image_generation;
+    request.patterns_image = patterns_image;
+    requests << request;
+  }
+  icons_to_load.clear();
+
+  if (!requests.isEmpty()) {
+    icon_watcher.setFuture(QtConcurrent::mapped(requests, build_icon_in_worker));
+  }
+}
+
+/**
+ * @brief Builds the icon of a pattern.
+ *
+ * Called from worker threads.
+ *
+ * @param request The pattern and the image to use.
+ * @return The same information with the icon built.
+ */
+TilesetModel::IconResult TilesetModel::build_icon_in_worker(const IconResult& request) {
+
+  IconResult result = request;
+  result.icon = make_icon_image(request.patterns_image.copy(request.frame));
+  result.patterns_image = QImage();
+  return result;
+}
+
+/**
+ * @brief Slot called when an icon was built in a worker thread.
+ * @param result_index Index of the result in the icon watcher.
+ */
+void TilesetModel::icon_loaded(int result_index) {
+
+  const IconResult& result = icon_watcher.resultAt(result_index);
+  if (result.image_generation != image_generation) {
+    // The patterns image has changed in the meantime.
+    return;
+  }
+
+  if (!icon_cache_loaded) {
+    load_icon_cache();
+  }
+  cached_icons.insert(get_icon_key(result.frame), result.icon);
+  icon_cache_dirty = true;
+
+  const int index = id_to_index(result.pattern_id);
+  if (index == -1 || get_pattern_frame(index) != result.frame) {
+    // The pattern has changed in the meantime.
+    return;
+  }
+
+  patterns[index].icon = QPixmap::fromImage(result.icon);
+
+  first_icon_changed = first_icon_changed == -1 ? index : qMin(first_icon_changed, index);
+  last_icon_changed = qMax(last_icon_changed, index);
+  if (!icons_changed_timer.isActive()) {
+    icons_changed_timer.start();
+  }
+}
+
+/**
+ * @brief Slot called when a batch of icons was built.
+ *
+ * Starts the next batch if more icons were requested in the meantime.
+ */
+void TilesetModel::icons_loading_finished() {
+
+  if (!icons_to_load.isEmpty()) {
+    start_loading_icons();
+  }
+}
+
+/**
+ * @brief Notifies views of all icons built since the last notification.
+ */
+void TilesetModel::emit_icons_changed() {
+
+  if (first_icon_changed == -1) {
+    return;
+  }
+
+  const int first = first_icon_changed;
+  const int last = qMin(last_icon_changed, patterns.size() - 1);
+  first_icon_changed = -1;
+  last_icon_changed = -1;
+  if (first <= last) {
+    emit dataChanged(index(first), index(last));
+  }
+}
+
+/**
+ * @brief Returns the file where icons of the tileset are persisted.
+ * @return The icon cache file, or an empty string if there is no cache.
+ */
+QString TilesetModel::get_icon_cache_file_path() const {
+
+  const QString& cache_path = quest.get_cache_path();
+  if (cache_path.isEmpty()) {
+    return QString();
+  }
+  return cache_path + "/tileset_icons/" + tileset_id + ".dat";
+}
+
+/**
+ * @brief Returns the persisted icon of a pattern frame.
+ *
+ * The icon cache file is read the first time an icon is needed,
+ * so that models never showing icons, like the ones of maps, don't read it.
+ *
+ * @param frame A frame in the patterns image.
+ * @return The icon, or a null image if it is not in the cache.
+ */
+QImage TilesetModel::get_cached_icon(const QRect& frame) const {
+
+  if (!icon_cache_loaded) {
+    load_icon_cache();
+  }
+  return cached_icons.value(get_icon_key(frame));
+}
+
+/**
+ * @brief Loads the icons previously persisted for the current patterns
+ * image if any.
+ *
+ * Like QuestImageCache, the cache is identified by the path, the date and
+ * the size of the image file, so icons stay valid as long as the file does
+ * not change. There is one cache file per tileset:
+ * it is removed as soon as it no longer matches the image file.
+ * Images modified in the editor and not saved yet are not persisted.
+ */
+void TilesetModel::load_icon_cache() const {
+
+  icon_cache_loaded = true;
+  cached_icons.clear();
+  icon_cache_dirty = false;
+  icon_cache_key.clear();
+
+  if (patterns_image.isNull() || patterns_image_modified) {
+    return;
+  }
+
+  const QFileInfo image_file_info(quest.get_tileset_tiles_image_path(tileset_id));
+  if (!image_file_info.exists()) {
+    return;
+  }
+  icon_cache_key = image_file_info.canonicalFilePath() + '\n' +
+      QString::number(image_file_info.lastModified().toMSecsSinceEpoch()) + '\n' +
+      QString::number(image_file_info.size());
+
+  QFile file(get_icon_cache_file_path());
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_2);
+  quint32 magic = 0, version = 0;
+  QString key;
+  in >> magic >> version;
+  if (magic == icon_cache_magic && version == icon_cache_version) {
+    in >> key;
+  }
+  if (key != icon_cache_key) {
+    // Icons of an older image or format.
+    file.close();
+    file.remove();
+    return;
+  }
+
+  QHash<QString, QImage> icons;
+  in >> icons;
+  if (in.status() != QDataStream::Ok) {
+    return;
+  }
+  cached_icons = icons;
+}
+
+/**
+ * @brief Writes the icons of the current patterns image to the cache
+ * directory if new icons were built.
+ */
+void TilesetModel::save_icon_cache() {
+
+  if (!icon_cache_dirty) {
+    return;
+  }
+
+  const QString& file_name = get_icon_cache_file_path();
+  if (file_name.isEmpty() || icon_cache_key.isEmpty()) {
+    return;
+  }
+
+  QDir().mkpath(QFileInfo(file_name).path());
+  QSaveFile file(file_name);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_5_2);
+  out << icon_cache_magic << icon_cache_version << icon_cache_key << cached_icons;
+  if (file.commit()) {
+    icon_cache_dirty = false;
+  }
+}
+
+/**
+ * @brief Returns whether a pattern has no transparent pixel.
+ *
+ * The result is cached until the pattern image changes.
+ *
+ * @param index Index of a tile pattern.
+ * @return @c true if all pixels of all frames are fully opaque.
+ */
+bool TilesetModel::is_pattern_opaque(int index) const {
+
+  if (!pattern_exists(index) || patterns_image.isNull()) {
+    return false;
+  }
+
+  const PatternModel& pattern = patterns.at(index);
+  if (pattern.opacity_known) {
+    return pattern.opaque;
+  }
+
+  const QRect& box = get_pattern_frames_bounding_box(index);
+  bool opaque = patterns_image.rect().contains(box);
+  if (opaque && patterns_image.hasAlphaChannel()) {
+    const QImage& image = patterns_image.copy(box).convertToFormat(QImage::Format_ARGB32);
+    for (int y = 0; y < image.height() && opaque; ++y) {
+      const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+      for (int x = 0; x < image.width(); ++x) {
+        if (qAlpha(line[x]) != 255) {
+          opaque = false;
+          break;
+        }
+      }
+    }
+  }
+
+  pattern.opaque = opaque;
+  pattern.opacity_known = true;
+  return opaque;
 }
 
 /**
@@ -1265,6 +2379,417 @@ QImage TilesetModel::get_patterns_image() const {
   return patterns_image;
 }
 
+/**
+ * @brief Replaces the PNG image of all tile patterns.
+ *
+ * The new image is written to the tileset image file when the tileset
+ * is saved.
+ * Emits patterns_image_changed().
+ *
+ * @param patterns_image The new patterns image.
+ */
+void TilesetModel::set_patterns_image(const QImage& patterns_image) {
+
+  save_icon_cache();
+  this->patterns_image = patterns_image;
+  patterns_image_modified = true;
+  ++image_generation;
+  load_icon_cache();
+
+  // All icons have changed.
+  Q_FOREACH (const PatternModel& pattern, patterns) {
+    pattern.set_image_dirty();
+  }
+
+  emit patterns_image_changed();
+
+  if (!patterns.isEmpty()) {
+    emit dataChanged(index(0), index(patterns.size() - 1));
+  }
+}
+
+/**
+ * @brief Reloads the patterns image from the tileset image file.
+ *
+ * Only the parts of the image that have changed are invalidated:
+ * cached images and icons of other patterns are kept.
+ * Emits patterns_image_region_changed() with the area that has changed,
+ * or patterns_image_changed() if the size of the image has changed.
+ * Nothing is done if the patterns image was modified in the editor
+ * and not saved yet.
+ *
+ * @return @c true if the image has changed.
+ */
+bool TilesetModel::reload_patterns_image() {
+
+  if (patterns_image_modified) {
+    // The version of the editor will overwrite the file when saving.
+    return false;
+  }
+
+  // The file may have been replaced since it was last watched.
+  watch_patterns_image_file();
+
+  const QString& image_path = quest.get_tileset_tiles_image_path(tileset_id);
+  quest.get_image_cache().invalidate(image_path);
+  const QImage new_image = quest.get_image_cache().get_image(image_path);
+  if (new_image.isNull()) {
+    // The file is missing or still being written.
+    return false;
+  }
+
+  if (patterns_image.isNull() || new_image.size() != patterns_image.size()) {
+    set_patterns_image(new_image);
+    patterns_image_modified = false;
+    icon_cache_loaded = false;
+    return true;
+  }
+
+  const QRegion& changed_region = get_changed_blocks(patterns_image, new_image);
+  if (changed_region.isEmpty()) {
+    return false;
+  }
+
+  const QHash<QString, QImage> old_icons = cached_icons;
+  const bool icons_being_built = icon_watcher.isRunning();
+  patterns_image = new_image;
+  ++image_generation;
+
+  // If no icon was needed yet, the cache will be read when one is.
+  if (icon_cache_loaded) {
+    load_icon_cache();
+    if (cached_icons.isEmpty()) {
+      // Icons of unchanged patterns are still valid.
+      for (auto it = old_icons.constBegin(); it != old_icons.constEnd(); ++it) {
+        if (!changed_region.intersects(get_icon_frame(it.key()))) {
+          cached_icons.insert(it.key(), it.value());
+        }
+      }
+      icon_cache_dirty = !cached_icons.isEmpty();
+    }
+  }
+
+  int first_changed = -1;
+  int last_changed = -1;
+  for (int i = 0; i < patterns.size(); ++i) {
+    if (changed_region.intersects(get_pattern_frames_bounding_box(i))) {
+      patterns[i].set_image_dirty();
+      if (first_changed == -1) {
+        first_changed = i;
+      }
+      last_changed = i;
+    }
+  }
+
+  if (icons_being_built && !patterns.isEmpty()) {
+    // Icons being built are now ignored: let views ask them again.
+    first_changed = 0;
+    last_changed = patterns.size() - 1;
+  }
+
+  emit patterns_image_region_changed(changed_region);
+
+  if (first_changed != -1) {
+    emit dataChanged(index(first_changed), index(last_changed));
+  }
+  return true;
+}
+
+/**
+ * @brief Slot called when the tileset image file is modified on disk.
+ * @param path Path of the file.
+ */
+void TilesetModel::patterns_image_file_changed(const QString& path) {
+
+  Q_UNUSED(path);
+
+  // Some image editors replace the file instead of writing it,
+  // which removes it from the watcher.
+  watch_patterns_image_file();
+  image_reload_timer.start();
+}
+
+/**
+ * @brief Slot called when a file of the tileset image directory is added,
+ * removed or renamed.
+ *
+ * Reloads the image if its file was missing or replaced and exists now.
+ */
+void TilesetModel::patterns_image_directory_changed() {
+
+  if (watch_patterns_image_file()) {
+    image_reload_timer.start();
+  }
+}
+
+/**
+ * @brief Watches the tileset image file if it exists and is not watched yet.
+ * @return @c true if the file was not watched before.
+ */
+bool TilesetModel::watch_patterns_image_file() {
+
+  const QString& image_path = quest.get_tileset_tiles_image_path(tileset_id);
+  if (image_file_watcher.files().contains(image_path) ||
+      !QFileInfo(image_path).exists()) {
+    return false;
+  }
+  return image_file_watcher.addPath(image_path);
+}
+
+/**
+ * @brief Returns whether the patterns image was changed since the tileset
+ * was last saved.
+ * @return @c true if the patterns image needs to be saved.
+ */
+bool TilesetModel::is_patterns_image_modified() const {
+  return patterns_image_modified;
+}
+
+/**
+ * @brief Builds a compact version of the patterns image.
+ *
+ * The area of each pattern (all its frames for multi-frame patterns)
+ * is placed in a new image with a skyline bin-packing algorithm.
+ * Patterns sharing exactly the same area are placed only once.
+ * Pixels that do not belong to any pattern are dropped.
+ * Positions stay multiples of 8 pixels.
+ *
+ * This function does not modify the tileset: call set_patterns_image()
+ * and set_pattern_position() to apply the result.
+ *
+ * @param[out] positions New position of the first frame of each pattern.
+ * @return The packed image, or a null image if there is no patterns image
+ * or no pattern.
+ */
+QImage TilesetModel::build_packed_patterns_image(QList<QPoint>& positions) const {
+
+  positions.clear();
+  if (patterns_image.isNull() || patterns.isEmpty()) {
+    return QImage();
+  }
+
+  constexpr int cell_size = 8;
+
+  // Find the distinct areas to copy.
+  QList<QRect> areas;
+  QList<int> pattern_areas;
+  std::map<std::tuple<int, int, int, int>, int> area_indexes;
+  for (int i = 0; i < patterns.size(); ++i) {
+    QRect area;
+    Q_FOREACH (const QRect& frame, get_pattern_frames(i)) {
+      area = area.united(frame);
+    }
+    const auto key = std::make_tuple(area.x(), area.y(), area.width(), area.height());
+    auto it = area_indexes.find(key);
+    if (it == area_indexes.end()) {
+      it = area_indexes.insert(std::make_pair(key, areas.size())).first;
+      areas << area;
+    }
+    pattern_areas << it->second;
+  }
+
+  // Work in cells of 8x8 pixels, biggest areas first.
+  QList<QSize> cell_sizes;
+  QList<int> order;
+  int total_cells = 0;
+  int min_width = 0;
+  for (int i = 0; i < areas.size(); ++i) {
+    const QSize size(
+          (areas[i].width() + cell_size - 1) / cell_size,
+          (areas[i].height() + cell_size - 1) / cell_size);
+    cell_sizes << size;
+    order << i;
+    total_cells += size.width() * size.height();
+    min_width = qMax(min_width, size.width());
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int lhs, int rhs) {
+    const QSize& lhs_size = cell_sizes[lhs];
+    const QSize& rhs_size = cell_sizes[rhs];
+    if (lhs_size.height() != rhs_size.height()) {
+      return lhs_size.height() > rhs_size.height();
+    }
+    return lhs_size.width() > rhs_size.width();
+  });
+
+  // Try a few bin widths around the square root of the total area
+  // and keep the smallest result.
+  const int square_width = qMax(min_width, int(std::ceil(std::sqrt(double(total_cells)))));
+  const int num_tries = 16;
+  const int step = qMax(1, square_width / num_tries);
+  int best_area = -1;
+  QSize best_size;
+  QList<QPoint> best_cell_positions;
+  for (int width = square_width; width <= square_width * 2; width += step) {
+    SkylinePacker packer(width);
+    QList<QPoint> cell_positions;
+    cell_positions.reserve(areas.size());
+    for (int i = 0; i < areas.size(); ++i) {
+      cell_positions << QPoint();
+    }
+    Q_FOREACH (int i, order) {
+      cell_positions[i] = packer.insert(cell_sizes[i]);
+    }
+
+    const int area = packer.get_width() * packer.get_height();
+    if (best_area == -1 || area < best_area) {
+      best_area = area;
+      best_size = QSize(packer.get_width(), packer.get_height());
+      best_cell_positions = cell_positions;
+    }
+  }
+
+  // Copy each area to its new place.
+  QImage packed_image(best_size * cell_size, QImage::Format_ARGB32_Premultiplied);
+  packed_image.fill(Qt::transparent);
+  QPainter painter(&packed_image);
+  painter.setCompositionMode(QPainter::CompositionMode_Source);
+  QList<QPoint> area_positions;
+  for (int i = 0; i < areas.size(); ++i) {
+    const QPoint position = best_cell_positions[i] * cell_size;
+    painter.drawImage(position, patterns_image, areas[i]);
+    area_positions << position;
+  }
+  painter.end();
+
+  for (int i = 0; i < patterns.size(); ++i) {
+    const QRect& area = areas[pattern_areas[i]];
+    const QPoint& offset = get_pattern_frame(i).topLeft() - area.topLeft();
+    positions << area_positions[pattern_areas[i]] + offset;
+  }
+
+  return packed_image;
+}
+
+/**
+ * @brief Finds patterns that have the same image and the same properties.
+ *
+ * The image of each pattern (with all its frames) is hashed to find
+ * identical images quickly.
+ * With a tolerance, images that differ by at most this value on each color
+ * channel of each pixel from the first pattern of a group are also grouped.
+ * Patterns with a different ground, default layer, repeat mode or animation
+ * are never grouped since replacing one by another would change the game.
+ *
+ * @param tolerance Maximum difference allowed on each color channel
+ * (0 to find only identical images).
+ * @return Groups of at least two pattern indexes, ordered by index.
+ */
+QList<QList<int>> TilesetModel::find_duplicate_patterns(int tolerance) const {
+
+  QList<QList<int>> groups;
+  if (patterns_image.isNull()) {
+    return groups;
+  }
+
+  struct Candidate {
+    int index;
+    QImage image;
+    quint64 hash;
+  };
+
+  // Only patterns with the same properties and size can be duplicates.
+  QMap<QString, QList<Candidate>> candidates_by_key;
+  for (int i = 0; i < patterns.size(); ++i) {
+    const QList<QRect>& frames = get_pattern_frames(i);
+    const QRect& first_frame = frames.first();
+    QRect area;
+    Q_FOREACH (const QRect& frame, frames) {
+      area = area.united(frame);
+    }
+    const QString& key = QString("%1 %2 %3 %4 %5 %6 %7x%8").
+        arg(static_cast<int>(get_pattern_ground(i))).
+        arg(get_pattern_default_layer(i)).
+        arg(static_cast<int>(get_pattern_repeat_mode(i))).
+        arg(static_cast<int>(get_pattern_animation(i))).
+        arg(static_cast<int>(get_pattern_separation(i))).
+        arg(frames.size()).
+        arg(first_frame.width()).arg(first_frame.height());
+
+    Candidate candidate;
+    candidate.index = i;
+    candidate.image = patterns_image.copy(area).convertToFormat(
+          QImage::Format_ARGB32_Premultiplied);
+    candidate.hash = hash_image(candidate.image);
+    candidates_by_key[key] << candidate;
+  }
+
+  for (auto it = candidates_by_key.constBegin(); it != candidates_by_key.constEnd(); ++it) {
+    const QList<Candidate>& candidates = it.value();
+
+    // Group identical images.
+    QList<QList<int>> exact_groups;
+    QList<QImage> leader_images;
+    QMultiHash<quint64, int> groups_by_hash;
+    Q_FOREACH (const Candidate& candidate, candidates) {
+      bool found = false;
+      Q_FOREACH (int group_index, groups_by_hash.values(candidate.hash)) {
+        if (images_match(leader_images[group_index], candidate.image, 0)) {
+          exact_groups[group_index] << candidate.index;
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        groups_by_hash.insert(candidate.hash, exact_groups.size());
+        exact_groups << (QList<int>() << candidate.index);
+        leader_images << candidate.image;
+      }
+    }
+
+    if (tolerance <= 0) {
+      Q_FOREACH (const QList<int>& group, exact_groups) {
+        if (group.size() > 1) {
+          groups << group;
+        }
+      }
+      continue;
+    }
+
+    // Group similar images. Their mean intensities differ by at most
+    // 4 * tolerance, so only neighbors in this order need to be compared.
+    QList<QPair<double, int>> sorted_groups;
+    for (int i = 0; i < exact_groups.size(); ++i) {
+      sorted_groups << qMakePair(get_mean_intensity(leader_images[i]), i);
+    }
+    std::sort(sorted_groups.begin(), sorted_groups.end());
+
+    QList<int> near_leaders;  // Positions in sorted_groups.
+    QList<QList<int>> near_groups;
+    for (int i = 0; i < sorted_groups.size(); ++i) {
+      const double intensity = sorted_groups[i].first;
+      const QImage& image = leader_images[sorted_groups[i].second];
+      bool found = false;
+      for (int j = near_leaders.size() - 1; j >= 0; --j) {
+        const QPair<double, int>& other = sorted_groups[near_leaders[j]];
+        if (intensity - other.first > 4 * tolerance) {
+          break;
+        }
+        if (images_match(leader_images[other.second], image, tolerance)) {
+          near_groups[j] << exact_groups[sorted_groups[i].second];
+          found = true;
+          break;
+        }
+      }
+      if (!found) {
+        near_leaders << i;
+        near_groups << exact_groups[sorted_groups[i].second];
+      }
+    }
+
+    Q_FOREACH (QList<int> group, near_groups) {
+      if (group.size() > 1) {
+        std::sort(group.begin(), group.end());
+        groups << group;
+      }
+    }
+  }
+
+  std::sort(groups.begin(), groups.end(), [](const QList<int>& lhs, const QList<int>& rhs) {
+    return lhs.first() < rhs.first();
+  });
+  return groups;
+}
+
 /**
  * @brief Returns the selection model of the tileset.
  * @return The selection info.
@@ -1279,7 +2804,7 @@ QItemSelectionModel& TilesetModel::get_selection_model() {
  */
 bool TilesetModel::is_selection_empty() const {
 
-  return selection_model.selection().isEmpty();
+  return !selection_model.hasSelection();
 }
 
 /**
@@ -1288,7 +2813,8 @@ bool TilesetModel::is_selection_empty() const {
  */
 int TilesetModel::get_selection_count() const {
 
-  return selection_model.selection().count();
+  build_selection_cache();
+  return num_selected;
 }
 
 /**
@@ -1298,22 +2824,24 @@ int TilesetModel::get_selection_count() const {
  */
 int TilesetModel::get_selected_index() const {
 
-  QModelIndexList selected_indexes = selection_model.selectedIndexes();
-  if (selected_indexes.size() != 1) {
+  if (get_selection_count() != 1) {
     return -1;
   }
-  return selected_indexes.first().row();
+  return get_row_ranges(selection_model.selection()).first().first;
 }
 
 /**
  * @brief Returns all selected pattern indexes.
- * @return The selected pattern indexes.
+ * @return The selected pattern indexes, in increasing order.
  */
 QList<int> TilesetModel::get_selected_indexes() const {
 
   QList<int> result;
-  Q_FOREACH (const QModelIndex& index, selection_model.selectedIndexes()) {
-    result << index.row();
+  typedef QPair<int, int> Range;
+  Q_FOREACH (const Range& range, get_row_ranges(selection_model.selection())) {
+    for (int index = range.first; index <= range.second; ++index) {
+      result << index;
+    }
   }
   return result;
 }
@@ -1333,15 +2861,9 @@ void TilesetModel::set_selected_index(int index) {
  */
 void TilesetModel::set_selected_indexes(const QList<int>& indexes) {
 
-  const QModelIndexList& current_selection = selection_model.selectedIndexes();
+  const QItemSelection& selection = make_selection(indexes);
 
-  QItemSelection selection;
-  Q_FOREACH (int index, indexes) {
-    QModelIndex model_index = this->index(index);
-    selection.select(model_index, model_index);
-  }
-
-  if (selection.indexes() == current_selection) {
+  if (get_row_ranges(selection) == get_row_ranges(selection_model.selection())) {
     // No change.
     return;
   }
@@ -1349,6 +2871,38 @@ void TilesetModel::set_selected_indexes(const QList<int>& indexes) {
   selection_model.select(selection, QItemSelectionModel::ClearAndSelect);
 }
 
+/**
+ * @brief Returns the ids of the selected patterns.
+ * @return The selected pattern ids.
+ */
+QStringList TilesetModel::get_selected_ids() const {
+
+  QStringList pattern_ids;
+  Q_FOREACH (int index, get_selected_indexes()) {
+    pattern_ids << index_to_id(index);
+  }
+  return pattern_ids;
+}
+
+/**
+ * @brief Selects the patterns with the given ids and unselects others.
+ *
+ * Ids that do not exist are ignored.
+ *
+ * @param pattern_ids The pattern ids to select.
+ */
+void TilesetModel::set_selected_ids(const QStringList& pattern_ids) {
+
+  QList<int> indexes;
+  Q_FOREACH (const QString& pattern_id, pattern_ids) {
+    const int index = id_to_index(pattern_id);
+    if (index != -1) {
+      indexes << index;
+    }
+  }
+  set_selected_indexes(indexes);
+}
+
 /**
  * @brief Selects a pattern and lets the rest of the selection unchanged.
  * @param index The index to select.
@@ -1365,13 +2919,7 @@ void TilesetModel::add_to_selected(int index) {
  */
 void TilesetModel::add_to_selected(const QList<int>& indexes) {
 
-  QItemSelection selection;
-  Q_FOREACH (int index, indexes) {
-    QModelIndex model_index = this->index(index);
-    selection.select(model_index, model_index);
-  }
-
-  selection_model.select(selection, QItemSelectionModel::Select);
+  selection_model.select(make_selection(indexes), QItemSelectionModel::Select);
 }
 
 /**
@@ -1381,7 +2929,8 @@ void TilesetModel::add_to_selected(const QList<int>& indexes) {
  */
 bool TilesetModel::is_selected(int index) const {
 
-  return selection_model.isSelected(this->index(index));
+  build_selection_cache();
+  return index >= 0 && index < selected_flags.size() && selected_flags.testBit(index);
 }
 
 /**
@@ -1393,6 +2942,115 @@ void TilesetModel::toggle_selected(int index) {
   selection_model.select(this->index(index), QItemSelectionModel::Toggle);
 }
 
+/**
+ * @brief Builds a selection from pattern indexes.
+ *
+ * Contiguous indexes are grouped in a single range.
+ * Invalid indexes are ignored.
+ *
+ * @param indexes Some pattern indexes, in any order.
+ * @return The corresponding selection.
+ */
+QItemSelection TilesetModel::make_selection(const QList<int>& indexes) const {
+
+  std::vector<int> sorted_indexes(indexes.begin(), indexes.end());
+  std::sort(sorted_indexes.begin(), sorted_indexes.end());
+  sorted_indexes.erase(std::unique(sorted_indexes.begin(), sorted_indexes.end()),
+                       sorted_indexes.end());
+
+  QItemSelection selection;
+  size_t i = 0;
+  while (i < sorted_indexes.size()) {
+    const int first = sorted_indexes[i];
+    int last = first;
+    ++i;
+    while (i < sorted_indexes.size() && sorted_indexes[i] == last + 1) {
+      last = sorted_indexes[i];
+      ++i;
+    }
+    if (first < 0 || last >= patterns.size()) {
+      continue;
+    }
+    selection.append(QItemSelectionRange(index(first), index(last)));
+  }
+  return selection;
+}
+
+/**
+ * @brief Computes which patterns are selected if this is not known yet.
+ */
+void TilesetModel::build_selection_cache() const {
+
+  if (selection_cache_valid) {
+    return;
+  }
+
+  selected_flags = QBitArray(patterns.size());
+  num_selected = 0;
+  typedef QPair<int, int> Range;
+  Q_FOREACH (const Range& range, get_row_ranges(selection_model.selection())) {
+    const int first = qMax(0, range.first);
+    const int last = qMin(patterns.size() - 1, range.second);
+    if (first <= last) {
+      selected_flags.fill(true, first, last + 1);
+      num_selected += last - first + 1;
+    }
+  }
+  selection_cache_valid = true;
+}
+
+/**
+ * @brief Slot called when the selection changes.
+ *
+ * Updates the selected patterns cache with only the rows that changed.
+ *
+ * @param selected Items that have just been selected.
+ * @param deselected Item that have just been deselected.
+ */
+void TilesetModel::update_selection_cache(
+    const QItemSelection& selected, const QItemSelection& deselected) {
+
+  if (!selection_cache_valid) {
+    return;
+  }
+
+  Q_FOREACH (const QItemSelectionRange& range, deselected) {
+    if (range.top() < 0 || range.bottom() >= selected_flags.size()) {
+      invalidate_selection_cache();
+      return;
+    }
+    for (int index = range.top(); index <= range.bottom(); ++index) {
+      if (selected_flags.testBit(index)) {
+        selected_flags.clearBit(index);
+        --num_selected;
+      }
+    }
+  }
+
+  Q_FOREACH (const QItemSelectionRange& range, selected) {
+    if (range.top() < 0 || range.bottom() >= selected_flags.size()) {
+      invalidate_selection_cache();
+      return;
+    }
+    for (int index = range.top(); index <= range.bottom(); ++index) {
+      if (!selected_flags.testBit(index)) {
+        selected_flags.setBit(index);
+        ++num_selected;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Slot called when patterns are added, removed or reordered.
+ *
+ * The selected patterns cache will be rebuilt when needed.
+ */
+void TilesetModel::invalidate_selection_cache() {
+
+  selection_cache_valid = false;
+}
+
 /**
  * @brief Selects all patterns of the tileset.
  */
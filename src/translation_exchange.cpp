@@ -0,0 +1,568 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "editor_exception.h"
+#include "translation_exchange.h"
+#include <QApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QXmlStreamReader>
+
+namespace SolarusEditor {
+
+namespace TranslationExchange {
+
+namespace {
+
+/**
+ * @brief Namespace of XLIFF 1.2 elements.
+ */
+const QString xliff_namespace = "urn:oasis:names:tc:xliff:document:1.2";
+
+/**
+ * @brief Quotes a CSV field if necessary.
+ * @param text The field value.
+ * @return The field as written in a CSV file.
+ */
+QString csv_field(const QString& text) {
+
+  if (!text.contains(QRegExp("[,\"\r\n]")) &&
+      text.trimmed() == text) {
+    return text;
+  }
+
+  QString quoted = text;
+  quoted.replace('"', "\"\"");
+  return '"' + quoted + '"';
+}
+
+/**
+ * @brief Reads the next record of a CSV file.
+ *
+ * Quoted fields may contain separators, double quotes and line breaks.
+ *
+ * @param in The CSV stream.
+ * @return The fields of the record, or an empty list at the end of the file.
+ */
+QStringList read_csv_record(QTextStream& in) {
+
+  QStringList fields;
+  QString field;
+  bool in_quotes = false;
+  while (!in.atEnd()) {
+    const QString& line = in.readLine();
+    for (int i = 0; i < line.size(); ++i) {
+      const QChar c = line[i];
+      if (in_quotes) {
+        if (c != '"') {
+          field += c;
+        }
+        else if (i + 1 < line.size() && line[i + 1] == '"') {
+          field += '"';
+          ++i;
+        }
+        else {
+          in_quotes = false;
+        }
+      }
+      else if (c == '"') {
+        in_quotes = true;
+      }
+      else if (c == ',') {
+        fields << field;
+        field.clear();
+      }
+      else {
+        field += c;
+      }
+    }
+
+    if (!in_quotes) {
+      fields << field;
+      return fields;
+    }
+    // Line break in a quoted field.
+    field += '\n';
+  }
+
+  if (in_quotes) {
+    fields << field;
+  }
+  return fields;
+}
+
+/**
+ * @brief Reads the units of a CSV file.
+ *
+ * The first line is a header if it has a column named "id".
+ * Otherwise, columns are id, source and target.
+ *
+ * @param file The file to read.
+ * @return The units read.
+ */
+QList<Unit> read_csv(QFile& file) {
+
+  QTextStream in(&file);
+  in.setCodec("UTF-8");
+
+  int id_column = 0;
+  int source_column = 1;
+  int target_column = 2;
+
+  QList<Unit> units;
+  bool first_record = true;
+  while (!in.atEnd()) {
+    const QStringList& fields = read_csv_record(in);
+    if (first_record) {
+      first_record = false;
+      QStringList names;
+      for (const QString& field : fields) {
+        names << field.trimmed().toLower();
+      }
+      if (names.contains("id")) {
+        id_column = names.indexOf("id");
+        source_column = names.indexOf("source");
+        target_column = names.indexOf("target");
+        continue;
+      }
+    }
+
+    if (id_column >= fields.size() || fields[id_column].isEmpty()) {
+      continue;
+    }
+    Unit unit;
+    unit.id = fields[id_column];
+    unit.source = fields.value(source_column);
+    unit.target = fields.value(target_column);
+    units << unit;
+  }
+  return units;
+}
+
+/**
+ * @brief Reads the units of a XLIFF file.
+ * @param file The file to read.
+ * @return The units read.
+ * @throws EditorException If the file is not valid XML.
+ */
+QList<Unit> read_xliff(QFile& file) {
+
+  QList<Unit> units;
+  QXmlStreamReader xml(&file);
+  Unit unit;
+  bool in_unit = false;
+  while (!xml.atEnd()) {
+    xml.readNext();
+    if (xml.isStartElement()) {
+      if (xml.name() == "trans-unit") {
+        unit = Unit();
+        unit.id = xml.attributes().value("id").toString();
+        in_unit = true;
+      }
+      else if (in_unit && xml.name() == "source") {
+        unit.source = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+      }
+      else if (in_unit && xml.name() == "target") {
+        unit.target = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+      }
+    }
+    else if (xml.isEndElement() && xml.name() == "trans-unit") {
+      if (!unit.id.isEmpty()) {
+        units << unit;
+      }
+      in_unit = false;
+    }
+  }
+
+  if (xml.hasError()) {
+    throw EditorException(QApplication::tr("Invalid XLIFF file at line %1: %2").
+                          arg(xml.lineNumber()).arg(xml.errorString()));
+  }
+  return units;
+}
+
+/**
+ * @brief Escapes a text as the content of a PO string.
+ * @param text The text.
+ * @return The escaped text, without surrounding quotes.
+ */
+QString po_escape(const QString& text) {
+
+  QString escaped;
+  escaped.reserve(text.size());
+  for (const QChar& c : text) {
+    switch (c.unicode()) {
+
+    case '\\':
+      escaped += "\\\\";
+      break;
+
+    case '"':
+      escaped += "\\\"";
+      break;
+
+    case '\n':
+      escaped += "\\n";
+      break;
+
+    case '\t':
+      escaped += "\\t";
+      break;
+
+    case '\r':
+      break;
+
+    default:
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+/**
+ * @brief Unescapes the content of a quoted PO string.
+ * @param line A line containing a quoted string.
+ * @return The text of the string.
+ */
+QString po_unescape(const QString& line) {
+
+  const int start = line.indexOf('"');
+  const int end = line.lastIndexOf('"');
+  if (start == -1 || end <= start) {
+    return QString();
+  }
+
+  QString text;
+  for (int i = start + 1; i < end; ++i) {
+    QChar c = line[i];
+    if (c == '\\' && i + 1 < end) {
+      ++i;
+      switch (line[i].unicode()) {
+
+      case 'n':
+        c = '\n';
+        break;
+
+      case 't':
+        c = '\t';
+        break;
+
+      default:
+        c = line[i];
+      }
+    }
+    text += c;
+  }
+  return text;
+}
+
+/**
+ * @brief Writes a keyword and its string to a PO file.
+ *
+ * Multiline texts are split after each line break as usual in PO files.
+ *
+ * @param out The PO stream.
+ * @param keyword The keyword, like "msgid".
+ * @param text The text to write.
+ */
+void write_po_string(QTextStream& out, const QString& keyword, const QString& text) {
+
+  const QStringList& lines = text.split('\n');
+  if (lines.size() == 1) {
+    out << keyword << " \"" << po_escape(text) << "\"\n";
+    return;
+  }
+
+  out << keyword << " \"\"\n";
+  for (int i = 0; i < lines.size(); ++i) {
+    const QString& line = (i + 1 < lines.size()) ? lines[i] + '\n' : lines[i];
+    if (!line.isEmpty()) {
+      out << '"' << po_escape(line) << "\"\n";
+    }
+  }
+}
+
+/**
+ * @brief Reads the units of a PO file.
+ *
+ * Only entries with a message context are read, since the context holds
+ * the id. Fuzzy entries are read with an empty target.
+ *
+ * @param file The file to read.
+ * @return The units read.
+ */
+QList<Unit> read_po(QFile& file) {
+
+  QTextStream in(&file);
+  in.setCodec("UTF-8");
+
+  QList<Unit> units;
+  Unit unit;
+  QString* field = nullptr;
+  bool fuzzy = false;
+  bool in_entry = false;
+
+  const auto finish_entry = [&]() {
+    if (in_entry && !unit.id.isEmpty()) {
+      if (fuzzy) {
+        unit.target.clear();
+      }
+      units << unit;
+    }
+    unit = Unit();
+    field = nullptr;
+    fuzzy = false;
+    in_entry = false;
+  };
+
+  while (!in.atEnd()) {
+    const QString& line = in.readLine().trimmed();
+    if (line.isEmpty()) {
+      finish_entry();
+    }
+    else if (line.startsWith('#')) {
+      if (in_entry) {
+        finish_entry();
+      }
+      if (line.startsWith("#,") && line.contains("fuzzy")) {
+        fuzzy = true;
+      }
+    }
+    else if (line.startsWith("msgctxt")) {
+      if (in_entry) {
+        finish_entry();
+      }
+      in_entry = true;
+      field = &unit.id;
+      *field = po_unescape(line);
+    }
+    else if (line.startsWith("msgid_plural")) {
+      field = nullptr;
+    }
+    else if (line.startsWith("msgid")) {
+      if (in_entry && field == &unit.target) {
+        finish_entry();
+      }
+      in_entry = true;
+      field = &unit.source;
+      *field = po_unescape(line);
+    }
+    else if (line.startsWith("msgstr")) {
+      // Only keep the first form of plural entries.
+      if (line.startsWith("msgstr[") && !line.startsWith("msgstr[0]")) {
+        field = nullptr;
+        continue;
+      }
+      in_entry = true;
+      field = &unit.target;
+      *field = po_unescape(line);
+    }
+    else if (line.startsWith('"') && field != nullptr) {
+      *field += po_unescape(line);
+    }
+  }
+  finish_entry();
+
+  return units;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * @brief Returns the format of a file from its extension.
+ * @param path Path of a file.
+ * @return The format. CSV is used for unknown extensions.
+ */
+Format get_format(const QString& path) {
+
+  const QString& suffix = QFileInfo(path).suffix().toLower();
+  if (suffix == "xlf" || suffix == "xliff") {
+    return Format::XLIFF;
+  }
+  if (suffix == "po") {
+    return Format::PO;
+  }
+  return Format::CSV;
+}
+
+/**
+ * @brief Returns the filters of supported formats for file dialogs.
+ * @return The filters.
+ */
+QString get_file_filters() {
+
+  return QApplication::tr("Gettext PO (*.po)") + ";;" +
+      QApplication::tr("XLIFF (*.xlf *.xliff)") + ";;" +
+      QApplication::tr("CSV (*.csv)");
+}
+
+/**
+ * @brief Reads all units of a file.
+ * @param path Path of the file. Its format depends on the extension.
+ * @return The units read.
+ * @throws EditorException If the file cannot be read.
+ */
+QList<Unit> read_file(const QString& path) {
+
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    throw EditorException(QApplication::tr("Cannot open file '%1'").arg(path));
+  }
+
+  switch (get_format(path)) {
+
+  case Format::XLIFF:
+    return read_xliff(file);
+
+  case Format::PO:
+    return read_po(file);
+
+  case Format::CSV:
+    break;
+  }
+  return read_csv(file);
+}
+
+/**
+ * @brief Opens a file and writes its header.
+ * @param path Path of the file to write. Its format depends on the extension.
+ * @param source_language_id Language of the source texts.
+ * @param target_language_id Language of the translated texts.
+ * @param original_file_name Name of the data file the texts come from.
+ * @throws EditorException If the file cannot be open.
+ */
+Writer::Writer(const QString& path,
+               const QString& source_language_id,
+               const QString& target_language_id,
+               const QString& original_file_name) :
+  format(get_format(path)),
+  file(path),
+  stream(),
+  xml(),
+  num_units(0) {
+
+  if (!file.open(QIODevice::WriteOnly)) {
+    throw EditorException(QApplication::tr("Cannot open file '%1'").arg(path));
+  }
+
+  switch (format) {
+
+  case Format::CSV:
+    stream.setDevice(&file);
+    stream.setCodec("UTF-8");
+    stream.setGenerateByteOrderMark(true);
+    stream << "id,source,target\r\n";
+    break;
+
+  case Format::PO:
+    stream.setDevice(&file);
+    stream.setCodec("UTF-8");
+    stream << "# " << original_file_name << '\n';
+    stream << "msgid \"\"\n";
+    stream << "msgstr \"\"\n";
+    stream << "\"MIME-Version: 1.0\\n\"\n";
+    stream << "\"Content-Type: text/plain; charset=UTF-8\\n\"\n";
+    stream << "\"Content-Transfer-Encoding: 8bit\\n\"\n";
+    stream << "\"Language: " << po_escape(target_language_id) << "\\n\"\n";
+    stream << "\"X-Source-Language: " << po_escape(source_language_id) << "\\n\"\n";
+    break;
+
+  case Format::XLIFF:
+    xml.setDevice(&file);
+    xml.setAutoFormatting(true);
+    xml.writeStartDocument();
+    xml.writeStartElement("xliff");
+    xml.writeDefaultNamespace(xliff_namespace);
+    xml.writeAttribute("version", "1.2");
+    xml.writeStartElement("file");
+    xml.writeAttribute("original", original_file_name);
+    xml.writeAttribute("source-language", source_language_id);
+    xml.writeAttribute("target-language", target_language_id);
+    xml.writeAttribute("datatype", "plaintext");
+    xml.writeStartElement("body");
+    break;
+  }
+}
+
+/**
+ * @brief Writes a unit to the file.
+ * @param unit The unit to write.
+ */
+void Writer::write_unit(const Unit& unit) {
+
+  switch (format) {
+
+  case Format::CSV:
+    stream << csv_field(unit.id) << ','
+           << csv_field(unit.source) << ','
+           << csv_field(unit.target) << "\r\n";
+    break;
+
+  case Format::PO:
+    stream << '\n';
+    write_po_string(stream, "msgctxt", unit.id);
+    write_po_string(stream, "msgid", unit.source);
+    write_po_string(stream, "msgstr", unit.target);
+    break;
+
+  case Format::XLIFF:
+    xml.writeStartElement("trans-unit");
+    xml.writeAttribute("id", unit.id);
+    xml.writeAttribute("xml:space", "preserve");
+    xml.writeTextElement("source", unit.source);
+    xml.writeStartElement("target");
+    if (unit.target.isEmpty()) {
+      xml.writeAttribute("state", "needs-translation");
+    }
+    xml.writeCharacters(unit.target);
+    xml.writeEndElement();
+    xml.writeEndElement();
+    break;
+  }
+  ++num_units;
+}
+
+/**
+ * @brief Finishes the file and replaces the destination file.
+ * @throws EditorException If the file could not be written.
+ */
+void Writer::commit() {
+
+  if (format == Format::XLIFF) {
+    xml.writeEndDocument();
+  }
+  else {
+    stream.flush();
+  }
+
+  if (!file.commit()) {
+    throw EditorException(QApplication::tr("Cannot write file '%1'").
+                          arg(file.fileName()));
+  }
+}
+
+/**
+ * @brief Returns the number of units written so far.
+ * @return The number of units.
+ */
+int Writer::get_num_units() const {
+
+  return num_units;
+}
+
+}
+
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "widgets/auto_slice_dialog.h"
+
+namespace SolarusEditor {
+
+/**
+ * @brief Creates an auto slice dialog.
+ * @param parent Parent object or nullptr.
+ */
+AutoSliceDialog::AutoSliceDialog(QWidget* parent) :
+  QDialog(parent) {
+
+  ui.setupUi(this);
+
+  ui.cell_size_field->config("x", 8, 99999, 8);
+  set_cell_size(QSize(16, 16));
+  set_ground(Ground::TRAVERSABLE);
+  set_merge_connected(false);
+}
+
+/**
+ * @brief Returns the size of the grid cells.
+ * @return The cell size.
+ */
+QSize AutoSliceDialog::get_cell_size() const {
+
+  return ui.cell_size_field->get_size();
+}
+
+/**
+ * @brief Sets the size of the grid cells.
+ * @param cell_size The cell size.
+ */
+void AutoSliceDialog::set_cell_size(const QSize& cell_size) {
+
+  ui.cell_size_field->set_size(cell_size);
+}
+
+/**
+ * @brief Returns the ground of patterns to create.
+ * @return The ground.
+ */
+Ground AutoSliceDialog::get_ground() const {
+
+  return ui.ground_field->get_selected_value();
+}
+
+/**
+ * @brief Sets the ground of patterns to create.
+ * @param ground The ground.
+ */
+void AutoSliceDialog::set_ground(Ground ground) {
+
+  ui.ground_field->set_selected_value(ground);
+}
+
+/**
+ * @brief Returns whether adjacent non-empty cells make a single pattern.
+ * @return @c true if connected cells are merged.
+ */
+bool AutoSliceDialog::get_merge_connected() const {
+
+  return ui.merge_connected_field->isChecked();
+}
+
+/**
+ * @brief Sets whether adjacent non-empty cells make a single pattern.
+ * @param merge_connected @c true to merge connected cells.
+ */
+void AutoSliceDialog::set_merge_connected(bool merge_connected) {
+
+  ui.merge_connected_field->setChecked(merge_connected);
+}
+
+}
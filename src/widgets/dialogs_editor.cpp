@@ -17,9 +17,14 @@
 #include "widgets/gui_tools.h"
 #include "widgets/dialogs_editor.h"
 #include "widgets/change_dialog_id_dialog.h"
+#include "widgets/refactoring_dialog.h"
 #include "editor_exception.h"
 #include "quest.h"
 #include "dialogs_model.h"
+#include "quest_refactoring.h"
+#include "translation_exchange.h"
+#include <QDir>
+#include <QFileDialog>
 #include <QUndoStack>
 #include <QMessageBox>
 #include <QInputDialog>
@@ -435,6 +440,36 @@ private:
   QString new_value;
 };
 
+/**
+ * @brief Import dialog texts from a translation file.
+ */
+class ImportDialogsCommand : public DialogsEditorCommand {
+
+public:
+
+  ImportDialogsCommand(
+      DialogsEditor& editor, const QMap<QString, QString>& texts) :
+    DialogsEditorCommand(editor, DialogsEditor::tr("Import dialogs")),
+    texts(texts),
+    old_texts() {
+  }
+
+  virtual void undo() override {
+
+    get_model().set_dialog_texts(old_texts);
+  }
+
+  virtual void redo() override {
+
+    old_texts = get_model().set_dialog_texts(texts);
+  }
+
+private:
+
+  QMap<QString, QString> texts;
+  QMap<QString, QString> old_texts;
+};
+
 }
 
 /**
@@ -449,12 +484,14 @@ DialogsEditor::DialogsEditor(
   Editor(quest, quest.get_dialogs_path(language_id), parent),
   language_id(language_id),
   model(nullptr),
-  quest(quest) {
+  quest(quest),
+  renamed_ids() {
 
   ui.setupUi(this);
 
   // Open the file.
   model = new DialogsModel(quest, language_id, this);
+  quest.get_text_index().watch_dialogs_model(*model);
   get_undo_stack().setClean();
 
   // Editor properties.
@@ -510,6 +547,10 @@ DialogsEditor::DialogsEditor(
 
   connect(model, SIGNAL(dialog_id_changed(QString,QString)),
           this, SLOT(update_dialog_id_field()));
+  connect(model, SIGNAL(dialog_id_changed(QString,QString)),
+          this, SLOT(dialog_id_changed(QString,QString)));
+  connect(model, SIGNAL(dialog_deleted(QString)),
+          this, SLOT(dialog_deleted(QString)));
 
   connect(model, SIGNAL(dialog_text_changed(QString,QString)),
           this, SLOT(update_dialog_text_field()));
@@ -542,6 +583,18 @@ DialogsEditor::DialogsEditor(
           this, SLOT(translation_selector_activated()));
   connect(ui.translation_refresh_button, SIGNAL(clicked()),
           this, SLOT(translation_refresh_requested()));
+  connect(ui.export_button, SIGNAL(clicked()),
+          this, SLOT(export_requested()));
+  connect(ui.import_button, SIGNAL(clicked()),
+          this, SLOT(import_requested()));
+  connect(model, SIGNAL(translation_changed()),
+          this, SLOT(update_translation()));
+  connect(model, SIGNAL(translation_load_failed(QString)),
+          this, SLOT(translation_load_failed(QString)));
+  connect(model, SIGNAL(translation_changed()),
+          this, SLOT(update_exchange_buttons()));
+  connect(model, SIGNAL(translation_load_failed(QString)),
+          this, SLOT(update_exchange_buttons()));
 
   connect(ui.display_margin_check_box, SIGNAL(clicked()),
           this, SLOT(update_display_margin()));
@@ -578,10 +631,19 @@ void DialogsEditor::set_selected_property(const QString& key) {
 
 /**
  * @copydoc Editor::save
+ *
+ * Then proposes to update references to the dialogs renamed since the
+ * last save.
  */
 void DialogsEditor::save() {
 
   model->save();
+
+  if (!renamed_ids.isEmpty()) {
+    const QMap<QString, QString> new_ids = renamed_ids;
+    renamed_ids.clear();
+    update_dialog_references(new_ids);
+  }
 }
 
 /**
@@ -757,6 +819,64 @@ void DialogsEditor::change_dialog_id_requested() {
   }
 }
 
+/**
+ * @brief Slot called when a dialog id has changed in the model.
+ *
+ * The renaming is remembered until the dialogs file is saved,
+ * so that references can be updated at this time.
+ * Undoing a renaming cancels it.
+ *
+ * @param id Old id of the dialog.
+ * @param new_id New id of the dialog.
+ */
+void DialogsEditor::dialog_id_changed(const QString& id, const QString& new_id) {
+
+  QuestRefactoring::add_renaming(renamed_ids, id, new_id);
+}
+
+/**
+ * @brief Slot called when a dialog is deleted from the model.
+ * @param id Id of the dialog deleted.
+ */
+void DialogsEditor::dialog_deleted(const QString& id) {
+
+  QuestRefactoring::remove_renaming(renamed_ids, id);
+}
+
+/**
+ * @brief Proposes to update references to dialogs that were renamed.
+ *
+ * Called after the dialogs file is saved.
+ * References from maps, scripts and other languages are updated on disk.
+ *
+ * @param new_ids New id of each renamed dialog, indexed by old id.
+ */
+void DialogsEditor::update_dialog_references(const QMap<QString, QString>& new_ids) {
+
+  try {
+    QuestRefactoring refactoring(quest);
+    const QList<QuestRefactoring::Change>& changes =
+        refactoring.plan_dialog_renaming(language_id, new_ids);
+    if (changes.isEmpty()) {
+      return;
+    }
+
+    RefactoringDialog dialog(
+          tr("Other files refer to the dialogs renamed. "
+             "Do you want to update them?\n"
+             "These files are saved immediately."),
+          changes,
+          this);
+    if (dialog.exec() != QDialog::Accepted) {
+      return;
+    }
+    refactoring.apply(dialog.get_selected_changes());
+  }
+  catch (const EditorException& ex) {
+    ex.show_dialog();
+  }
+}
+
 /**
  * @brief Slot called when the user wants to delete a dialog.
  */
@@ -1031,19 +1151,10 @@ void DialogsEditor::translation_selector_activated() {
   }
   else {
     // Set the translation.
-    try {
-      model->set_translation_id(new_language_id);
-      ui.translation_refresh_button->setEnabled(true);
-    }
-    catch (const EditorException& ex) {
-      ui.translation_field->set_selected_id("");
-      ui.translation_refresh_button->setEnabled(false);
-      ex.show_dialog();
-    }
+    model->set_translation_id(new_language_id);
+    ui.translation_refresh_button->setEnabled(true);
   }
-
-  update_translation_text_field();
-  ui.dialog_properties_table->update();
+  update_exchange_buttons();
 }
 
 /**
@@ -1055,11 +1166,172 @@ void DialogsEditor::translation_refresh_requested() {
   }
 
   model->reload_translation();
+  update_exchange_buttons();
+}
+
+/**
+ * @brief Enables or disables exporting and importing.
+ *
+ * They are disabled while the translation is being loaded,
+ * because exports use translated dialogs as source texts.
+ */
+void DialogsEditor::update_exchange_buttons() {
+
+  const bool enable = !model->is_loading_translation();
+  ui.export_button->setEnabled(enable);
+  ui.import_button->setEnabled(enable);
+}
+
+/**
+ * @brief Slot called when the translation language was loaded or cleared.
+ */
+void DialogsEditor::update_translation() {
 
   update_translation_text_field();
   ui.dialog_properties_table->update();
 }
 
+/**
+ * @brief Slot called when the translation language could not be loaded.
+ * @param message The error message.
+ */
+void DialogsEditor::translation_load_failed(const QString& message) {
+
+  ui.translation_field->set_selected_id("");
+  ui.translation_refresh_button->setEnabled(false);
+  EditorException(message).show_dialog();
+}
+
+/**
+ * @brief Slot called when the user wants to export dialogs for translators.
+ *
+ * Only the text of dialogs is exported.
+ * If a language is selected for comparison, its dialogs are exported as
+ * the source texts and the user can choose to only export dialogs that are
+ * not translated yet, that is, missing, empty or identical to the source.
+ */
+void DialogsEditor::export_requested() {
+
+  if (model->is_loading_translation()) {
+    return;
+  }
+
+  const QString& reference_id = model->get_translation_id();
+  bool only_untranslated = false;
+  if (!reference_id.isEmpty()) {
+    QMessageBox::StandardButton answer = QMessageBox::question(
+          this,
+          tr("Export dialogs"),
+          tr("Only export the dialogs of language '%1' that are missing, "
+             "empty or identical in this language?").arg(reference_id),
+          QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+    if (answer == QMessageBox::Cancel) {
+      return;
+    }
+    only_untranslated = (answer == QMessageBox::Yes);
+  }
+
+  const QString& path = QFileDialog::getSaveFileName(
+        this,
+        tr("Export dialogs"),
+        QDir(quest.get_root_path()).filePath(QString("dialogs_%1.po").arg(language_id)),
+        TranslationExchange::get_file_filters());
+  if (path.isEmpty()) {
+    return;
+  }
+
+  try {
+    QStringList ids = model->get_ids("");
+    if (!reference_id.isEmpty()) {
+      ids = model->get_translated_ids("");
+      if (!only_untranslated) {
+        ids << model->get_ids("");
+        ids.removeDuplicates();
+      }
+    }
+    ids.sort();
+
+    TranslationExchange::Writer writer(
+          path,
+          reference_id.isEmpty() ? language_id : reference_id,
+          reference_id.isEmpty() ? QString() : language_id,
+          "dialogs.dat");
+    Q_FOREACH (const QString& id, ids) {
+      TranslationExchange::Unit unit;
+      unit.id = id;
+      if (reference_id.isEmpty()) {
+        unit.source = model->get_dialog_text(id);
+      }
+      else {
+        unit.source = model->get_translated_dialog_text(id);
+        unit.target = model->get_dialog_text(id);
+        if (only_untranslated &&
+            !unit.target.isEmpty() &&
+            unit.target != unit.source) {
+          continue;
+        }
+      }
+      writer.write_unit(unit);
+    }
+    writer.commit();
+    GuiTools::information_dialog(
+          tr("%1 dialog(s) exported").arg(writer.get_num_units()));
+  }
+  catch (const EditorException& ex) {
+    ex.show_dialog();
+  }
+}
+
+/**
+ * @brief Slot called when the user wants to import translated dialogs.
+ *
+ * Dialogs of the file that have a translation are created or changed
+ * in one undoable action.
+ * New dialogs get the properties of the language selected for comparison.
+ */
+void DialogsEditor::import_requested() {
+
+  if (model->is_loading_translation()) {
+    return;
+  }
+
+  const QString& path = QFileDialog::getOpenFileName(
+        this,
+        tr("Import dialogs"),
+        quest.get_root_path(),
+        TranslationExchange::get_file_filters());
+  if (path.isEmpty()) {
+    return;
+  }
+
+  QMap<QString, QString> texts;
+  try {
+    Q_FOREACH (const TranslationExchange::Unit& unit,
+               TranslationExchange::read_file(path)) {
+      if (unit.target.isEmpty() ||
+          !DialogsModel::is_valid_id(unit.id) ||
+          model->get_dialog_text(unit.id) == unit.target) {
+        continue;
+      }
+      texts.insert(unit.id, unit.target);
+    }
+  }
+  catch (const EditorException& ex) {
+    ex.show_dialog();
+    return;
+  }
+
+  if (texts.isEmpty()) {
+    GuiTools::information_dialog(tr("No new or changed dialog in this file"));
+    return;
+  }
+
+  if (try_command(new ImportDialogsCommand(*this, texts))) {
+    GuiTools::information_dialog(
+          tr("%1 dialog(s) imported").arg(texts.size()));
+  }
+}
+
 /**
  * @brief Slot called when the user changes the displayed margin in text edit.
  */
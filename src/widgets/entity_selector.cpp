@@ -15,8 +15,6 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "widgets/entity_selector.h"
-#include "editor_exception.h"
-#include "map_model.h"
 #include "quest.h"
 
 namespace SolarusEditor {
@@ -142,31 +140,53 @@ void EntitySelector::build() {
     return;
   }
 
-  try {
-    MapModel map(*quest, map_id);
+  // Take entities from the quest index rather than loading the whole map.
+  QuestIndex& index = quest->get_index();
+  const QuestIndex::MapInfo& map_info = index.get_map_info(map_id);
+  if (index.is_building()) {
+    // The information may be outdated: show it until the index is refreshed.
+    connect(&index, SIGNAL(build_finished()),
+            this, SLOT(index_build_finished()), Qt::UniqueConnection);
+  }
+  if (!map_info.valid) {
+    // The map file could not be parsed: the map id is probably unset or incorrect.
+    return;
+  }
+  const QMap<QString, EntityType>& entities = QuestIndex::get_named_entities(map_info);
 
-    // Add special value items first.
-    Q_FOREACH (const SpecialValue& special_value, special_values) {
-      addItem(special_value.second, special_value.first);
-    }
+  // Add special value items first.
+  Q_FOREACH (const SpecialValue& special_value, special_values) {
+    addItem(special_value.second, special_value.first);
+  }
 
-    // Add entities.
-    const QMap<QString, EntityIndex>& indexes = map.get_named_entities();
-    for (auto it = indexes.begin(); it != indexes.end(); ++it) {
-      const QString& name = it.key();
-      const EntityIndex& index = it.value();
-      if (is_filtered_by_entity_type() &&
-          map.get_entity_type(index) != get_entity_type_filter()) {
-        // Not the wanted entity type.
-        continue;
-      }
-      addItem(name, name);
+  // Add entities.
+  for (auto it = entities.begin(); it != entities.end(); ++it) {
+    const QString& name = it.key();
+    if (is_filtered_by_entity_type() &&
+        it.value() != get_entity_type_filter()) {
+      // Not the wanted entity type.
+      continue;
     }
+    addItem(name, name);
   }
-  catch (const EditorException& ex) {
-    // The map file could not be opened: the map id is probably unset or incorrect.
-    Q_UNUSED(ex);
+}
+
+/**
+ * @brief Slot called when the quest index was refreshed after the combobox
+ * was built.
+ *
+ * The combobox is built again and keeps its selection.
+ */
+void EntitySelector::index_build_finished() {
+
+  if (quest != nullptr) {
+    disconnect(&quest->get_index(), SIGNAL(build_finished()),
+               this, SLOT(index_build_finished()));
   }
+
+  const QString& selected_name = get_selected_name();
+  build();
+  set_selected_name(selected_name);
 }
 
 }
@@ -15,18 +15,27 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "entities/entity_traits.h"
+#include "widgets/dialogs_editor.h"
 #include "widgets/editor.h"
 #include "widgets/enum_menus.h"
 #include "widgets/external_script_dialog.h"
 #include "widgets/gui_tools.h"
 #include "widgets/main_window.h"
+#include "widgets/map_editor.h"
 #include "widgets/pair_spin_box.h"
+#include "widgets/quest_checker_panel.h"
+#include "widgets/quest_text_search_panel.h"
+#include "widgets/refactoring_dialog.h"
+#include "widgets/strings_editor.h"
+#include "dialogs_model.h"
 #include "file_tools.h"
 #include "map_model.h"
 #include "new_quest_builder.h"
 #include "obsolete_editor_exception.h"
 #include "obsolete_quest_exception.h"
 #include "quest.h"
+#include "quest_refactoring.h"
+#include "strings_model.h"
 #include "version.h"
 #include <solarus/gui/quest_runner.h>
 #include <QActionGroup>
@@ -34,6 +43,7 @@
 #include <QDebug>
 #include <QDesktopServices>
 #include <QDesktopWidget>
+#include <QDockWidget>
 #include <QFileDialog>
 #include <QInputDialog>
 #include <QMessageBox>
@@ -63,7 +73,11 @@ MainWindow::MainWindow(QWidget* parent) :
   show_entities_button(nullptr),
   show_entities_subactions(),
   common_actions(),
-  settings_dialog(this) {
+  settings_dialog(this),
+  checker_dock(nullptr),
+  checker_panel(nullptr),
+  search_dock(nullptr),
+  search_panel(nullptr) {
 
   // Set up widgets.
   ui.setupUi(this);
@@ -89,6 +103,22 @@ MainWindow::MainWindow(QWidget* parent) :
   ui.console_widget->setVisible(false);
   ui.console_widget->set_quest_runner(quest_runner);
 
+  // Quest checker dock.
+  checker_panel = new QuestCheckerPanel(quest);
+  checker_dock = new QDockWidget(tr("Quest check"), this);
+  checker_dock->setObjectName("checker_dock");
+  checker_dock->setWidget(checker_panel);
+  addDockWidget(Qt::BottomDockWidgetArea, checker_dock);
+  checker_dock->setVisible(false);
+
+  // Text search dock.
+  search_panel = new QuestTextSearchPanel(quest);
+  search_dock = new QDockWidget(tr("Search in texts"), this);
+  search_dock->setObjectName("search_dock");
+  search_dock->setWidget(search_panel);
+  addDockWidget(Qt::BottomDockWidgetArea, search_dock);
+  search_dock->setVisible(false);
+
   // Menu and toolbar actions.
   recent_quests_menu = new QMenu(tr("Recent quests"));
   update_recent_quests_menu();
@@ -106,6 +136,9 @@ MainWindow::MainWindow(QWidget* parent) :
   ui.tool_bar->insertAction(ui.action_run_quest, redo_action);
   ui.tool_bar->insertSeparator(ui.action_run_quest);
   ui.action_run_quest->setEnabled(false);
+  ui.action_check_quest->setEnabled(false);
+  ui.menu_view->insertAction(ui.action_show_console, checker_dock->toggleViewAction());
+  ui.menu_view->insertAction(ui.action_show_console, search_dock->toggleViewAction());
 
   zoom_button = new QToolButton();
   zoom_button->setIcon(QIcon(":/images/icon_zoom.png"));
@@ -170,6 +203,10 @@ MainWindow::MainWindow(QWidget* parent) :
           ui.tab_widget, SLOT(open_file_requested(Quest&, QString)));
   connect(ui.quest_tree_view, SIGNAL(rename_file_requested(Quest&, QString)),
           this, SLOT(rename_file_requested(Quest&, QString)));
+  connect(checker_panel, SIGNAL(issue_activated(QString, EntityIndex)),
+          this, SLOT(show_quest_issue(QString, EntityIndex)));
+  connect(search_panel, SIGNAL(entry_activated(QString, QString, QString)),
+          this, SLOT(show_text_entry(QString, QString, QString)));
 
   connect(ui.tab_widget, SIGNAL(currentChanged(int)),
           this, SLOT(current_editor_changed(int)));
@@ -190,6 +227,7 @@ MainWindow::MainWindow(QWidget* parent) :
 
   connect(&settings_dialog, SIGNAL(settings_changed()),
           this, SLOT(reload_settings()));
+  reload_settings();
 
   // No editor initially.
   current_editor_changed(-1);
@@ -461,6 +499,7 @@ void MainWindow::close_quest() {
   quest.set_root_path("");
   update_title();
   ui.action_run_quest->setEnabled(false);
+  ui.action_check_quest->setEnabled(false);
   ui.quest_tree_view->set_quest(quest);
 }
 
@@ -491,6 +530,7 @@ bool MainWindow::open_quest(const QString& quest_path) {
             ui.tab_widget, SLOT(file_deleted(QString)));
 
     ui.action_run_quest->setEnabled(true);
+    ui.action_check_quest->setEnabled(true);
 
     add_quest_to_recent_list();
 
@@ -517,6 +557,7 @@ bool MainWindow::open_quest(const QString& quest_path) {
         quest.set_root_path(quest_path);
         quest.check_version();
         ui.action_run_quest->setEnabled(true);
+        ui.action_check_quest->setEnabled(true);
         success = true;
       }
       catch (const EditorException& ex) {
@@ -959,11 +1000,21 @@ void MainWindow::on_action_show_layer_2_triggered() {
   editor->get_view_settings().set_layer_visible(2, ui.action_show_layer_2->isChecked());
 }
 
+/**
+ * @brief Slot called when the user triggers the "Check quest" action.
+ */
+void MainWindow::on_action_check_quest_triggered() {
+
+  checker_dock->setVisible(true);
+  checker_panel->start();
+}
+
 /**
  * @brief Slot called when the user triggers the "Settings" action.
  */
 void MainWindow::on_action_settings_triggered() {
 
+  settings_dialog.set_image_cache(quest.is_valid() ? &quest.get_image_cache() : nullptr);
   settings_dialog.exec();
 }
 
@@ -1288,6 +1339,10 @@ void MainWindow::quest_finished() {
  */
 void MainWindow::reload_settings() {
 
+  EditorSettings settings;
+  quest.get_image_cache().set_max_bytes(
+        qint64(settings.get_value_int(EditorSettings::image_cache_size)) * 1024 * 1024);
+
   ui.tab_widget->reload_settings();
 }
 
@@ -1342,6 +1397,64 @@ bool MainWindow::confirm_before_closing() {
   return ui.tab_widget->confirm_before_closing();
 }
 
+/**
+ * @brief Slot called when the user wants to see a problem found in the quest.
+ *
+ * Opens the file and selects the entity if the problem is in a map.
+ *
+ * @param path The file where the problem is.
+ * @param entity_index Entity concerned in a map, or an invalid index.
+ */
+void MainWindow::show_quest_issue(const QString& path, const EntityIndex& entity_index) {
+
+  open_file(quest, path);
+
+  if (!entity_index.is_valid()) {
+    return;
+  }
+
+  MapEditor* map_editor = qobject_cast<MapEditor*>(get_current_editor());
+  if (map_editor == nullptr ||
+      map_editor->get_file_path() != path) {
+    return;
+  }
+  map_editor->show_entity(entity_index);
+}
+
+/**
+ * @brief Slot called when the user wants to see a text found by a search.
+ *
+ * Opens the strings or dialogs editor and selects the text.
+ *
+ * @param path Path of the strings or dialogs file.
+ * @param id String key or dialog id.
+ * @param property_key Dialog property to select, if any.
+ */
+void MainWindow::show_text_entry(
+    const QString& path, const QString& id, const QString& property_key) {
+
+  open_file(quest, path);
+
+  Editor* editor = get_current_editor();
+  if (editor == nullptr || editor->get_file_path() != path) {
+    return;
+  }
+
+  StringsEditor* strings_editor = qobject_cast<StringsEditor*>(editor);
+  if (strings_editor != nullptr) {
+    strings_editor->get_model().set_selected_key(id);
+    return;
+  }
+
+  DialogsEditor* dialogs_editor = qobject_cast<DialogsEditor*>(editor);
+  if (dialogs_editor != nullptr) {
+    dialogs_editor->get_model().set_selected_id(id);
+    if (!property_key.isEmpty()) {
+      dialogs_editor->set_selected_property(property_key);
+    }
+  }
+}
+
 /**
  * @brief Slot called when the user wants to rename a file.
  *
@@ -1399,7 +1512,43 @@ void MainWindow::rename_file_requested(Quest& quest, const QString& path) {
 
       if (ok && new_id != element_id) {
         Quest::check_valid_file_name(new_id);
-        quest.rename_resource_element(resource_type, element_id, new_id);
+        if (resources.exists(resource_type, new_id)) {
+          throw EditorException(tr("A resource with id '%1' already exists").arg(new_id));
+        }
+
+        // Update references to the element everywhere in the quest.
+        QuestRefactoring refactoring(quest);
+        const QList<QuestRefactoring::Change>& changes =
+            refactoring.plan_resource_renaming(resource_type, element_id, new_id);
+        QList<QuestRefactoring::Change> applied_changes;
+        if (!changes.isEmpty()) {
+          RefactoringDialog dialog(
+                tr("The following references to %1 '%2' will be updated.\n"
+                   "Script changes come from a textual search: "
+                   "please check them before selecting them.").
+                arg(resource_friendly_type_name_for_id, element_id),
+                changes,
+                this);
+          if (dialog.exec() != QDialog::Accepted) {
+            return;
+          }
+          applied_changes = dialog.get_selected_changes();
+          refactoring.apply(applied_changes);
+        }
+
+        try {
+          quest.rename_resource_element(resource_type, element_id, new_id);
+        }
+        catch (const EditorException&) {
+          // Make references match the id that still exists.
+          try {
+            refactoring.apply(QuestRefactoring::get_inverse_changes(applied_changes));
+          }
+          catch (const EditorException& ex) {
+            ex.show_dialog();
+          }
+          throw;
+        }
       }
     }
     else {
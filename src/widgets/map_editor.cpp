@@ -1111,6 +1111,21 @@ MapView& MapEditor::get_map_view() {
   return *ui.map_view;
 }
 
+/**
+ * @brief Selects an entity and scrolls the view to make it visible.
+ * @param index Index of the entity to show.
+ */
+void MapEditor::show_entity(const EntityIndex& index) {
+
+  if (!get_map().entity_exists(index)) {
+    return;
+  }
+
+  ui.map_view->set_only_selected_entity(index);
+  const QRect& box = get_map().get_entity_bounding_box(index);
+  ui.map_view->ensureVisible(box.translated(MapScene::get_margin_top_left()));
+}
+
 /**
  * @brief Initializes the entity creation toolbar.
  *
@@ -53,6 +53,8 @@ MapScene::MapScene(MapModel& map, QObject* parent) :
           this, SLOT(entity_xy_changed(EntityIndex, QPoint)));
   connect(&map, SIGNAL(entity_size_changed(EntityIndex, QSize)),
           this, SLOT(entity_size_changed(EntityIndex, QSize)));
+  connect(&map, SIGNAL(tileset_image_changed(EntityIndexes)),
+          this, SLOT(tileset_image_changed(EntityIndexes)));
 }
 
 /**
@@ -504,6 +506,23 @@ void MapScene::entity_size_changed(const EntityIndex& index, const QSize& size)
   item->update_size();
 }
 
+/**
+ * @brief Slot called when the tileset image of some tiles has changed.
+ *
+ * Their items on the scene are redrawn.
+ *
+ * @param indexes Indexes of the tiles.
+ */
+void MapScene::tileset_image_changed(const EntityIndexes& indexes) {
+
+  Q_FOREACH (const EntityIndex& index, indexes) {
+    EntityItem* item = get_entity_item(index);
+    if (item != nullptr) {
+      item->update();
+    }
+  }
+}
+
 /**
  * @brief Returns the indexes of selected entities.
  * @return The selected entities, sorted in the order of the map.
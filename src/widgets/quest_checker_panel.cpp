@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "widgets/quest_checker_panel.h"
+#include "quest.h"
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QStyle>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Creates a quest checker panel.
+ * @param quest The quest to check.
+ * @param parent The parent widget or nullptr.
+ */
+QuestCheckerPanel::QuestCheckerPanel(Quest& quest, QWidget* parent) :
+  QWidget(parent),
+  quest(quest),
+  checker(quest),
+  issues(),
+  num_errors(0),
+  check_button(new QPushButton(tr("Check"), this)),
+  progress_bar(new QProgressBar(this)),
+  summary_label(new QLabel(this)),
+  tree_widget(new QTreeWidget(this)) {
+
+  QVBoxLayout* layout = new QVBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+
+  QHBoxLayout* top_layout = new QHBoxLayout();
+  top_layout->addWidget(check_button);
+  top_layout->addWidget(progress_bar);
+  top_layout->addWidget(summary_label);
+  layout->addLayout(top_layout);
+
+  tree_widget->setColumnCount(3);
+  tree_widget->setHeaderLabels(
+        QStringList() << tr("File") << tr("Location") << tr("Problem"));
+  tree_widget->setRootIsDecorated(false);
+  tree_widget->setSortingEnabled(true);
+  tree_widget->sortByColumn(0, Qt::AscendingOrder);
+  tree_widget->header()->setSectionResizeMode(2, QHeaderView::Stretch);
+  layout->addWidget(tree_widget);
+
+  progress_bar->setVisible(false);
+
+  connect(check_button, SIGNAL(clicked()),
+          this, SLOT(start()));
+  connect(tree_widget, SIGNAL(itemActivated(QTreeWidgetItem*, int)),
+          this, SLOT(item_activated(QTreeWidgetItem*)));
+
+  connect(&checker, SIGNAL(started()),
+          this, SLOT(check_started()));
+  connect(&checker, SIGNAL(progress_changed(int, int)),
+          this, SLOT(progress_changed(int, int)));
+  connect(&checker, SIGNAL(issues_found(QList<QuestChecker::Issue>)),
+          this, SLOT(issues_found(QList<QuestChecker::Issue>)));
+  connect(&checker, SIGNAL(finished()),
+          this, SLOT(check_finished()));
+
+  update_summary();
+}
+
+/**
+ * @brief Checks the whole quest again, or stops the check in progress.
+ */
+void QuestCheckerPanel::start() {
+
+  if (checker.is_running()) {
+    checker.cancel();
+    return;
+  }
+
+  checker.start();
+}
+
+/**
+ * @brief Slot called when the checker starts.
+ */
+void QuestCheckerPanel::check_started() {
+
+  issues.clear();
+  num_errors = 0;
+  tree_widget->clear();
+  check_button->setText(tr("Stop"));
+  progress_bar->setValue(0);
+  progress_bar->setVisible(true);
+  update_summary();
+}
+
+/**
+ * @brief Slot called when files were checked.
+ * @param num_files_checked Number of files checked so far.
+ * @param num_files Total number of files to check.
+ */
+void QuestCheckerPanel::progress_changed(int num_files_checked, int num_files) {
+
+  progress_bar->setMaximum(num_files);
+  progress_bar->setValue(num_files_checked);
+}
+
+/**
+ * @brief Slot called when the checker has found problems.
+ * @param new_issues The problems found.
+ */
+void QuestCheckerPanel::issues_found(const QList<QuestChecker::Issue>& new_issues) {
+
+  const QString& data_path = quest.get_data_path();
+  const QIcon& error_icon = style()->standardIcon(QStyle::SP_MessageBoxCritical);
+  const QIcon& warning_icon = style()->standardIcon(QStyle::SP_MessageBoxWarning);
+
+  tree_widget->setSortingEnabled(false);
+  Q_FOREACH (const QuestChecker::Issue& issue, new_issues) {
+    QTreeWidgetItem* item = new QTreeWidgetItem(tree_widget);
+    item->setText(0, issue.file_path.mid(data_path.length() + 1));
+    item->setText(1, issue.location);
+    item->setText(2, issue.message);
+    item->setToolTip(2, issue.message);
+    item->setData(0, Qt::UserRole, issues.size());
+    if (issue.severity == QuestChecker::Severity::FAILURE) {
+      item->setIcon(0, error_icon);
+      ++num_errors;
+    }
+    else {
+      item->setIcon(0, warning_icon);
+    }
+    issues << issue;
+  }
+  tree_widget->setSortingEnabled(true);
+
+  update_summary();
+}
+
+/**
+ * @brief Slot called when the checker has finished or was stopped.
+ */
+void QuestCheckerPanel::check_finished() {
+
+  check_button->setText(tr("Check"));
+  progress_bar->setVisible(false);
+  tree_widget->resizeColumnToContents(0);
+  tree_widget->resizeColumnToContents(1);
+  update_summary();
+}
+
+/**
+ * @brief Updates the label showing the number of problems found.
+ */
+void QuestCheckerPanel::update_summary() {
+
+  summary_label->setText(tr("%1 error(s), %2 warning(s)").
+                         arg(num_errors).arg(issues.size() - num_errors));
+}
+
+/**
+ * @brief Slot called when the user double-clicks a problem.
+ * @param item The item activated.
+ */
+void QuestCheckerPanel::item_activated(QTreeWidgetItem* item) {
+
+  if (item == nullptr) {
+    return;
+  }
+
+  const int index = item->data(0, Qt::UserRole).toInt();
+  if (index < 0 || index >= issues.size()) {
+    return;
+  }
+
+  const QuestChecker::Issue& issue = issues.at(index);
+  emit issue_activated(issue.file_path, issue.entity_index);
+}
+
+}
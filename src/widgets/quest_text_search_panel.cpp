@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "widgets/quest_text_search_panel.h"
+#include "widgets/resource_selector.h"
+#include "quest.h"
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace SolarusEditor {
+
+using Entry = QuestTextIndex::Entry;
+using EntryKind = QuestTextIndex::EntryKind;
+
+namespace {
+
+/**
+ * @brief Maximum number of results shown in the list.
+ *
+ * Creating items is much slower than searching, so very common words
+ * only show the first results.
+ */
+constexpr int max_results_shown = 1000;
+
+}
+
+/**
+ * @brief Creates a text search panel.
+ * @param quest The quest to search in.
+ * @param parent The parent widget or nullptr.
+ */
+QuestTextSearchPanel::QuestTextSearchPanel(Quest& quest, QWidget* parent) :
+  QWidget(parent),
+  quest(quest),
+  results(),
+  query_field(new QLineEdit(this)),
+  language_field(new ResourceSelector(this)),
+  summary_label(new QLabel(this)),
+  tree_widget(new QTreeWidget(this)),
+  update_timer(new QTimer(this)) {
+
+  QVBoxLayout* layout = new QVBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+
+  QHBoxLayout* top_layout = new QHBoxLayout();
+  top_layout->addWidget(query_field);
+  top_layout->addWidget(language_field);
+  top_layout->addWidget(summary_label);
+  layout->addLayout(top_layout);
+
+  query_field->setPlaceholderText(tr("Words or \"exact phrase\""));
+  query_field->setClearButtonEnabled(true);
+
+  language_field->set_quest(quest);
+  language_field->set_resource_type(ResourceType::LANGUAGE);
+  language_field->add_special_value("", tr("<All languages>"), 0);
+  language_field->set_selected_id("");
+
+  tree_widget->setColumnCount(4);
+  tree_widget->setHeaderLabels(
+        QStringList() << tr("Language") << tr("Id") << tr("Field") << tr("Text"));
+  tree_widget->setRootIsDecorated(false);
+  tree_widget->setUniformRowHeights(true);
+  tree_widget->header()->setSectionResizeMode(3, QHeaderView::Stretch);
+  layout->addWidget(tree_widget);
+
+  // Many texts can change at once, for example when importing a translation.
+  update_timer->setSingleShot(true);
+  update_timer->setInterval(200);
+
+  connect(query_field, SIGNAL(textChanged(QString)),
+          this, SLOT(update_results()));
+  connect(language_field, SIGNAL(activated(QString)),
+          this, SLOT(update_results()));
+  connect(tree_widget, SIGNAL(itemActivated(QTreeWidgetItem*, int)),
+          this, SLOT(item_activated(QTreeWidgetItem*)));
+  connect(update_timer, SIGNAL(timeout()),
+          this, SLOT(update_results()));
+
+  connect(&quest.get_text_index(), SIGNAL(index_changed()),
+          this, SLOT(index_changed()));
+
+  update_results();
+}
+
+/**
+ * @brief Searches the query again and shows the results.
+ */
+void QuestTextSearchPanel::update_results() {
+
+  const QuestTextIndex& index = quest.get_text_index();
+  results = index.search(query_field->text(), language_field->get_selected_id());
+
+  tree_widget->clear();
+  const int num_shown = qMin(results.size(), max_results_shown);
+  QList<QTreeWidgetItem*> items;
+  for (int i = 0; i < num_shown; ++i) {
+    const Entry& entry = results.at(i);
+    QTreeWidgetItem* item = new QTreeWidgetItem();
+    item->setText(0, entry.language_id);
+    item->setText(1, entry.id);
+    switch (entry.kind) {
+
+    case EntryKind::STRING:
+      item->setText(2, tr("String"));
+      break;
+
+    case EntryKind::DIALOG_TEXT:
+      item->setText(2, tr("Dialog text"));
+      break;
+
+    case EntryKind::DIALOG_PROPERTY:
+      item->setText(2, tr("Dialog property '%1'").arg(entry.property_key));
+      break;
+    }
+    item->setText(3, entry.text.simplified());
+    item->setToolTip(3, entry.text);
+    item->setData(0, Qt::UserRole, i);
+    items << item;
+  }
+  tree_widget->addTopLevelItems(items);
+
+  if (query_field->text().trimmed().isEmpty()) {
+    summary_label->setText(tr("%1 text(s) indexed").arg(index.get_num_entries()));
+  }
+  else if (results.size() > num_shown) {
+    summary_label->setText(tr("%1 result(s), %2 shown").
+                           arg(results.size()).arg(num_shown));
+  }
+  else {
+    summary_label->setText(tr("%1 result(s)").arg(results.size()));
+  }
+}
+
+/**
+ * @brief Slot called when the text index has changed.
+ *
+ * The results are updated soon if the panel is visible.
+ */
+void QuestTextSearchPanel::index_changed() {
+
+  if (!isVisible()) {
+    return;
+  }
+
+  update_timer->start();
+}
+
+/**
+ * @brief Receives a show event.
+ *
+ * Results may be outdated since the index is not searched again while
+ * the panel is hidden.
+ *
+ * @param event The event to handle.
+ */
+void QuestTextSearchPanel::showEvent(QShowEvent* event) {
+
+  QWidget::showEvent(event);
+  update_results();
+}
+
+/**
+ * @brief Slot called when the user double-clicks a result.
+ * @param item The item activated.
+ */
+void QuestTextSearchPanel::item_activated(QTreeWidgetItem* item) {
+
+  if (item == nullptr) {
+    return;
+  }
+
+  const int index = item->data(0, Qt::UserRole).toInt();
+  if (index < 0 || index >= results.size()) {
+    return;
+  }
+
+  const Entry& entry = results.at(index);
+  const QString& path = (entry.kind == EntryKind::STRING) ?
+        quest.get_strings_path(entry.language_id) :
+        quest.get_dialogs_path(entry.language_id);
+  emit entry_activated(path, entry.id, entry.property_key);
+}
+
+}
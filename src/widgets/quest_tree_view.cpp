@@ -20,6 +20,7 @@
 #include "editor_exception.h"
 #include "quest.h"
 #include "quest_files_model.h"
+#include "quest_refactoring.h"
 #include <QContextMenuEvent>
 #include <QDir>
 #include <QFile>
@@ -755,14 +756,29 @@ void QuestTreeView::delete_action_triggered() {
       QuestResources& resources = quest.get_resources();
       const QString& resource_friendly_name_for_id =
           resources.get_friendly_name_for_id(resource_type);
-      QMessageBox::StandardButton answer = QMessageBox::question(
-            this,
+      QMessageBox message_box(
+            QMessageBox::Question,
             tr("Delete confirmation"),
             tr("Do you really want to delete %1 '%2'?").
             arg(resource_friendly_name_for_id).arg(element_id),
-            QMessageBox::Yes | QMessageBox::No);
+            QMessageBox::Yes | QMessageBox::No,
+            this);
+
+      // Warn about references that will be broken.
+      QuestRefactoring refactoring(quest);
+      const QList<QuestRefactoring::Change>& usages =
+          refactoring.find_resource_usages(resource_type, element_id);
+      if (!usages.isEmpty()) {
+        QStringList locations;
+        Q_FOREACH (const QuestRefactoring::Change& usage, usages) {
+          locations << usage.location;
+        }
+        message_box.setInformativeText(
+              tr("It may still be used at %n place(s) in maps.", "", usages.size()));
+        message_box.setDetailedText(locations.join('\n'));
+      }
 
-      if (answer != QMessageBox::Yes) {
+      if (message_box.exec() != QMessageBox::Yes) {
         return;
       }
 
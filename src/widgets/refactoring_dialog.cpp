@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2014-2016 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "widgets/refactoring_dialog.h"
+#include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Creates a refactoring preview dialog.
+ * @param message Explanation displayed above the list of changes.
+ * @param changes The changes to preview.
+ * @param parent Parent object or nullptr.
+ */
+RefactoringDialog::RefactoringDialog(
+    const QString& message,
+    const QList<QuestRefactoring::Change>& changes,
+    QWidget* parent) :
+  QDialog(parent),
+  changes(changes),
+  tree_widget(new QTreeWidget(this)) {
+
+  setWindowTitle(tr("Update references"));
+  resize(640, 400);
+
+  QVBoxLayout* layout = new QVBoxLayout(this);
+
+  QLabel* label = new QLabel(message, this);
+  label->setWordWrap(true);
+  layout->addWidget(label);
+
+  tree_widget->setColumnCount(2);
+  tree_widget->setHeaderLabels(QStringList() << tr("Location") << tr("Change"));
+  tree_widget->setRootIsDecorated(false);
+  tree_widget->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+  for (int i = 0; i < changes.size(); ++i) {
+    const QuestRefactoring::Change& change = changes.at(i);
+    QTreeWidgetItem* item = new QTreeWidgetItem(tree_widget);
+    item->setText(0, change.location);
+    item->setText(1, tr("'%1' -> '%2'").arg(change.old_value, change.new_value));
+    item->setData(0, Qt::UserRole, i);
+    item->setCheckState(0, change.safe ? Qt::Checked : Qt::Unchecked);
+    item->setToolTip(0, change.file_path);
+  }
+  tree_widget->resizeColumnToContents(1);
+  layout->addWidget(tree_widget);
+
+  QDialogButtonBox* button_box = new QDialogButtonBox(
+        QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+  layout->addWidget(button_box);
+
+  connect(button_box, SIGNAL(accepted()),
+          this, SLOT(accept()));
+  connect(button_box, SIGNAL(rejected()),
+          this, SLOT(reject()));
+}
+
+/**
+ * @brief Returns the changes checked by the user.
+ * @return The changes to apply.
+ */
+QList<QuestRefactoring::Change> RefactoringDialog::get_selected_changes() const {
+
+  QList<QuestRefactoring::Change> selected_changes;
+  for (int i = 0; i < tree_widget->topLevelItemCount(); ++i) {
+    const QTreeWidgetItem* item = tree_widget->topLevelItem(i);
+    if (item->checkState(0) == Qt::Checked) {
+      selected_changes << changes.at(item->data(0, Qt::UserRole).toInt());
+    }
+  }
+  return selected_changes;
+}
+
+}
@@ -17,10 +17,36 @@
 #include "widgets/resource_model.h"
 #include "quest.h"
 #include "quest_resources.h"
+#include "rectangle.h"
 #include "sprite_model.h"
+#include <solarus/SpriteData.h>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QtConcurrentMap>
 
 namespace SolarusEditor {
 
+namespace {
+
+/**
+ * @brief Returns a string that changes when a file is modified.
+ * @param file_info A file.
+ * @return The modification date and size of the file.
+ */
+QString get_file_stamp(const QFileInfo& file_info) {
+
+  if (!file_info.exists()) {
+    return QString();
+  }
+  return QString::number(file_info.lastModified().toMSecsSinceEpoch()) + ":" +
+      QString::number(file_info.size());
+}
+
+}
+
 /**
  * @brief Creates a resource model.
  * @param quest The quest.
@@ -34,7 +60,12 @@ ResourceModel::ResourceModel(const Quest& quest, ResourceType resource_type, QOb
   items(),
   icons(),
   directory_icon(":/images/icon_folder_open.png"),
-  tileset_id() {
+  tileset_id(),
+  sprite_icons_to_load(),
+  sprite_icons_loading(),
+  sprite_icon_request_timer(),
+  sprite_icon_watcher(),
+  icons_generation(0) {
 
   QStringList ids = get_resources().get_elements(this->resource_type);
   Q_FOREACH (const QString& id, ids) {
@@ -50,6 +81,27 @@ ResourceModel::ResourceModel(const Quest& quest, ResourceType resource_type, QOb
           this, SLOT(element_renamed(ResourceType, QString, QString)));
   connect(&resources, SIGNAL(element_description_changed(ResourceType, QString, QString)),
           this, SLOT(element_description_changed(ResourceType, QString, QString)));
+
+  // Build sprite icons in the background.
+  sprite_icon_request_timer.setSingleShot(true);
+  sprite_icon_request_timer.setInterval(0);
+  connect(&sprite_icon_request_timer, SIGNAL(timeout()),
+          this, SLOT(start_loading_sprite_icons()));
+  connect(&sprite_icon_watcher, SIGNAL(resultReadyAt(int)),
+          this, SLOT(sprite_icon_loaded(int)));
+  connect(&sprite_icon_watcher, SIGNAL(finished()),
+          this, SLOT(sprite_icons_loading_finished()));
+}
+
+/**
+ * @brief Destroys the resource model.
+ *
+ * Waits for sprite icons being built.
+ */
+ResourceModel::~ResourceModel() {
+
+  sprite_icon_watcher.cancel();
+  sprite_icon_watcher.waitForFinished();
 }
 
 /**
@@ -94,6 +146,9 @@ void ResourceModel::set_tileset_id(const QString& tileset_id) {
 
     // Icons may change.
     icons.clear();  // Clear the icon cache.
+    sprite_icons_to_load.clear();
+    sprite_icons_loading.clear();
+    ++icons_generation;  // Ignore icons being built.
     QVector<int> roles;
     roles << Qt::DecorationRole;
     dataChanged(QModelIndex(), QModelIndex(), roles);
@@ -268,30 +323,206 @@ QStandardItem* ResourceModel::create_dir_item(const QString& dir_name) {
 }
 
 /**
- * @brief Returns an icon for the given element.
- * @param element_id Id of a resource element.
- * @return An appropriate icon.
+ * @brief Returns the icon representing the resource type of this model.
+ * @return The resource type icon.
  */
-QIcon ResourceModel::create_icon(const QString& element_id) const {
+QIcon ResourceModel::get_resource_type_icon() const {
 
-  const Quest& quest = get_quest();
-  Q_ASSERT(!element_id.isEmpty());
-  Q_ASSERT(quest.get_resources().exists(resource_type, element_id));
-  if (resource_type == ResourceType::SPRITE) {
-    // Special case of sprites: show the sprite icon.
-    if (quest.exists(quest.get_sprite_path(element_id))) {
-      SpriteModel sprite(quest, element_id);
-      sprite.set_tileset_id(tileset_id);
-      const QPixmap& pixmap = sprite.get_icon();
-      if (!pixmap.isNull()) {
-        return QIcon(pixmap);
+  QString resource_type_name = quest.get_resources().get_lua_name(resource_type);
+  return QIcon(":/images/icon_resource_" + resource_type_name + ".png");
+}
+
+/**
+ * @brief Asks the icon of a sprite to be built in the background.
+ *
+ * dataChanged() is emitted when the icon is ready.
+ *
+ * @param element_id Id of a sprite.
+ */
+void ResourceModel::queue_sprite_icon(const QString& element_id) const {
+
+  if (sprite_icons_to_load.contains(element_id) ||
+      sprite_icons_loading.contains(element_id)) {
+    return;
+  }
+
+  sprite_icons_to_load.insert(element_id);
+  if (!sprite_icon_request_timer.isActive()) {
+    sprite_icon_request_timer.start();
+  }
+}
+
+/**
+ * @brief Starts building the sprite icons requested in worker threads.
+ */
+void ResourceModel::start_loading_sprite_icons() {
+
+  if (sprite_icons_to_load.isEmpty() || sprite_icon_watcher.isRunning()) {
+    // sprite_icons_loading_finished() will call us again.
+    return;
+  }
+
+  // Like SpriteModel, use the first tileset of the quest by default.
+  QString icons_tileset_id = tileset_id;
+  if (icons_tileset_id.isEmpty()) {
+    const QStringList& tilesets = quest.get_resources().get_elements(ResourceType::TILESET);
+    if (!tilesets.isEmpty()) {
+      icons_tileset_id = tilesets.first();
+    }
+  }
+
+  const QString& cache_path = quest.get_cache_path();
+  QList<SpriteIconJob> jobs;
+  Q_FOREACH (const QString& sprite_id, sprite_icons_to_load) {
+    SpriteIconJob job;
+    job.sprite_id = sprite_id;
+    job.sprite_path = quest.get_sprite_path(sprite_id);
+    job.sprite_images_path = quest.get_sprite_image_path("");
+    if (!icons_tileset_id.isEmpty()) {
+      job.tileset_image_path = quest.get_tileset_entities_image_path(icons_tileset_id);
+    }
+    if (!cache_path.isEmpty()) {
+      const QByteArray& hash = QCryptographicHash::hash(
+            sprite_id.toUtf8(), QCryptographicHash::Md5).toHex();
+      job.cache_file_path = cache_path + "/sprite_icons/" + QString::fromLatin1(hash) + ".png";
+    }
+    job.generation = icons_generation;
+    jobs << job;
+    sprite_icons_loading.insert(sprite_id);
+  }
+  sprite_icons_to_load.clear();
+
+  sprite_icon_watcher.setFuture(QtConcurrent::mapped(jobs, load_sprite_icon_in_worker));
+}
+
+/**
+ * @brief Builds the icon of a sprite.
+ *
+ * Called from worker threads, so the sprite file is parsed directly instead
+ * of creating a SpriteModel.
+ * The icon is read from the cache directory if the sprite and its image
+ * have not changed since it was persisted.
+ * Otherwise, it is built and persisted for next sessions.
+ *
+ * @param job The sprite to show.
+ * @return The same information with the icon built,
+ * or with a null icon if the sprite has no valid image.
+ */
+ResourceModel::SpriteIconJob ResourceModel::load_sprite_icon_in_worker(const SpriteIconJob& job) {
+
+  SpriteIconJob result = job;
+  const QString& sprite_stamp = get_file_stamp(QFileInfo(job.sprite_path));
+  if (sprite_stamp.isEmpty()) {
+    return result;
+  }
+
+  // Try the icon persisted in a previous session.
+  if (!job.cache_file_path.isEmpty()) {
+    QImageReader cache_reader(job.cache_file_path);
+    if (cache_reader.canRead()) {
+      const QString& image_path = cache_reader.text("image_path");
+      const bool tileset_dependent = cache_reader.text("tileset_dependent") == "1";
+      if (cache_reader.text("sprite_stamp") == sprite_stamp &&
+          (!tileset_dependent || image_path == job.tileset_image_path) &&
+          cache_reader.text("image_stamp") == get_file_stamp(QFileInfo(image_path))) {
+        const QImage& icon = cache_reader.read();
+        if (!icon.isNull()) {
+          result.icon = icon;
+          return result;
+        }
       }
     }
   }
 
-  // Return an icon representing the resource type.
-  QString resource_type_name = quest.get_resources().get_lua_name(resource_type);
-  return QIcon(":/images/icon_resource_" + resource_type_name + ".png");
+  // Find the first frame of the default animation.
+  Solarus::SpriteData sprite;
+  if (!sprite.import_from_file(job.sprite_path.toStdString())) {
+    return result;
+  }
+
+  const auto& animations = sprite.get_animations();
+  const auto& it = animations.find(sprite.get_default_animation_name());
+  if (it == animations.end()) {
+    // No animation in the sprite.
+    return result;
+  }
+
+  const Solarus::SpriteAnimationData& animation = it->second;
+  const int num_directions = animation.get_num_directions();
+  if (num_directions == 0) {
+    // Nothing in the animation.
+    return result;
+  }
+
+  // If the sprite has a four-direction system, pick the south direction.
+  const int direction = num_directions == 4 ? 3 : 0;
+  const QRect& frame = Rectangle::to_qrect(animation.get_direction(direction).get_frame());
+
+  const bool tileset_dependent = animation.src_image_is_tileset();
+  const QString& image_path = tileset_dependent ?
+        job.tileset_image_path :
+        job.sprite_images_path + QString::fromStdString(animation.get_src_image());
+  if (image_path.isEmpty()) {
+    return result;
+  }
+
+  const QImage image(image_path);
+  if (image.isNull()) {
+    return result;
+  }
+
+  result.icon = SpriteModel::create_icon_image(image.copy(frame));
+
+  // Persist the icon.
+  if (!job.cache_file_path.isEmpty()) {
+    QImage icon = result.icon;
+    icon.setText("sprite_stamp", sprite_stamp);
+    icon.setText("image_path", image_path);
+    icon.setText("image_stamp", get_file_stamp(QFileInfo(image_path)));
+    icon.setText("tileset_dependent", tileset_dependent ? "1" : "0");
+
+    QDir().mkpath(QFileInfo(job.cache_file_path).path());
+    QSaveFile file(job.cache_file_path);
+    if (file.open(QIODevice::WriteOnly) && icon.save(&file, "PNG")) {
+      file.commit();
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Slot called when a sprite icon was built in a worker thread.
+ * @param result_index Index of the result in the icon watcher.
+ */
+void ResourceModel::sprite_icon_loaded(int result_index) {
+
+  const SpriteIconJob& result = sprite_icon_watcher.resultAt(result_index);
+  if (result.generation != icons_generation) {
+    // The tileset has changed in the meantime.
+    return;
+  }
+
+  sprite_icons_loading.remove(result.sprite_id);
+  const QIcon& icon = result.icon.isNull() ?
+        get_resource_type_icon() : QIcon(QPixmap::fromImage(result.icon));
+  icons.insert(result.sprite_id, icon);
+
+  const QModelIndex& index = get_element_index(result.sprite_id);
+  if (index.isValid()) {
+    emit dataChanged(index, index, QVector<int>() << Qt::DecorationRole);
+  }
+}
+
+/**
+ * @brief Slot called when a batch of sprite icons was built.
+ *
+ * Starts the next batch if more icons were requested in the meantime.
+ */
+void ResourceModel::sprite_icons_loading_finished() {
+
+  if (!sprite_icons_to_load.isEmpty()) {
+    start_loading_sprite_icons();
+  }
 }
 
 /**
@@ -419,12 +650,18 @@ QVariant ResourceModel::data(const QModelIndex& index, int role) const {
       // Icon already loaded.
       return it.value();
     }
-    else {
-      // Icon not loaded yet.
-      QIcon icon = create_icon(element_id);
-      icons.insert(element_id, icon);
-      return icon;
+
+    if (resource_type == ResourceType::SPRITE) {
+      // Special case of sprites: the sprite icon is built in the background.
+      // Show the resource type icon until it is ready.
+      queue_sprite_icon(element_id);
+      return get_resource_type_icon();
     }
+
+    // Icon not loaded yet.
+    QIcon icon = get_resource_type_icon();
+    icons.insert(element_id, icon);
+    return icon;
   }
 
   return QStandardItemModel::data(index, role);
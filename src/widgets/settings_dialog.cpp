@@ -16,6 +16,7 @@
  */
 #include "widgets/settings_dialog.h"
 #include "editor_settings.h"
+#include "quest_image_cache.h"
 #include <QColorDialog>
 #include <QFileDialog>
 #include <QMessageBox>
@@ -28,7 +29,8 @@ namespace SolarusEditor {
  * @param parent Parent widget or nullptr.
  */
 SettingsDialog::SettingsDialog(QWidget *parent) :
-  QDialog(parent) {
+  QDialog(parent),
+  image_cache(nullptr) {
 
   ui.setupUi(this);
 
@@ -62,6 +64,8 @@ SettingsDialog::SettingsDialog(QWidget *parent) :
           this, SLOT(change_quest_size()));
   connect(ui.quest_size_field, SIGNAL(value_changed(int,int)),
           this, SLOT(change_quest_size()));
+  connect(ui.image_cache_size_field, SIGNAL(valueChanged(int)),
+          this, SLOT(change_image_cache_size()));
 
   // Text editor.
   connect(ui.font_family_field, SIGNAL(currentTextChanged(QString)),
@@ -106,6 +110,16 @@ SettingsDialog::SettingsDialog(QWidget *parent) :
           this, SLOT(change_sprite_origin_color()));
 }
 
+/**
+ * @brief Sets the image cache whose statistics are shown.
+ * @param image_cache Image cache of the current quest or nullptr.
+ */
+void SettingsDialog::set_image_cache(const QuestImageCache* image_cache) {
+
+  this->image_cache = image_cache;
+  update_image_cache_statistics();
+}
+
 /**
  * @brief Closes the dialog and apply changes.
  * @param result Result code of the dialog.
@@ -172,6 +186,8 @@ void SettingsDialog::update() {
   update_no_audio();
   update_video_acceleration();
   update_quest_size();
+  update_image_cache_size();
+  update_image_cache_statistics();
 
   // Text editor.
   update_font_family();
@@ -386,6 +402,43 @@ void SettingsDialog::change_quest_size() {
   update_buttons();
 }
 
+/**
+ * @brief Updates the image cache size field.
+ */
+void SettingsDialog::update_image_cache_size() {
+
+  ui.image_cache_size_field->setValue(
+    settings.get_value_int(EditorSettings::image_cache_size));
+}
+
+/**
+ * @brief Slot called when the user changes the image cache size.
+ */
+void SettingsDialog::change_image_cache_size() {
+
+  edited_settings[EditorSettings::image_cache_size] =
+    ui.image_cache_size_field->value();
+  update_buttons();
+}
+
+/**
+ * @brief Updates the statistics of the image cache of the current quest.
+ */
+void SettingsDialog::update_image_cache_statistics() {
+
+  if (image_cache == nullptr) {
+    ui.image_cache_statistics_label->clear();
+    return;
+  }
+
+  ui.image_cache_statistics_label->setText(
+    tr("%1 images, %2 MiB used, %3 hits, %4 misses").
+    arg(image_cache->get_num_images()).
+    arg(image_cache->get_num_bytes() / (1024.0 * 1024.0), 0, 'f', 1).
+    arg(image_cache->get_num_hits()).
+    arg(image_cache->get_num_misses()));
+}
+
 /**
  * @brief Updates the font family field.
  */
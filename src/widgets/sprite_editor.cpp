@@ -24,7 +24,9 @@
 #include "point.h"
 #include "quest.h"
 #include "quest_resources.h"
+#include "size.h"
 #include "sprite_model.h"
+#include "sprite_sheet_detector.h"
 #include <QFileInfo>
 #include <QUndoStack>
 
@@ -345,10 +347,13 @@ public:
 
   CreateDirectionCommand(
       SpriteEditor& editor, const SpriteModel::Index& index,
-      const QRect& frame) :
+      const Solarus::SpriteAnimationDirectionData& direction) :
     SpriteEditorCommand(editor, SpriteEditor::tr("Add direction")),
     index(index),
-    frame(frame) {
+    direction(direction) {
+
+    this->index.direction_nb =
+        get_model().get_animation_num_directions(index);
   }
 
   virtual void undo() override {
@@ -358,14 +363,14 @@ public:
 
   virtual void redo() override {
 
-    index.direction_nb = get_model().add_direction(index, frame);
+    index.direction_nb = get_model().insert_direction(index, direction);
     get_model().set_selected_index(index);
   }
 
 private:
 
   SpriteModel::Index index;
-  QRect frame;
+  Solarus::SpriteAnimationDirectionData direction;
 };
 
 /**
@@ -986,11 +991,24 @@ void SpriteEditor::rename_animation_requested() {
  */
 void SpriteEditor::create_direction_requested() {
 
-  add_direction_requested(QRect(0, 0, 16, 16));
+  SpriteModel::Index index = model->get_selected_index();
+  if (!index.is_valid()) {
+    // No selection.
+    return;
+  }
+
+  Solarus::SpriteAnimationDirectionData direction(
+        Solarus::Point(0, 0), Solarus::Size(16, 16));
+  try_command(new CreateDirectionCommand(*this, index, direction));
 }
 
 /**
  * @brief Slot called when the user wants to add a new direction.
+ *
+ * If the grid auto detection option is enabled, the frames of the sprites
+ * drawn in the area are detected.
+ *
+ * @param frame Area of the new direction in the source image.
  */
 void SpriteEditor::add_direction_requested(const QRect& frame) {
 
@@ -1000,7 +1018,23 @@ void SpriteEditor::add_direction_requested(const QRect& frame) {
     return;
   }
 
-  try_command(new CreateDirectionCommand(*this, index, frame));
+  Solarus::SpriteAnimationDirectionData direction(
+        Point::to_solarus_point(frame.topLeft()),
+        Size::to_solarus_size(frame.size()));
+
+  if (auto_detect_grid) {
+    SpriteSheetDetector detector(model->get_animation_image(index));
+    const SpriteSheetDetector::Grid& grid = detector.detect_grid(frame);
+    if (grid.is_valid()) {
+      direction.set_xy(Point::to_solarus_point(grid.first_frame.topLeft()));
+      direction.set_size(Size::to_solarus_size(grid.first_frame.size()));
+      direction.set_num_frames(grid.num_frames);
+      direction.set_num_columns(grid.num_columns);
+      direction.set_origin(Point::to_solarus_point(grid.origin));
+    }
+  }
+
+  try_command(new CreateDirectionCommand(*this, index, direction));
 }
 
 /**
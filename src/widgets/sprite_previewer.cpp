@@ -16,9 +16,53 @@
  */
 #include "widgets/sprite_previewer.h"
 #include <QMenu>
+#include <QPainter>
 
 namespace SolarusEditor {
 
+/**
+ * @brief Graphic item that draws a frame directly from the sprite image.
+ */
+class FrameItem : public QGraphicsItem {
+
+public:
+
+  /**
+   * @brief Changes the frame displayed.
+   * @param frame The new frame or a null frame.
+   */
+  void set_frame(const SpriteModel::Frame& frame) {
+    if (frame.rect.size() != this->frame.rect.size()) {
+      prepareGeometryChange();
+    }
+    this->frame = frame;
+    update();
+  }
+
+  /**
+   * @copydoc QGraphicsItem::boundingRect
+   */
+  QRectF boundingRect() const override {
+    return QRectF(QPointF(0, 0), frame.rect.size());
+  }
+
+  /**
+   * @copydoc QGraphicsItem::paint
+   */
+  void paint(QPainter* painter,
+             const QStyleOptionGraphicsItem* /* option */,
+             QWidget* /* widget */) override {
+    if (!frame.is_null()) {
+      painter->drawPixmap(QPointF(0, 0), frame.pixmap, frame.rect);
+    }
+  }
+
+private:
+
+  SpriteModel::Frame frame;     /**< The frame displayed. */
+
+};
+
 /**
  * @brief Create a sprite previewer.
  * @param parent The parent object or nullptr.
@@ -26,23 +70,24 @@ namespace SolarusEditor {
 SpritePreviewer::SpritePreviewer(QWidget *parent) :
   QWidget(parent),
   model(nullptr),
+  mode(PreviewMode::DIRECTION),
+  origin_color(Qt::blue),
+  frame_delay(0),
+  num_frames_displayed(0),
+  frame_rate_start_date(0),
   zoom(1.0) {
 
   ui.setupUi(this);
 
-  // Create frame and origin items.
-  item = new QGraphicsPixmapItem();
-  origin_h = new QGraphicsLineItem();
-  origin_v = new QGraphicsLineItem();
-
-  origin_h->setPen(QPen(Qt::blue));
-  origin_v->setPen(QPen(Qt::blue));
+  ui.mode_field->addItem(
+        tr("Direction"), static_cast<int>(PreviewMode::DIRECTION));
+  ui.mode_field->addItem(
+        tr("All directions"), static_cast<int>(PreviewMode::ANIMATION));
+  ui.mode_field->addItem(
+        tr("All animations"), static_cast<int>(PreviewMode::SPRITE));
 
   // Create the scene.
   ui.frame_view->setScene(new QGraphicsScene());
-  ui.frame_view->scene()->addItem(item);
-  ui.frame_view->scene()->addItem(origin_h);
-  ui.frame_view->scene()->addItem(origin_v);
   ui.frame_view->scene()->setBackgroundBrush(
         ui.frame_view->scene()->palette().base());
 
@@ -52,6 +97,8 @@ SpritePreviewer::SpritePreviewer(QWidget *parent) :
   set_zoom(2.0);
   update_zoom();
 
+  timer.setSingleShot(true);
+  timer.setTimerType(Qt::PreciseTimer);
   connect(&timer, SIGNAL(timeout()), this, SLOT(timeout()));
 
   connect(ui.start_button, SIGNAL(clicked()), this, SLOT(start()));
@@ -62,6 +109,8 @@ SpritePreviewer::SpritePreviewer(QWidget *parent) :
   connect(ui.next_button, SIGNAL(clicked()), this, SLOT(next()));
 
   connect(ui.origin_check_box, SIGNAL(clicked()), this, SLOT(update_origin()));
+  connect(ui.mode_field, SIGNAL(currentIndexChanged(int)),
+          this, SLOT(update_mode()));
 }
 
 /**
@@ -84,11 +133,23 @@ void SpritePreviewer::set_model(SpriteModel* model) {
             this, SLOT(update_selection()));
     update_selection();
 
+    connect(model, SIGNAL(animation_created(Index)),
+            this, SLOT(update_frames()));
+    connect(model, SIGNAL(animation_deleted(Index)),
+            this, SLOT(update_frames()));
+    connect(model, SIGNAL(animation_name_changed(Index,Index)),
+            this, SLOT(update_frames()));
     connect(model, SIGNAL(animation_frame_delay_changed(Index,uint32_t)),
             this, SLOT(update_frame_delay()));
     connect(model, SIGNAL(animation_image_changed(Index,QString)),
             this, SLOT(update_frames()));
 
+    connect(model, SIGNAL(direction_added(Index)),
+            this, SLOT(update_frames()));
+    connect(model, SIGNAL(direction_deleted(Index)),
+            this, SLOT(update_frames()));
+    connect(model, SIGNAL(direction_moved(Index,int)),
+            this, SLOT(update_frames()));
     connect(model, SIGNAL(direction_position_changed(Index,QPoint)),
             this, SLOT(update_frames()));
     connect(model, SIGNAL(direction_size_changed(Index,QSize)),
@@ -127,37 +188,78 @@ void SpritePreviewer::set_show_origin(bool show_origin) {
  */
 void SpritePreviewer::set_origin_color(const QColor& color) {
 
-  origin_h->setPen(QPen(color));
-  origin_v->setPen(QPen(color));
+  origin_color = color;
+  for (Cell& cell : cells) {
+    cell.origin_h->setPen(QPen(color));
+    cell.origin_v->setPen(QPen(color));
+  }
+}
+
+/**
+ * @brief Update what the previewer shows from the mode field.
+ */
+void SpritePreviewer::update_mode() {
+
+  mode = static_cast<PreviewMode>(ui.mode_field->currentData().toInt());
+  if (model != nullptr) {
+    update_selection();
+  }
 }
 
 /**
  * @brief Update the selection.
+ *
+ * Cells are only rebuilt if the directions to show have changed,
+ * so that playback continues when all animations are shown.
  */
 void SpritePreviewer::update_selection() {
 
   index = model->get_selected_index();
-  update_frames();
-  update_frame_delay();
-  update_buttons();
-  update_origin();
-
-  bool is_direction = index.is_direction_index();
-  ui.origin_check_box->setEnabled(is_direction);
-  ui.zoom_button->setEnabled(is_direction);
-
-  if (!is_direction) {
-    timer.stop();
+  if (cells.isEmpty() || !is_showing(get_previewed_directions())) {
+    update_frames();
   }
+
+  bool enable = !cells.isEmpty();
+  ui.origin_check_box->setEnabled(enable);
+  ui.zoom_button->setEnabled(enable);
 }
 
 /**
- * @brief Update the frame delay.
+ * @brief Update the frame delay of each cell.
  */
 void SpritePreviewer::update_frame_delay() {
 
-  if (timer.isActive()) {
-    timer.setInterval(model->get_animation_frame_delay(index));
+  for (Cell& cell : cells) {
+
+    const int new_frame_delay = model->get_animation_frame_delay(cell.index);
+    if (cell.next_frame_date >= 0) {
+      // Keep the date of the current frame and apply the new delay from there.
+      if (new_frame_delay > 0) {
+        cell.next_frame_date += new_frame_delay - cell.frame_delay;
+      }
+      else {
+        cell.next_frame_date = -1;
+      }
+    }
+    cell.frame_delay = new_frame_delay;
+  }
+
+  if (!is_playing()) {
+    return;
+  }
+
+  frame_delay = 0;
+  for (const Cell& cell : cells) {
+    if (cell.next_frame_date >= 0 &&
+        (frame_delay == 0 || cell.frame_delay < frame_delay)) {
+      frame_delay = cell.frame_delay;
+    }
+  }
+
+  num_frames_displayed = 0;
+  frame_rate_start_date = clock.elapsed();
+  if (!schedule_next_frame()) {
+    pause();
   }
 }
 
@@ -166,11 +268,17 @@ void SpritePreviewer::update_frame_delay() {
  */
 void SpritePreviewer::update_buttons() {
 
-  bool start_enabled  = index.is_direction_index();
-  bool active = timer.isActive();
-  bool first_enabled = start_enabled && !active && current_frame > 0;
-  bool last_enabled =
-      start_enabled && !active && current_frame < frames.size() - 1;
+  bool start_enabled = !cells.isEmpty();
+  bool active = is_playing();
+  bool first_enabled = false;
+  bool last_enabled = false;
+  if (start_enabled && !active) {
+    for (const Cell& cell : cells) {
+      first_enabled = first_enabled || cell.current_frame > 0;
+      last_enabled = last_enabled ||
+          cell.current_frame < cell.frames.size() - 1;
+    }
+  }
 
   ui.start_button->setEnabled(start_enabled);
   ui.stop_button->setEnabled(start_enabled && active);
@@ -191,76 +299,357 @@ void SpritePreviewer::update_buttons() {
 }
 
 /**
- * @brief Update the frames of the selected direction.
+ * @brief Returns the directions to show in the current mode.
+ * @return The directions to show, by row.
+ */
+QList<QList<SpriteModel::Index>> SpritePreviewer::get_previewed_directions() const {
+
+  const auto& get_directions = [this](const QString& animation_name) {
+    QList<SpriteModel::Index> directions;
+    const int num_directions = model->get_animation_num_directions(
+          SpriteModel::Index(animation_name));
+    for (int i = 0; i < num_directions; ++i) {
+      directions << SpriteModel::Index(animation_name, i);
+    }
+    return directions;
+  };
+
+  QList<QList<SpriteModel::Index>> rows;
+  switch (mode) {
+
+  case PreviewMode::DIRECTION:
+    if (index.is_direction_index()) {
+      rows << (QList<SpriteModel::Index>() << index);
+    }
+    break;
+
+  case PreviewMode::ANIMATION:
+    if (index.is_valid()) {
+      rows << get_directions(index.animation_name);
+    }
+    break;
+
+  case PreviewMode::SPRITE:
+    for (int i = 0; i < model->rowCount(); ++i) {
+      rows << get_directions(model->get_animation_index(i).animation_name);
+    }
+    break;
+  }
+
+  return rows;
+}
+
+/**
+ * @brief Returns whether the cells currently show some directions.
+ * @param rows Directions to show, by row.
+ * @return @c true if the cells show exactly these directions.
+ */
+bool SpritePreviewer::is_showing(const QList<QList<SpriteModel::Index>>& rows) const {
+
+  int i = 0;
+  for (const QList<SpriteModel::Index>& row : rows) {
+    for (const SpriteModel::Index& direction : row) {
+      if (i >= cells.size() ||
+          cells[i].index.animation_name != direction.animation_name ||
+          cells[i].index.direction_nb != direction.direction_nb) {
+        return false;
+      }
+      ++i;
+    }
+  }
+  return i == cells.size();
+}
+
+/**
+ * @brief Removes all cells and their items from the scene.
+ */
+void SpritePreviewer::clear_cells() {
+
+  for (const Cell& cell : cells) {
+    delete cell.item;
+    delete cell.origin_h;
+    delete cell.origin_v;
+  }
+  cells.clear();
+}
+
+/**
+ * @brief Rebuilds the grid of directions shown.
+ *
+ * Cells are all the size of the biggest frame.
+ * If the animation is playing, all cells restart from their first frame.
  */
 void SpritePreviewer::update_frames() {
 
-  frames = model->get_direction_all_frames(index);
-  current_frame = 0;
+  clear_cells();
+
+  QGraphicsScene* scene = ui.frame_view->scene();
+  QList<QPoint> cell_positions;
+  QSize cell_size(0, 0);
+  const QList<QList<SpriteModel::Index>> rows = get_previewed_directions();
+  for (int row = 0; row < rows.size(); ++row) {
+    for (int column = 0; column < rows[row].size(); ++column) {
+
+      Cell cell;
+      cell.index = rows[row][column];
+      cell.frames = model->get_direction_all_frames(cell.index);
+      cell.current_frame = 0;
+      cell.frame_delay = model->get_animation_frame_delay(cell.index);
+      cell.next_frame_date = -1;
+      cell.item = new FrameItem();
+      cell.origin_h = new QGraphicsLineItem();
+      cell.origin_v = new QGraphicsLineItem();
+      cell.origin_h->setPen(QPen(origin_color));
+      cell.origin_v->setPen(QPen(origin_color));
+      scene->addItem(cell.item);
+      scene->addItem(cell.origin_h);
+      scene->addItem(cell.origin_v);
+
+      if (!cell.frames.isEmpty()) {
+        cell_size = cell_size.expandedTo(cell.frames.first().rect.size());
+      }
+      cells << cell;
+      cell_positions << QPoint(column, row);
+    }
+  }
+
+  // Lay out the grid.
+  const int spacing = cells.size() > 1 ? 8 : 0;
+  for (int i = 0; i < cells.size(); ++i) {
+    const QPoint position(
+          cell_positions[i].x() * (cell_size.width() + spacing),
+          cell_positions[i].y() * (cell_size.height() + spacing));
+    cells[i].item->setPos(position);
+    cells[i].origin_h->setPos(position);
+    cells[i].origin_v->setPos(position);
+  }
+  scene->setSceneRect(QRectF(QPointF(0, 0), scene->itemsBoundingRect().size()));
+
   update_frame();
+  update_origin();
+
+  if (is_playing() && !start_cells()) {
+    pause();
+  }
+  update_buttons();
 }
 
 /**
- * @brief Update the displayed frame.
+ * @brief Update the displayed frame of each cell.
  */
 void SpritePreviewer::update_frame() {
 
-  QPixmap pixmap;
-  int nb_frames = frames.size();
-
-  if (current_frame < nb_frames) {
-    pixmap = frames[current_frame];
+  for (Cell& cell : cells) {
+    SpriteModel::Frame frame;
+    if (cell.current_frame < cell.frames.size()) {
+      frame = cell.frames[cell.current_frame];
+    }
+    cell.item->set_frame(frame);
   }
-  item->setPixmap(pixmap);
 
+  update_frame_label();
+}
+
+/**
+ * @brief Update the index of the current frame displayed.
+ *
+ * In a grid, this is the current frame of the first cell.
+ */
+void SpritePreviewer::update_frame_label() {
+
+  int current_frame = 0;
+  int nb_frames = 0;
+  if (!cells.isEmpty()) {
+    current_frame = cells.first().current_frame;
+    nb_frames = cells.first().frames.size();
+  }
   QString size_str = QString::number(nb_frames > 0 ? nb_frames - 1 : 0);
   ui.frame_label->setText(QString::number(current_frame) + " / " + size_str);
 }
 
 /**
- * @brief Update the displayed origin.
+ * @brief Update the frame rate displayed.
+ *
+ * Shows the number of frames actually displayed per second compared to the
+ * frame rate of the fastest animation.
+ */
+void SpritePreviewer::update_frame_rate() {
+
+  if (!is_playing() || frame_delay <= 0) {
+    ui.frame_rate_label->clear();
+    return;
+  }
+
+  const double expected_rate = 1000.0 / frame_delay;
+  const double elapsed_seconds = (clock.elapsed() - frame_rate_start_date) / 1000.0;
+  const double actual_rate = num_frames_displayed > 0 && elapsed_seconds > 0.0 ?
+        num_frames_displayed / elapsed_seconds : expected_rate;
+  ui.frame_rate_label->setText(tr("%1 / %2 fps").
+                               arg(actual_rate, 0, 'f', 1).
+                               arg(expected_rate, 0, 'f', 1));
+}
+
+/**
+ * @brief Update the displayed origin of each cell.
  */
 void SpritePreviewer::update_origin() {
 
-  bool show_origin = ui.origin_check_box->isChecked() && frames.size() > 0;
+  const bool show_origin = ui.origin_check_box->isChecked();
 
-  origin_h->setVisible(show_origin);
-  origin_v->setVisible(show_origin);
+  for (Cell& cell : cells) {
 
-  if (!show_origin) {
-    return;
+    const bool visible = show_origin && !cell.frames.isEmpty();
+    cell.origin_h->setVisible(visible);
+    cell.origin_v->setVisible(visible);
+
+    if (!visible) {
+      continue;
+    }
+
+    QRect rect(QPoint(0, 0), cell.frames.first().rect.size());
+    QPoint origin = model->get_direction_origin(cell.index);
+
+    cell.origin_h->setLine(0, origin.y(), rect.width(), origin.y());
+    cell.origin_v->setLine(origin.x(), 0, origin.x(), rect.height());
   }
+}
 
-  QRect rect = frames[0].rect();
-  QPoint origin = model->get_direction_origin(index);
+/**
+ * @brief Returns whether the animation is being played.
+ * @return @c true if the animation is playing.
+ */
+bool SpritePreviewer::is_playing() const {
+  return clock.isValid();
+}
 
-  origin_h->setLine(0, origin.y(), rect.width(), origin.y());
-  origin_v->setLine(origin.x(), 0, origin.x(), rect.height());
+/**
+ * @brief Schedules the first frame change of each cell from now.
+ * @return @c true if at least one cell is animated.
+ */
+bool SpritePreviewer::start_cells() {
+
+  const qint64 now = clock.elapsed();
+  frame_delay = 0;
+  for (Cell& cell : cells) {
+    if (cell.frame_delay <= 0 || cell.frames.isEmpty()) {
+      cell.next_frame_date = -1;
+      continue;
+    }
+    cell.next_frame_date = now + cell.frame_delay;
+    if (frame_delay == 0 || cell.frame_delay < frame_delay) {
+      frame_delay = cell.frame_delay;
+    }
+  }
+
+  num_frames_displayed = 0;
+  frame_rate_start_date = now;
+  return schedule_next_frame();
 }
 
 /**
- * @brief Slot called when the timer timeout signal is emit.
+ * @brief Starts the timer to wake up when the next frame of a cell is due.
+ * @return @c false if no cell is playing anymore.
  */
-void SpritePreviewer::timeout() {
+bool SpritePreviewer::schedule_next_frame() {
+
+  qint64 next_frame_date = -1;
+  for (const Cell& cell : cells) {
+    if (cell.next_frame_date >= 0 &&
+        (next_frame_date < 0 || cell.next_frame_date < next_frame_date)) {
+      next_frame_date = cell.next_frame_date;
+    }
+  }
+
+  if (next_frame_date < 0) {
+    timer.stop();
+    return false;
+  }
 
-  int next_frame = current_frame + 1;
+  timer.start(static_cast<int>(qMax(qint64(0), next_frame_date - clock.elapsed())));
+  return true;
+}
+
+/**
+ * @brief Moves a cell to the frame it should display at a date.
+ *
+ * Like the engine, frames are scheduled on a monotonic clock:
+ * if the previewer was late, frames that should already be finished are
+ * skipped so that the animation does not drift from real time.
+ *
+ * @param cell The cell to update.
+ * @param now The current date on the clock.
+ */
+void SpritePreviewer::advance_cell(Cell& cell, qint64 now) {
 
-  if (next_frame >= frames.size()) {
-    int loop_on_frame = model->get_animation_loop_on_frame(index);
-    if (loop_on_frame >= 0) {
-      next_frame = loop_on_frame;
+  if (cell.next_frame_date < 0) {
+    return;
+  }
+
+  const int loop_on_frame = model->get_animation_loop_on_frame(cell.index);
+  const int previous_frame = cell.current_frame;
+  while (cell.next_frame_date >= 0 && now >= cell.next_frame_date) {
+
+    int next_frame = cell.current_frame + 1;
+    if (next_frame >= cell.frames.size()) {
+      if (loop_on_frame >= 0 && loop_on_frame < cell.frames.size()) {
+        next_frame = loop_on_frame;
+      } else {
+        next_frame = cell.current_frame;
+      }
+    }
+
+    if (next_frame == cell.current_frame) {
+      // The animation is finished.
+      cell.next_frame_date = -1;
     } else {
-      next_frame = current_frame;
+      cell.current_frame = next_frame;
+      cell.next_frame_date += cell.frame_delay;
     }
   }
 
-  if (next_frame == current_frame) {
-    timer.stop();
-  } else {
-    current_frame = next_frame;
+  if (cell.current_frame != previous_frame) {
+    cell.item->set_frame(cell.frames[cell.current_frame]);
   }
+}
 
-  update_frame();
+/**
+ * @brief Slot called when the next frame of a cell is due.
+ *
+ * All cells due are updated in the same tick, so that the scene repaints
+ * them at once.
+ */
+void SpritePreviewer::timeout() {
+
+  if (!is_playing()) {
+    return;
+  }
+
+  const qint64 now = clock.elapsed();
+  for (Cell& cell : cells) {
+    advance_cell(cell, now);
+  }
+
+  ++num_frames_displayed;
+  update_frame_label();
+  update_frame_rate();
+
+  if (!schedule_next_frame()) {
+    pause();
+  }
+  update_buttons();
+}
+
+/**
+ * @brief Stops the clock without changing the frames displayed.
+ */
+void SpritePreviewer::pause() {
+
+  timer.stop();
+  clock.invalidate();
+  for (Cell& cell : cells) {
+    cell.next_frame_date = -1;
+  }
+  update_frame_rate();
   update_buttons();
 }
 
@@ -269,13 +658,19 @@ void SpritePreviewer::timeout() {
  */
 void SpritePreviewer::start() {
 
-  if (timer.isActive()) {
-    timer.stop();
+  if (is_playing()) {
+    pause();
     update_frame();
-    update_buttons();
   } else {
-    int frame_delay = model->get_animation_frame_delay(index);
-    timer.start(frame_delay);
+    // Frames share the animation pixmap, which is now already decoded.
+    clock.start();
+    if (!start_cells()) {
+      // Nothing to animate.
+      clock.invalidate();
+      return;
+    }
+    update_frame_rate();
+    update_buttons();
   }
 }
 
@@ -284,8 +679,10 @@ void SpritePreviewer::start() {
  */
 void SpritePreviewer::stop() {
 
-  timer.stop();
-  current_frame = 0;
+  pause();
+  for (Cell& cell : cells) {
+    cell.current_frame = 0;
+  }
   update_frame();
   update_buttons();
 }
@@ -295,7 +692,9 @@ void SpritePreviewer::stop() {
  */
 void SpritePreviewer::first() {
 
-  current_frame = 0;
+  for (Cell& cell : cells) {
+    cell.current_frame = 0;
+  }
   update_frame();
   update_buttons();
 }
@@ -305,11 +704,11 @@ void SpritePreviewer::first() {
  */
 void SpritePreviewer::previous() {
 
-  if (current_frame <= 0) {
-    return;
+  for (Cell& cell : cells) {
+    if (cell.current_frame > 0) {
+      cell.current_frame--;
+    }
   }
-
-  current_frame--;
   update_frame();
   update_buttons();
 }
@@ -319,8 +718,10 @@ void SpritePreviewer::previous() {
  */
 void SpritePreviewer::last() {
 
-  int nb_frames = frames.size();
-  current_frame = nb_frames > 0 ? nb_frames - 1 : 0;
+  for (Cell& cell : cells) {
+    int nb_frames = cell.frames.size();
+    cell.current_frame = nb_frames > 0 ? nb_frames - 1 : 0;
+  }
   update_frame();
   update_buttons();
 }
@@ -330,11 +731,11 @@ void SpritePreviewer::last() {
  */
 void SpritePreviewer::next() {
 
-  if (current_frame + 1 >= frames.size()) {
-    return;
+  for (Cell& cell : cells) {
+    if (cell.current_frame + 1 < cell.frames.size()) {
+      cell.current_frame++;
+    }
   }
-
-  current_frame++;
   update_frame();
   update_buttons();
 }
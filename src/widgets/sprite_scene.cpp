@@ -355,19 +355,16 @@ void DirectionItem::paint(QPainter* painter,
 
   // First, paint the item like if there was no selection, to avoid
   // Qt's built-in selection marker.
-  QList<QRect> frames = model.get_direction_frames(index);
-  QList<QPixmap> pixmaps = model.get_direction_all_frames(index);
+  const QList<SpriteModel::Frame>& frames = model.get_direction_all_frames(index);
 
-  for (int i = 0; i < frames.size() && i < pixmaps.size(); i++) {
+  for (const SpriteModel::Frame& frame : frames) {
 
-    QRect& frame = frames[i];
-    frame.translate(-top_left);
-
-    painter->drawPixmap(frame, pixmaps[i]);
+    const QRect& target = frame.rect.translated(-top_left);
+    painter->drawPixmap(target, frame.pixmap, frame.rect);
 
     // Add our selection marker if is selected.
     if (selected) {
-      GuiTools::draw_rectangle_border(*painter, frame, Qt::blue, 1);
+      GuiTools::draw_rectangle_border(*painter, target, Qt::blue, 1);
     }
   }
 }
@@ -18,9 +18,14 @@
 #include "widgets/strings_editor.h"
 #include "widgets/new_string_dialog.h"
 #include "widgets/change_string_key_dialog.h"
+#include "widgets/refactoring_dialog.h"
 #include "editor_exception.h"
 #include "quest.h"
+#include "quest_refactoring.h"
 #include "strings_model.h"
+#include "translation_exchange.h"
+#include <QDir>
+#include <QFileDialog>
 #include <QUndoStack>
 #include <QMessageBox>
 #include <cmath>
@@ -286,6 +291,36 @@ private:
   QString new_value;
 };
 
+/**
+ * @brief Import strings from a translation file.
+ */
+class ImportStringsCommand : public StringsEditorCommand {
+
+public:
+
+  ImportStringsCommand(
+      StringsEditor& editor, const QMap<QString, QString>& values) :
+    StringsEditorCommand(editor, StringsEditor::tr("Import strings")),
+    values(values),
+    old_values() {
+  }
+
+  virtual void undo() override {
+
+    get_model().set_strings(old_values);
+  }
+
+  virtual void redo() override {
+
+    old_values = get_model().set_strings(values);
+  }
+
+private:
+
+  QMap<QString, QString> values;
+  QMap<QString, QString> old_values;
+};
+
 }
 
 /**
@@ -300,12 +335,14 @@ StringsEditor::StringsEditor(
   Editor(quest, quest.get_strings_path(language_id), parent),
   language_id(language_id),
   model(nullptr),
-  quest(quest) {
+  quest(quest),
+  renamed_keys() {
 
   ui.setupUi(this);
 
   // Open the file.
   model = new StringsModel(quest, language_id, this);
+  quest.get_text_index().watch_strings_model(*model);
   get_undo_stack().setClean();
 
   // Editor properties.
@@ -365,6 +402,20 @@ StringsEditor::StringsEditor(
           this, SLOT(translation_selector_activated()));
   connect(ui.translation_refresh_button, SIGNAL(clicked()),
           this, SLOT(translation_refresh_requested()));
+  connect(ui.export_button, SIGNAL(clicked()),
+          this, SLOT(export_requested()));
+  connect(ui.import_button, SIGNAL(clicked()),
+          this, SLOT(import_requested()));
+  connect(model, SIGNAL(translation_load_failed(QString)),
+          this, SLOT(translation_load_failed(QString)));
+  connect(model, SIGNAL(translation_changed()),
+          this, SLOT(update_exchange_buttons()));
+  connect(model, SIGNAL(translation_load_failed(QString)),
+          this, SLOT(update_exchange_buttons()));
+  connect(model, SIGNAL(string_key_changed(QString,QString)),
+          this, SLOT(string_key_changed(QString,QString)));
+  connect(model, SIGNAL(string_deleted(QString)),
+          this, SLOT(string_deleted(QString)));
 }
 
 /**
@@ -386,10 +437,19 @@ StringsModel& StringsEditor::get_model() {
 
 /**
  * @copydoc Editor::save
+ *
+ * Then proposes to update references to the strings renamed since the
+ * last save.
  */
 void StringsEditor::save() {
 
   model->save();
+
+  if (!renamed_keys.isEmpty()) {
+    const QMap<QString, QString> new_keys = renamed_keys;
+    renamed_keys.clear();
+    update_string_references(new_keys);
+  }
 }
 
 /**
@@ -552,6 +612,64 @@ void StringsEditor::change_string_key_requested() {
   }
 }
 
+/**
+ * @brief Slot called when a string key has changed in the model.
+ *
+ * The renaming is remembered until the strings file is saved,
+ * so that references can be updated at this time.
+ * Undoing a renaming cancels it.
+ *
+ * @param key Old key of the string.
+ * @param new_key New key of the string.
+ */
+void StringsEditor::string_key_changed(const QString& key, const QString& new_key) {
+
+  QuestRefactoring::add_renaming(renamed_keys, key, new_key);
+}
+
+/**
+ * @brief Slot called when a string is deleted from the model.
+ * @param key Key of the string deleted.
+ */
+void StringsEditor::string_deleted(const QString& key) {
+
+  QuestRefactoring::remove_renaming(renamed_keys, key);
+}
+
+/**
+ * @brief Proposes to update references to strings that were renamed.
+ *
+ * Called after the strings file is saved.
+ * References from scripts and other languages are updated on disk.
+ *
+ * @param new_keys New key of each renamed string, indexed by old key.
+ */
+void StringsEditor::update_string_references(const QMap<QString, QString>& new_keys) {
+
+  try {
+    QuestRefactoring refactoring(quest);
+    const QList<QuestRefactoring::Change>& changes =
+        refactoring.plan_string_renaming(language_id, new_keys);
+    if (changes.isEmpty()) {
+      return;
+    }
+
+    RefactoringDialog dialog(
+          tr("Other files refer to the strings renamed. "
+             "Do you want to update them?\n"
+             "These files are saved immediately."),
+          changes,
+          this);
+    if (dialog.exec() != QDialog::Accepted) {
+      return;
+    }
+    refactoring.apply(dialog.get_selected_changes());
+  }
+  catch (const EditorException& ex) {
+    ex.show_dialog();
+  }
+}
+
 /**
  * @brief Slot called when the user wants to delete a string.
  */
@@ -649,6 +767,7 @@ void StringsEditor::translation_selector_activated() {
   // Set the translation.
   model->set_translation_id(new_language_id);
   ui.translation_refresh_button->setEnabled(true);
+  update_exchange_buttons();
 }
 
 /**
@@ -659,6 +778,160 @@ void StringsEditor::translation_refresh_requested() {
     return;
   }
   model->reload_translation();
+  update_exchange_buttons();
+}
+
+/**
+ * @brief Enables or disables exporting and importing.
+ *
+ * They are disabled while the translation is being loaded,
+ * because exports use translated strings as source texts.
+ */
+void StringsEditor::update_exchange_buttons() {
+
+  const bool enable = !model->is_loading_translation();
+  ui.export_button->setEnabled(enable);
+  ui.import_button->setEnabled(enable);
+}
+
+/**
+ * @brief Slot called when the user wants to export strings for translators.
+ *
+ * If a language is selected for comparison, its strings are exported as
+ * the source texts and the user can choose to only export strings that are
+ * not translated yet, that is, missing, empty or identical to the source.
+ */
+void StringsEditor::export_requested() {
+
+  if (model->is_loading_translation()) {
+    return;
+  }
+
+  const QString& reference_id = model->get_translation_id();
+  bool only_untranslated = false;
+  if (!reference_id.isEmpty()) {
+    QMessageBox::StandardButton answer = QMessageBox::question(
+          this,
+          tr("Export strings"),
+          tr("Only export the strings of language '%1' that are missing, "
+             "empty or identical in this language?").arg(reference_id),
+          QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+    if (answer == QMessageBox::Cancel) {
+      return;
+    }
+    only_untranslated = (answer == QMessageBox::Yes);
+  }
+
+  const QString& path = QFileDialog::getSaveFileName(
+        this,
+        tr("Export strings"),
+        QDir(quest.get_root_path()).filePath(QString("strings_%1.po").arg(language_id)),
+        TranslationExchange::get_file_filters());
+  if (path.isEmpty()) {
+    return;
+  }
+
+  try {
+    QStringList keys = model->get_keys("");
+    if (!reference_id.isEmpty()) {
+      keys = model->get_translated_keys("");
+      if (!only_untranslated) {
+        keys << model->get_keys("");
+        keys.removeDuplicates();
+      }
+    }
+    keys.sort();
+
+    TranslationExchange::Writer writer(
+          path,
+          reference_id.isEmpty() ? language_id : reference_id,
+          reference_id.isEmpty() ? QString() : language_id,
+          "strings.dat");
+    Q_FOREACH (const QString& key, keys) {
+      TranslationExchange::Unit unit;
+      unit.id = key;
+      if (reference_id.isEmpty()) {
+        unit.source = model->get_string(key);
+      }
+      else {
+        unit.source = model->get_translated_string(key);
+        unit.target = model->get_string(key);
+        if (only_untranslated &&
+            !unit.target.isEmpty() &&
+            unit.target != unit.source) {
+          continue;
+        }
+      }
+      writer.write_unit(unit);
+    }
+    writer.commit();
+    GuiTools::information_dialog(
+          tr("%1 string(s) exported").arg(writer.get_num_units()));
+  }
+  catch (const EditorException& ex) {
+    ex.show_dialog();
+  }
+}
+
+/**
+ * @brief Slot called when the user wants to import translated strings.
+ *
+ * Strings of the file that have a translation are created or changed
+ * in one undoable action.
+ */
+void StringsEditor::import_requested() {
+
+  if (model->is_loading_translation()) {
+    return;
+  }
+
+  const QString& path = QFileDialog::getOpenFileName(
+        this,
+        tr("Import strings"),
+        quest.get_root_path(),
+        TranslationExchange::get_file_filters());
+  if (path.isEmpty()) {
+    return;
+  }
+
+  QMap<QString, QString> values;
+  try {
+    Q_FOREACH (const TranslationExchange::Unit& unit,
+               TranslationExchange::read_file(path)) {
+      if (unit.target.isEmpty() ||
+          !StringsModel::is_valid_key(unit.id) ||
+          model->get_string(unit.id) == unit.target) {
+        continue;
+      }
+      values.insert(unit.id, unit.target);
+    }
+  }
+  catch (const EditorException& ex) {
+    ex.show_dialog();
+    return;
+  }
+
+  if (values.isEmpty()) {
+    GuiTools::information_dialog(tr("No new or changed string in this file"));
+    return;
+  }
+
+  if (try_command(new ImportStringsCommand(*this, values))) {
+    GuiTools::information_dialog(
+          tr("%1 string(s) imported").arg(values.size()));
+  }
+}
+
+/**
+ * @brief Slot called when the translation language could not be loaded.
+ * @param message The error message.
+ */
+void StringsEditor::translation_load_failed(const QString& message) {
+
+  ui.translation_field->set_selected_id("");
+  ui.strings_tree_view->setColumnHidden(2, true);
+  ui.translation_refresh_button->setEnabled(false);
+  EditorException(message).show_dialog();
 }
 
 }
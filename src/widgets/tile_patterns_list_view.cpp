@@ -17,6 +17,7 @@
 #include "widgets/tile_patterns_list_view.h"
 #include "tileset_model.h"
 #include <QAction>
+#include <QScrollBar>
 
 namespace SolarusEditor {
 
@@ -25,7 +26,8 @@ namespace SolarusEditor {
  * @param parent The parent object or nullptr.
  */
 TilePatternsListView::TilePatternsListView(QWidget* parent) :
-  QListView(parent) {
+  QListView(parent),
+  model(nullptr) {
 
   setIconSize(QSize(32, 32));
   setUniformItemSizes(true);
@@ -50,6 +52,10 @@ TilePatternsListView::TilePatternsListView(QWidget* parent) :
           this, SIGNAL(change_selected_pattern_id_requested()));
   addAction(action);
 
+  connect(verticalScrollBar(), SIGNAL(valueChanged(int)),
+          this, SLOT(request_visible_icons()));
+  connect(horizontalScrollBar(), SIGNAL(valueChanged(int)),
+          this, SLOT(request_visible_icons()));
 }
 
 /**
@@ -61,6 +67,73 @@ void TilePatternsListView::set_model(TilesetModel& model) {
   QListView::setModel(&model);
   selectionModel()->deleteLater();
   setSelectionModel(&model.get_selection_model());
+
+  this->model = &model;
+  connect(&model, SIGNAL(modelReset()),
+          this, SLOT(request_visible_icons()));
+  connect(&model, SIGNAL(rowsInserted(QModelIndex, int, int)),
+          this, SLOT(request_visible_icons()));
+  request_visible_icons();
+}
+
+/**
+ * @brief Receives a resize event.
+ * @param event The event to handle.
+ */
+void TilePatternsListView::resizeEvent(QResizeEvent* event) {
+
+  QListView::resizeEvent(event);
+  request_visible_icons();
+}
+
+/**
+ * @brief Asks the model to build icons of the patterns currently visible.
+ *
+ * Patterns are laid out in reading order, so the visible ones are found
+ * by a binary search on their position.
+ * The model also builds icons of neighbor patterns in advance.
+ */
+void TilePatternsListView::request_visible_icons() {
+
+  if (model == nullptr) {
+    return;
+  }
+
+  const int num_patterns = model->rowCount();
+  if (num_patterns == 0) {
+    return;
+  }
+
+  const int viewport_height = viewport()->height();
+
+  // First pattern whose bottom is visible.
+  int low = 0;
+  int high = num_patterns;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (visualRect(model->index(middle)).bottom() < 0) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  const int first = qMin(low, num_patterns - 1);
+
+  // First pattern whose top is below the viewport.
+  high = num_patterns;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (visualRect(model->index(middle)).top() < viewport_height) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  const int last = qMax(first, low - 1);
+
+  model->request_pattern_icons(first, last);
 }
 
 }
@@ -14,13 +14,17 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "widgets/auto_slice_dialog.h"
 #include "widgets/change_pattern_id_dialog.h"
 #include "widgets/gui_tools.h"
 #include "widgets/tileset_editor.h"
 #include "editor_exception.h"
 #include "quest.h"
+#include "quest_index.h"
+#include "quest_refactoring.h"
 #include "quest_resources.h"
 #include "tileset_model.h"
+#include <QApplication>
 #include <QColorDialog>
 #include <QFile>
 #include <QInputDialog>
@@ -377,6 +381,45 @@ private:
 
 };
 
+/**
+ * @brief Creating several tile patterns at once.
+ */
+class CreatePatternsCommand : public TilesetEditorCommand {
+
+public:
+
+  CreatePatternsCommand(TilesetEditor& editor, const QMap<QString, QRect>& frames,
+                        Ground ground) :
+    TilesetEditorCommand(editor, TilesetEditor::tr("Create patterns")),
+    frames(frames),
+    ground(ground) {
+  }
+
+  virtual void undo() override {
+
+    QList<int> indexes;
+    Q_FOREACH (const QString& pattern_id, frames.keys()) {
+      indexes << get_model().id_to_index(pattern_id);
+    }
+    get_model().delete_patterns(indexes);
+  }
+
+  virtual void redo() override {
+
+    const QList<int>& indexes = get_model().create_patterns(frames);
+    Q_FOREACH (int index, indexes) {
+      get_model().set_pattern_ground(index, ground);
+    }
+    get_model().set_selected_indexes(indexes);
+  }
+
+private:
+
+  QMap<QString, QRect> frames;
+  Ground ground;
+
+};
+
 /**
  * @brief Deleting tile patterns.
  */
@@ -402,8 +445,14 @@ public:
 
   virtual void undo() override {
 
+    QMap<QString, QRect> frames;
     Q_FOREACH (const Pattern& pattern, patterns) {
-      int index = get_model().create_pattern(pattern.id, pattern.frames_bounding_box);
+      frames.insert(pattern.id, pattern.frames_bounding_box);
+    }
+    get_model().create_patterns(frames);
+
+    Q_FOREACH (const Pattern& pattern, patterns) {
+      int index = get_model().id_to_index(pattern.id);
       get_model().set_pattern_ground(index, pattern.ground);
       get_model().set_pattern_default_layer(index, pattern.default_layer);
       get_model().set_pattern_animation(index, pattern.animation);
@@ -443,6 +492,52 @@ private:
 
 };
 
+/**
+ * @brief Replacing the tileset image by a packed one.
+ */
+class RepackPatternsImageCommand : public TilesetEditorCommand {
+
+public:
+
+  RepackPatternsImageCommand(
+      TilesetEditor& editor, const QImage& image_after, const QList<QPoint>& positions_after) :
+    TilesetEditorCommand(editor, TilesetEditor::tr("Repack image")),
+    image_before(get_model().get_patterns_image()),
+    image_after(image_after) {
+
+    for (int i = 0; i < get_model().get_num_patterns(); ++i) {
+      const QString& pattern_id = get_model().index_to_id(i);
+      positions_before.insert(pattern_id, get_model().get_pattern_frame(i).topLeft());
+      positions_after_by_id.insert(pattern_id, positions_after.value(i));
+    }
+  }
+
+  virtual void undo() override {
+    apply(image_before, positions_before);
+  }
+
+  virtual void redo() override {
+    apply(image_after, positions_after_by_id);
+  }
+
+private:
+
+  void apply(const QImage& image, const QMap<QString, QPoint>& positions) {
+
+    // Change the image first so that pattern items get the new pixels.
+    get_model().set_patterns_image(image);
+    for (auto it = positions.constBegin(); it != positions.constEnd(); ++it) {
+      get_model().set_pattern_position(get_model().id_to_index(it.key()), it.value());
+    }
+  }
+
+  QImage image_before;
+  QImage image_after;
+  QMap<QString, QPoint> positions_before;
+  QMap<QString, QPoint> positions_after_by_id;
+
+};
+
 /**
  * @brief Changing the id of a tile pattern.
  */
@@ -544,6 +639,8 @@ TilesetEditor::TilesetEditor(Quest& quest, const QString& path, QWidget* parent)
           this, SLOT(change_selected_pattern_id_requested()));
   connect(model, SIGNAL(pattern_id_changed(int, QString, int, QString)),
           this, SLOT(update_pattern_id_field()));
+  connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex, QVector<int>)),
+          this, SLOT(update_pattern_usage_field()));
 
   connect(ui.tileset_view, SIGNAL(change_selected_pattern_position_requested(QPoint)),
           this, SLOT(change_selected_pattern_position_requested(QPoint)));
@@ -596,6 +693,16 @@ TilesetEditor::TilesetEditor(Quest& quest, const QString& path, QWidget* parent)
           this, SLOT(delete_selected_patterns_requested()));
   connect(ui.tileset_view, SIGNAL(delete_selected_patterns_requested()),
           this, SLOT(delete_selected_patterns_requested()));
+  connect(ui.delete_unused_patterns_button, SIGNAL(clicked()),
+          this, SLOT(delete_unused_patterns_requested()));
+  connect(ui.repack_image_button, SIGNAL(clicked()),
+          this, SLOT(repack_image_requested()));
+  connect(ui.merge_duplicates_button, SIGNAL(clicked()),
+          this, SLOT(merge_duplicate_patterns_requested()));
+  connect(ui.auto_slice_button, SIGNAL(clicked()),
+          this, SLOT(auto_slice_requested()));
+  connect(model, SIGNAL(modelReset()),
+          this, SLOT(update_num_patterns_field()));
 
   connect(&model->get_selection_model(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
           this, SLOT(update_pattern_view()));
@@ -746,6 +853,7 @@ void TilesetEditor::set_description_from_gui() {
 void TilesetEditor::update_pattern_view() {
 
   update_pattern_id_field();
+  update_pattern_usage_field();
   update_ground_field();
   update_animation_type_field();
   update_animation_separation_field();
@@ -785,6 +893,26 @@ void TilesetEditor::update_pattern_id_field() {
   ui.pattern_id_field->setEnabled(enable);
 }
 
+/**
+ * @brief Updates the pattern usage field from the quest index.
+ *
+ * Shows how many tiles of all maps use the selected patterns.
+ */
+void TilesetEditor::update_pattern_usage_field() {
+
+  const QList<int>& indexes = model->get_selected_indexes();
+  int num_tiles = 0;
+  Q_FOREACH (int index, indexes) {
+    num_tiles += model->get_pattern_usage(index);
+  }
+
+  bool enable = !indexes.isEmpty();
+  ui.pattern_usage_label->setEnabled(enable);
+  ui.pattern_usage_field->setEnabled(enable);
+  ui.pattern_usage_field->setText(
+        enable ? tr("Used by %n tile(s)", "", num_tiles) : QString());
+}
+
 /**
  * @brief Slot called when the user wants to change the id of the selected
  * pattern.
@@ -1200,4 +1328,230 @@ void TilesetEditor::delete_selected_patterns_requested() {
   try_command(new DeletePatternsCommand(*this, indexes));
 }
 
+/**
+ * @brief Slot called when the user wants to delete patterns used by no map.
+ *
+ * The quest index is updated first so that recent map changes saved to
+ * disk are taken into account.
+ */
+void TilesetEditor::delete_unused_patterns_requested() {
+
+  get_quest().get_index().update_all();
+
+  QList<int> indexes = model->get_unused_pattern_indexes();
+  if (indexes.empty()) {
+    QMessageBox::information(
+          this,
+          tr("Delete unused patterns"),
+          tr("All patterns of this tileset are used by at least one map."));
+    return;
+  }
+
+  QMessageBox::StandardButton answer = QMessageBox::question(
+        this,
+        tr("Delete confirmation"),
+        tr("%1 of %2 patterns are used by no map. Do you really want to delete them?\n"
+           "Tiles created by scripts and unsaved changes of open maps are not taken into account.").
+        arg(indexes.size()).arg(model->get_num_patterns()),
+        QMessageBox::Yes | QMessageBox::No);
+
+  if (answer != QMessageBox::Yes) {
+    return;
+  }
+
+  try_command(new DeletePatternsCommand(*this, indexes));
+}
+
+/**
+ * @brief Slot called when the user wants to remove empty space from the
+ * tileset image.
+ *
+ * Patterns are packed into a smaller image. Maps are not affected because
+ * they refer to patterns by id.
+ */
+void TilesetEditor::repack_image_requested() {
+
+  const QImage& image_before = model->get_patterns_image();
+  if (image_before.isNull()) {
+    GuiTools::error_dialog(tr("Missing tileset image"));
+    return;
+  }
+
+  QList<QPoint> positions;
+  QImage image_after;
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  image_after = model->build_packed_patterns_image(positions);
+  QApplication::restoreOverrideCursor();
+  if (image_after.isNull()) {
+    GuiTools::information_dialog(tr("This tileset has no pattern"));
+    return;
+  }
+
+  const int area_before = image_before.width() * image_before.height();
+  const int area_after = image_after.width() * image_after.height();
+  if (area_after >= area_before) {
+    GuiTools::information_dialog(
+          tr("The tileset image is already compact (%1x%2).").
+          arg(image_before.width()).arg(image_before.height()));
+    return;
+  }
+
+  QMessageBox::StandardButton answer = QMessageBox::question(
+        this,
+        tr("Repack image"),
+        tr("The tileset image can be reduced from %1x%2 (%3 pixels) to %4x%5 (%6 pixels, %7% smaller).\n"
+           "Pixels that do not belong to any pattern will be lost when saving the tileset.\n"
+           "Do you want to repack the image?").
+        arg(image_before.width()).arg(image_before.height()).arg(area_before).
+        arg(image_after.width()).arg(image_after.height()).arg(area_after).
+        arg(100 - (100 * qint64(area_after)) / area_before),
+        QMessageBox::Yes | QMessageBox::No);
+
+  if (answer != QMessageBox::Yes) {
+    return;
+  }
+
+  try_command(new RepackPatternsImageCommand(*this, image_after, positions));
+}
+
+/**
+ * @brief Slot called when the user wants to merge patterns that have the
+ * same image.
+ *
+ * In each group of duplicates, the pattern used by the most tiles is kept.
+ * Tiles using the other ones are changed in all maps, then the other
+ * patterns are deleted.
+ * Like changing a pattern id with reference updates, this is not undoable.
+ */
+void TilesetEditor::merge_duplicate_patterns_requested() {
+
+  if (get_quest().is_resource_element_open(ResourceType::MAP)) {
+    // Maps need to be closed before modifying them.
+    QMessageBox::warning(
+          this,
+          tr("Merge duplicate patterns"),
+          tr("Please close all maps before updating tile pattern references."));
+    return;
+  }
+
+  bool ok = false;
+  const int tolerance = QInputDialog::getInt(
+        this,
+        tr("Merge duplicate patterns"),
+        tr("Maximum color difference (0 for identical images only):"),
+        0, 0, 255, 1, &ok);
+  if (!ok) {
+    return;
+  }
+
+  QuestIndex& index = get_quest().get_index();
+  index.update_all();
+
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  const QList<QList<int>>& groups = model->find_duplicate_patterns(tolerance);
+  QApplication::restoreOverrideCursor();
+
+  if (groups.isEmpty()) {
+    GuiTools::information_dialog(tr("No duplicate patterns found"));
+    return;
+  }
+
+  // Keep the most used pattern of each group.
+  QMap<QString, QString> new_pattern_ids;
+  QList<int> indexes_to_delete;
+  QStringList details;
+  Q_FOREACH (const QList<int>& group, groups) {
+    int kept_index = group.first();
+    Q_FOREACH (int pattern_index, group) {
+      if (model->get_pattern_usage(pattern_index) > model->get_pattern_usage(kept_index)) {
+        kept_index = pattern_index;
+      }
+    }
+
+    const QString& kept_id = model->index_to_id(kept_index);
+    QStringList merged_ids;
+    Q_FOREACH (int pattern_index, group) {
+      if (pattern_index != kept_index) {
+        const QString& pattern_id = model->index_to_id(pattern_index);
+        new_pattern_ids.insert(pattern_id, kept_id);
+        indexes_to_delete << pattern_index;
+        merged_ids << pattern_id;
+      }
+    }
+    details << tr("%1 <- %2").arg(kept_id, merged_ids.join(", "));
+  }
+
+  model->set_selected_indexes(indexes_to_delete);
+
+  QMessageBox message_box(
+        QMessageBox::Question,
+        tr("Merge duplicate patterns"),
+        tr("%1 patterns are duplicates of other ones (selected).\n"
+           "Do you want to replace them in all maps and delete them?\n"
+           "The tileset will be saved and this cannot be undone.").
+        arg(indexes_to_delete.size()),
+        QMessageBox::Yes | QMessageBox::No,
+        this);
+  message_box.setDetailedText(details.join('\n'));
+  if (message_box.exec() != QMessageBox::Yes) {
+    return;
+  }
+
+  try {
+    // Update maps first: if anything fails, no file is modified.
+    QuestRefactoring refactoring(get_quest());
+    refactoring.apply(refactoring.plan_pattern_renaming(
+                        model->get_tileset_id(), new_pattern_ids));
+
+    // Delete duplicates, save the tileset and clear the undo history.
+    model->delete_patterns(indexes_to_delete);
+    save();
+    get_undo_stack().clear();
+  }
+  catch (const EditorException& ex) {
+    ex.show_dialog();
+  }
+}
+
+/**
+ * @brief Slot called when the user wants to create patterns automatically
+ * from the non-empty areas of the tileset image.
+ */
+void TilesetEditor::auto_slice_requested() {
+
+  if (model->get_patterns_image().isNull()) {
+    GuiTools::error_dialog(tr("Missing tileset image"));
+    return;
+  }
+
+  AutoSliceDialog dialog(this);
+  if (dialog.exec() != QDialog::Accepted) {
+    return;
+  }
+
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  const QList<QRect>& areas = model->find_unused_image_areas(
+        dialog.get_cell_size(), dialog.get_merge_connected());
+  QApplication::restoreOverrideCursor();
+
+  if (areas.isEmpty()) {
+    GuiTools::information_dialog(tr("No new pattern found in the tileset image"));
+    return;
+  }
+
+  // Give integer ids to new patterns, like when creating them one by one.
+  QMap<QString, QRect> frames;
+  int last_integer_pattern_id = 0;
+  Q_FOREACH (const QRect& area, areas) {
+    QString pattern_id;
+    do {
+      ++last_integer_pattern_id;
+      pattern_id = QString::number(last_integer_pattern_id);
+    } while (model->id_to_index(pattern_id) != -1);
+    frames.insert(pattern_id, area);
+  }
+
+  try_command(new CreatePatternsCommand(*this, frames, dialog.get_ground()));
+}
+
 }
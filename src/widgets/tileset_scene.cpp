@@ -69,7 +69,8 @@ private:
  */
 TilesetScene::TilesetScene(TilesetModel& model, QObject* parent) :
   QGraphicsScene(parent),
-  model(model) {
+  model(model),
+  num_chunk_columns(0) {
 
   build();
 
@@ -86,6 +87,10 @@ TilesetScene::TilesetScene(TilesetModel& model, QObject* parent) :
           this, SLOT(update_pattern_animation(int)));
   connect(&model, SIGNAL(pattern_separation_changed(int, PatternSeparation)),
           this, SLOT(update_pattern_animation(int)));
+  connect(&model, SIGNAL(patterns_image_changed()),
+          this, SLOT(update_patterns_image()));
+  connect(&model, SIGNAL(patterns_image_region_changed(QRegion)),
+          this, SLOT(update_patterns_image_region(QRegion)));
 
   // Watch changes in the pattern list.
   connect(&model, SIGNAL(pattern_created(int, QString)),
@@ -94,6 +99,8 @@ TilesetScene::TilesetScene(TilesetModel& model, QObject* parent) :
           this, SLOT(pattern_deleted(int, QString)));
   connect(&model, SIGNAL(pattern_id_changed(int, QString, int, QString)),
           this, SLOT(pattern_id_changed(int, QString, int, QString)));
+  connect(&model, SIGNAL(modelReset()),
+          this, SLOT(patterns_reset()));
 }
 
 /**
@@ -138,10 +145,57 @@ void TilesetScene::drawBackground(QPainter* painter, const QRectF& rect) {
   // Draw the background color.
   painter->fillRect(rect, backgroundBrush());
 
-  // Draw the full PNG image of the tileset.
+  // Draw the parts of the tileset image that are exposed.
+  if (background_chunks.isEmpty()) {
+    return;
+  }
+
+  const QRect& exposed_rect = rect.toAlignedRect().intersected(
+        QRect(QPoint(0, 0), model.get_patterns_image().size()));
+  if (exposed_rect.isEmpty()) {
+    return;
+  }
+
+  const int first_column = exposed_rect.left() / chunk_size;
+  const int last_column = exposed_rect.right() / chunk_size;
+  const int first_row = exposed_rect.top() / chunk_size;
+  const int last_row = exposed_rect.bottom() / chunk_size;
+  for (int row = first_row; row <= last_row; ++row) {
+    for (int column = first_column; column <= last_column; ++column) {
+      const int chunk_index = row * num_chunk_columns + column;
+      if (chunk_index < background_chunks.size()) {
+        painter->drawPixmap(column * chunk_size, row * chunk_size,
+                            background_chunks.at(chunk_index));
+      }
+    }
+  }
+}
+
+/**
+ * @brief Converts the tileset image into pixmaps of chunk_size pixels.
+ *
+ * Pixmaps are optimized for the display device, so drawing them is much
+ * faster than drawing the image, and only the chunks exposed need to be
+ * drawn.
+ */
+void TilesetScene::build_background_chunks() {
+
+  background_chunks.clear();
+  num_chunk_columns = 0;
+
   const QImage& patterns_image = model.get_patterns_image();
-  if (!patterns_image.isNull()) {
-    painter->drawImage(0, 0, patterns_image);
+  if (patterns_image.isNull()) {
+    return;
+  }
+
+  num_chunk_columns = (patterns_image.width() + chunk_size - 1) / chunk_size;
+  const int num_chunk_rows = (patterns_image.height() + chunk_size - 1) / chunk_size;
+  for (int row = 0; row < num_chunk_rows; ++row) {
+    for (int column = 0; column < num_chunk_columns; ++column) {
+      const QRect chunk_rect(column * chunk_size, row * chunk_size, chunk_size, chunk_size);
+      background_chunks << QPixmap::fromImage(
+                             patterns_image.copy(chunk_rect.intersected(patterns_image.rect())));
+    }
   }
 }
 
@@ -152,6 +206,7 @@ void TilesetScene::build() {
 
   clear();
   pattern_items.clear();
+  build_background_chunks();
 
   if (model.get_patterns_image().isNull()) {
     // The tileset image does not exist yet.
@@ -271,6 +326,58 @@ void TilesetScene::update_pattern_position(int index) {
   }
 }
 
+/**
+ * @brief Slot called when the whole patterns image changes.
+ *
+ * The image of all items is updated.
+ */
+void TilesetScene::update_patterns_image() {
+
+  if (pattern_items.size() != model.get_num_patterns()) {
+    // The scene was showing a missing image message.
+    build();
+    return;
+  }
+
+  build_background_chunks();
+  setSceneRect(QRectF(QPoint(0, 0), model.get_patterns_image().size()));
+  for (int i = 0; i < pattern_items.size(); ++i) {
+    update_pattern_position(i);
+  }
+  update();
+}
+
+/**
+ * @brief Slot called when a part of the patterns image changes.
+ *
+ * Only background chunks and items overlapping this part are updated.
+ *
+ * @param region The part of the image that has changed.
+ */
+void TilesetScene::update_patterns_image_region(const QRegion& region) {
+
+  const QImage& patterns_image = model.get_patterns_image();
+  for (int i = 0; i < background_chunks.size(); ++i) {
+    const QRect chunk_rect = QRect((i % num_chunk_columns) * chunk_size,
+                                   (i / num_chunk_columns) * chunk_size,
+                                   chunk_size,
+                                   chunk_size).intersected(patterns_image.rect());
+    if (region.intersects(chunk_rect)) {
+      background_chunks[i] = QPixmap::fromImage(patterns_image.copy(chunk_rect));
+    }
+  }
+
+  for (int i = 0; i < pattern_items.size(); ++i) {
+    if (region.intersects(model.get_pattern_frames_bounding_box(i))) {
+      pattern_items[i]->setPixmap(model.get_pattern_image_all_frames(i));
+    }
+  }
+
+  Q_FOREACH (const QRect& rect, region.rects()) {
+    update(rect);
+  }
+}
+
 /**
  * @brief Slot called when the animation of a pattern changes.
  * @param index Index of the pattern changed.
@@ -351,6 +458,24 @@ void TilesetScene::pattern_id_changed(
   }
 }
 
+/**
+ * @brief Slot called when the whole list of patterns has changed.
+ *
+ * All items are created again.
+ */
+void TilesetScene::patterns_reset() {
+
+  const bool was_blocked = signalsBlocked();
+  blockSignals(true);
+  build();
+  Q_FOREACH (int index, model.get_selected_indexes()) {
+    if (index >= 0 && index < pattern_items.size()) {
+      pattern_items[index]->setSelected(true);
+    }
+  }
+  blockSignals(was_blocked);
+}
+
 /**
  * @brief Creates a pattern item.
  * @param model The tileset.
@@ -407,10 +532,12 @@ void PatternItem::paint(QPainter* painter,
 
   // Start with an opaque background, to erase anything below
   // if the pattern has transparency.
-  if (scene() != nullptr) {
-    painter->fillRect(box, scene()->backgroundBrush());
-  } else {
-    painter->fillRect(box, widget->palette().base());
+  if (!model.is_pattern_opaque(index)) {
+    if (scene() != nullptr) {
+      painter->fillRect(box, scene()->backgroundBrush());
+    } else {
+      painter->fillRect(box, widget->palette().base());
+    }
   }
 
   const bool selected = option->state & QStyle::State_Selected;